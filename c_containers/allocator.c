@@ -0,0 +1,106 @@
+#include "allocator.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef union max_align
+{
+	long double floating;
+	long long integer;
+	void *pointer;
+	void (*function)(void);
+}
+max_align;
+
+static void *heap_allocate(void *state, size_t size)
+{
+	(void)state;
+	return malloc(size);
+}
+
+static void *heap_allocate_zeroed(void *state, size_t size)
+{
+	(void)state;
+	return calloc(1, size);
+}
+
+static void *heap_reallocate(void *state, void *memory, size_t old_size, size_t new_size)
+{
+	(void)state;
+	(void)old_size;
+	return realloc(memory, new_size);
+}
+
+static void heap_deallocate(void *state, void *memory, size_t size)
+{
+	(void)state;
+	(void)size;
+	free(memory);
+}
+
+
+allocator heap_allocator(void)
+{
+	allocator result;
+	result.allocate = heap_allocate;
+	result.allocate_zeroed = heap_allocate_zeroed;
+	result.reallocate = heap_reallocate;
+	result.deallocate = heap_deallocate;
+	result.state = 0;
+	return result;
+}
+
+size_t allocator_align(size_t size)
+{
+	const size_t alignment = sizeof(max_align);
+	return ((size + alignment - 1) / alignment) * alignment;
+}
+
+void *allocator_allocate(const allocator *a, size_t size)
+{
+	return a->allocate(a->state, size);
+}
+
+void *allocator_allocate_zeroed(const allocator *a, size_t size)
+{
+	void *memory;
+	if (a->allocate_zeroed)
+	{
+		return a->allocate_zeroed(a->state, size);
+	}
+	memory = a->allocate(a->state, size);
+	if (memory)
+	{
+		memset(memory, 0, size);
+	}
+	return memory;
+}
+
+void *allocator_reallocate(const allocator *a, void *memory, size_t old_size, size_t new_size)
+{
+	void *moved;
+	if (a->reallocate)
+	{
+		return a->reallocate(a->state, memory, old_size, new_size);
+	}
+	moved = a->allocate(a->state, new_size);
+	if (moved && memory)
+	{
+		memcpy(moved, memory, (old_size < new_size) ? old_size : new_size);
+		allocator_deallocate(a, memory, old_size);
+	}
+	return moved;
+}
+
+void allocator_deallocate(const allocator *a, void *memory, size_t size)
+{
+	if (a->deallocate && memory)
+	{
+		a->deallocate(a->state, memory, size);
+	}
+}
+
+int allocator_frees_in_bulk(const allocator *a)
+{
+	return a->deallocate == 0;
+}
@@ -0,0 +1,35 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+
+#include <stddef.h>
+
+
+/*
+ * Memory source of a container. Sizes are passed back on deallocation so
+ * that allocators need no per-block headers. A container whose allocator
+ * has no deallocate function does not visit its elements when it is
+ * destroyed; the owner of the allocator releases all memory at once.
+ * reallocate and allocate_zeroed are optional as well.
+ */
+typedef struct allocator
+{
+	void *(*allocate)(void *state, size_t size);
+	void *(*allocate_zeroed)(void *state, size_t size);
+	void *(*reallocate)(void *state, void *memory, size_t old_size, size_t new_size);
+	void (*deallocate)(void *state, void *memory, size_t size);
+	void *state;
+}
+allocator;
+
+
+allocator heap_allocator(void);
+size_t allocator_align(size_t size);
+void *allocator_allocate(const allocator *a, size_t size);
+void *allocator_allocate_zeroed(const allocator *a, size_t size);
+void *allocator_reallocate(const allocator *a, void *memory, size_t old_size, size_t new_size);
+void allocator_deallocate(const allocator *a, void *memory, size_t size);
+int allocator_frees_in_bulk(const allocator *a);
+
+
+#endif
@@ -0,0 +1,112 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+struct arena_block
+{
+	arena_block *next;
+};
+
+static void *arena_allocator_allocate(void *state, size_t size)
+{
+	return arena_allocate(state, size);
+}
+
+static void *arena_allocator_reallocate(void *state, void *memory, size_t old_size, size_t new_size)
+{
+	arena * const a = state;
+	void *moved;
+
+	/* the most recent allocation can grow in place */
+	if (memory &&
+		(((char *)memory + allocator_align(old_size)) == a->position) &&
+		(allocator_align(new_size) <= (size_t)(a->end - (char *)memory)))
+	{
+		a->position = (char *)memory + allocator_align(new_size);
+		return memory;
+	}
+
+	moved = arena_allocate(a, new_size);
+	if (moved && memory)
+	{
+		memcpy(moved, memory, (old_size < new_size) ? old_size : new_size);
+	}
+	return moved;
+}
+
+
+void arena_create(arena *a, size_t block_size)
+{
+	a->blocks = 0;
+	a->position = a->end = 0;
+	a->block_size = block_size;
+}
+
+void arena_destroy(arena *a)
+{
+	while (a->blocks)
+	{
+		arena_block * const next = a->blocks->next;
+		free(a->blocks);
+		a->blocks = next;
+	}
+	a->position = a->end = 0;
+}
+
+void *arena_allocate(arena *a, size_t size)
+{
+	const size_t header = allocator_align(sizeof(arena_block));
+	char *result;
+
+	size = allocator_align(size);
+	if (size > (size_t)(a->end - a->position))
+	{
+		arena_block *block;
+		if (size > a->block_size)
+		{
+			/* oversized requests get their own block behind the current one */
+			block = malloc(header + size);
+			if (!block)
+			{
+				return 0;
+			}
+			if (a->blocks)
+			{
+				block->next = a->blocks->next;
+				a->blocks->next = block;
+			}
+			else
+			{
+				block->next = 0;
+				a->blocks = block;
+			}
+			return ((char *)block) + header;
+		}
+
+		block = malloc(header + a->block_size);
+		if (!block)
+		{
+			return 0;
+		}
+		block->next = a->blocks;
+		a->blocks = block;
+		a->position = ((char *)block) + header;
+		a->end = a->position + a->block_size;
+	}
+
+	result = a->position;
+	a->position += size;
+	return result;
+}
+
+allocator arena_allocator(arena *a)
+{
+	allocator result;
+	result.allocate = arena_allocator_allocate;
+	result.allocate_zeroed = 0;
+	result.reallocate = arena_allocator_reallocate;
+	result.deallocate = 0;
+	result.state = a;
+	return result;
+}
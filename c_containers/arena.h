@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+
+#include "allocator.h"
+
+
+typedef struct arena_block arena_block;
+
+/*
+ * Bump allocator. Nothing is freed individually; arena_destroy releases
+ * every block at once, so containers using an arena_allocator are torn
+ * down without visiting their elements.
+ */
+typedef struct arena
+{
+	arena_block *blocks;
+	char *position;
+	char *end;
+	size_t block_size;
+}
+arena;
+
+
+void arena_create(arena *a, size_t block_size);
+void arena_destroy(arena *a);
+void *arena_allocate(arena *a, size_t size);
+allocator arena_allocator(arena *a);
+
+
+#endif
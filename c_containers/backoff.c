@@ -0,0 +1,49 @@
+#include "backoff.h"
+
+#ifdef _WIN32
+#	include <Windows.h>
+#else
+#	include <sched.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#	include <emmintrin.h>
+#	define BACKOFF_PAUSE() _mm_pause()
+#else
+#	define BACKOFF_PAUSE() ((void)0)
+#endif
+
+
+enum
+{
+	spin_limit = 64
+};
+
+
+void backoff_create(backoff *b)
+{
+	b->spins = 0;
+}
+
+void backoff_wait(backoff *b)
+{
+	/* spin briefly in case the other side is about to finish, then give up the core */
+	if (b->spins < spin_limit)
+	{
+		unsigned i;
+		for (i = 0; i <= b->spins; ++i)
+		{
+			BACKOFF_PAUSE();
+		}
+		b->spins *= 2;
+		b->spins += 1;
+	}
+	else
+	{
+#ifdef _WIN32
+		SwitchToThread();
+#else
+		sched_yield();
+#endif
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+
+/* waiting strategy of the blocking operations of the concurrent queues */
+typedef struct backoff
+{
+	unsigned spins;
+}
+backoff;
+
+
+void backoff_create(backoff *b);
+void backoff_wait(backoff *b);
+
+
+#endif
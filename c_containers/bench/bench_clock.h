@@ -0,0 +1,37 @@
+#ifndef BENCH_CLOCK_H
+#define BENCH_CLOCK_H
+
+
+#ifdef _WIN32
+#	include <Windows.h>
+#else
+#	include <time.h>
+#endif
+
+
+/* monotonic wall clock in seconds for the benchmark programs */
+static inline double bench_seconds(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+#endif
+}
+
+/* splitmix64 finalizer, used to generate well spread benchmark keys */
+static inline unsigned long long bench_mix(unsigned long long x)
+{
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+
+#endif
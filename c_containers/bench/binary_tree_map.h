@@ -0,0 +1,37 @@
+#ifndef BINARY_TREE_MAP_H
+#define BINARY_TREE_MAP_H
+
+
+/* the former node per key tree_map, kept as a benchmark baseline */
+
+
+#include "../tree_map.h"
+
+
+typedef struct binary_tree_node binary_tree_node;
+
+typedef struct binary_tree_map
+{
+	size_t key_size;
+	size_t value_size;
+	binary_tree_node *root;
+	tree_key_comparator_t comparator;
+	void *user_data;
+}
+binary_tree_map;
+
+
+void binary_tree_map_create(
+	binary_tree_map *map,
+	size_t key_size,
+	size_t value_size,
+	tree_key_comparator_t comparator,
+	void *user_data);
+void binary_tree_map_destroy(binary_tree_map *map);
+int binary_tree_map_insert(binary_tree_map *map, const void *key, const void *value);
+void binary_tree_map_erase(binary_tree_map *map, const void *key);
+void *binary_tree_map_find(binary_tree_map *map, const void *key);
+void binary_tree_map_clear(binary_tree_map *map);
+
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef CHAINED_HASH_MAP_H
+#define CHAINED_HASH_MAP_H
+
+
+/* the separately chained hash_map engine, kept as a benchmark baseline */
+
+
+#include "../hash_map.h"
+
+
+typedef struct chained_hash_map_bucket chained_hash_map_bucket;
+typedef struct chained_hash_map_entry chained_hash_map_entry;
+
+typedef struct chained_hash_map
+{
+	chained_hash_map_bucket *buckets;
+	size_t key_size;
+	size_t value_size;
+	size_t elements;
+	size_t bucket_count;
+	hash_function_t hash;
+	void *hash_user_data;
+}
+chained_hash_map;
+
+typedef struct chained_hash_map_iterator
+{
+	const chained_hash_map *map;
+	const chained_hash_map_bucket *bucket;
+	const chained_hash_map_entry *entry;
+}
+chained_hash_map_iterator;
+
+chained_hash_map_iterator chained_hash_map_iterate(const chained_hash_map *map);
+const void *chained_hash_map_iterator_key(const chained_hash_map_iterator *iterator);
+const void *chained_hash_map_iterator_value(const chained_hash_map_iterator *iterator);
+int chained_hash_map_iterator_next(chained_hash_map_iterator *iterator);
+void chained_hash_map_create(
+	chained_hash_map *map,
+	size_t key_size,
+	size_t value_size,
+	hash_function_t hash,
+	void *hash_user_data);
+void chained_hash_map_destroy(chained_hash_map *map);
+int chained_hash_map_resize(chained_hash_map *map, size_t bucket_count);
+int chained_hash_map_grow(chained_hash_map *map);
+chained_hash_map_bucket *chained_hash_map_find_bucket(const chained_hash_map *map, const void *key);
+int chained_hash_map_insert(chained_hash_map *map, const void *key, const void *value);
+const void *chained_hash_map_find(const chained_hash_map *map, const void *key);
+int chained_hash_map_erase(chained_hash_map *map, const void *key);
+size_t chained_hash_map_size(const chained_hash_map *map);
+void chained_hash_map_clear(chained_hash_map *map);
+
+
+#endif
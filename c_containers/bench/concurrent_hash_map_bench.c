@@ -0,0 +1,170 @@
+#include "../concurrent_hash_map.h"
+#include "../hash_map.h"
+#include "bench_clock.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*
+ * Scaling of a read-mostly workload (one insertion per write_every
+ * operations, lookups otherwise) over 1 to 64 threads: the sharded map
+ * against a single hash_map behind one mutex, which is how the map was
+ * shared between workers before.
+ */
+
+typedef unsigned long long bench_key;
+
+enum
+{
+	max_threads = 64,
+	write_every = 10,
+	shard_count = 64
+};
+
+typedef struct locked_map
+{
+	pthread_mutex_t mutex;
+	hash_map map;
+}
+locked_map;
+
+typedef struct worker
+{
+	void *shared;
+	size_t operations;
+	size_t key_range;
+	unsigned long long seed;
+	size_t found;
+}
+worker;
+
+static hash_t hash_key(const void *key, void *user_data)
+{
+	const bench_key *k = key;
+	(void)user_data;
+	return (hash_t)(*k ^ (*k >> 29));
+}
+
+static void *run_sharded(void *argument)
+{
+	worker *w = argument;
+	size_t i;
+	for (i = 0; i < w->operations; ++i)
+	{
+		const bench_key key = bench_mix(w->seed + i) % w->key_range;
+		bench_key value = key;
+		if ((i % write_every) == 0)
+		{
+			concurrent_hash_map_insert(w->shared, &key, &value);
+		}
+		else
+		{
+			w->found += (size_t)concurrent_hash_map_find(w->shared, &key, &value);
+		}
+	}
+	return 0;
+}
+
+static void *run_locked(void *argument)
+{
+	worker *w = argument;
+	locked_map *m = w->shared;
+	size_t i;
+	for (i = 0; i < w->operations; ++i)
+	{
+		const bench_key key = bench_mix(w->seed + i) % w->key_range;
+		const bench_key value = key;
+		pthread_mutex_lock(&m->mutex);
+		if ((i % write_every) == 0)
+		{
+			hash_map_insert(&m->map, &key, &value);
+		}
+		else
+		{
+			w->found += (hash_map_find(&m->map, &key) != 0);
+		}
+		pthread_mutex_unlock(&m->mutex);
+	}
+	return 0;
+}
+
+static double run(void *shared, void *(*body)(void *), size_t threads, size_t operations, size_t key_range)
+{
+	pthread_t handles[max_threads];
+	worker workers[max_threads];
+	size_t i;
+	const double start = bench_seconds();
+
+	for (i = 0; i < threads; ++i)
+	{
+		workers[i].shared = shared;
+		workers[i].operations = operations / threads;
+		workers[i].key_range = key_range;
+		workers[i].seed = (unsigned long long)i << 40;
+		workers[i].found = 0;
+		if (pthread_create(&handles[i], 0, body, &workers[i]) != 0)
+		{
+			fprintf(stderr, "Could not start a thread\n");
+			exit(1);
+		}
+	}
+	for (i = 0; i < threads; ++i)
+	{
+		pthread_join(handles[i], 0);
+	}
+	return (double)operations / (bench_seconds() - start) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+	const size_t key_range = 1000000;
+	size_t operations = 20000000;
+	size_t i;
+
+	if (argc >= 2)
+	{
+		operations = (size_t)atol(argv[1]);
+	}
+
+	printf("%u keys, %u operations, 1 in %u an insertion, million operations per second\n",
+		(unsigned)key_range, (unsigned)operations, (unsigned)write_every);
+	printf("%-8s %20s %20s\n", "threads", "concurrent_hash_map", "mutex+hash_map");
+	for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i)
+	{
+		concurrent_hash_map sharded;
+		locked_map locked;
+		bench_key key;
+		double sharded_rate, locked_rate;
+
+		if (!concurrent_hash_map_create(&sharded, sizeof(bench_key), sizeof(bench_key), hash_key, 0, shard_count) ||
+			!concurrent_hash_map_reserve(&sharded, key_range))
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		pthread_mutex_init(&locked.mutex, 0);
+		hash_map_create(&locked.map, sizeof(bench_key), sizeof(bench_key), hash_key, 0);
+		if (!hash_map_reserve(&locked.map, key_range))
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		/* half of the keys are present from the start */
+		for (key = 0; key < key_range; key += 2)
+		{
+			concurrent_hash_map_insert(&sharded, &key, &key);
+			hash_map_insert(&locked.map, &key, &key);
+		}
+
+		sharded_rate = run(&sharded, run_sharded, thread_counts[i], operations, key_range);
+		locked_rate = run(&locked, run_locked, thread_counts[i], operations, key_range);
+		printf("%-8u %20.2f %20.2f\n", (unsigned)thread_counts[i], sharded_rate, locked_rate);
+
+		hash_map_destroy(&locked.map);
+		pthread_mutex_destroy(&locked.mutex);
+		concurrent_hash_map_destroy(&sharded);
+	}
+	return 0;
+}
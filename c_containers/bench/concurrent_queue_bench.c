@@ -0,0 +1,253 @@
+#include "../spsc_queue.h"
+#include "../mpmc_queue.h"
+#include "../queue.h"
+#include "../backoff.h"
+#include "bench_clock.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*
+ * Hands integers from producer threads to consumer threads through the
+ * lock-free rings and through a queue guarded by a mutex, the way the
+ * containers had to be shared before. Every consumer adds up what it
+ * receives so the runs can be checked against each other.
+ */
+
+enum
+{
+	ring_capacity = 1024,
+	max_threads = 16
+};
+
+typedef struct mutex_queue
+{
+	pthread_mutex_t mutex;
+	queue q;
+}
+mutex_queue;
+
+typedef struct worker
+{
+	void *shared;
+	size_t count;
+	unsigned long long sum;
+}
+worker;
+
+static void mutex_queue_push(mutex_queue *m, const unsigned long long *value)
+{
+	backoff b;
+	backoff_create(&b);
+	for (;;)
+	{
+		pthread_mutex_lock(&m->mutex);
+		/* bounded like the rings so that a fast producer cannot run away */
+		if (queue_size(&m->q) < ring_capacity)
+		{
+			if (!queue_push(&m->q, value))
+			{
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+			pthread_mutex_unlock(&m->mutex);
+			return;
+		}
+		pthread_mutex_unlock(&m->mutex);
+		backoff_wait(&b);
+	}
+}
+
+static unsigned long long mutex_queue_pop(mutex_queue *m)
+{
+	backoff b;
+	backoff_create(&b);
+	for (;;)
+	{
+		pthread_mutex_lock(&m->mutex);
+		if (!queue_empty(&m->q))
+		{
+			const unsigned long long value = *(const unsigned long long *)queue_front(&m->q);
+			queue_pop(&m->q);
+			pthread_mutex_unlock(&m->mutex);
+			return value;
+		}
+		pthread_mutex_unlock(&m->mutex);
+		backoff_wait(&b);
+	}
+}
+
+static void *spsc_produce(void *argument)
+{
+	worker *w = argument;
+	unsigned long long i;
+	for (i = 0; i < w->count; ++i)
+	{
+		spsc_queue_push(w->shared, &i);
+	}
+	return 0;
+}
+
+static void *spsc_consume(void *argument)
+{
+	worker *w = argument;
+	size_t i;
+	for (i = 0; i < w->count; ++i)
+	{
+		unsigned long long value;
+		spsc_queue_pop(w->shared, &value);
+		w->sum += value;
+	}
+	return 0;
+}
+
+static void *mpmc_produce(void *argument)
+{
+	worker *w = argument;
+	unsigned long long i;
+	for (i = 0; i < w->count; ++i)
+	{
+		mpmc_queue_push(w->shared, &i);
+	}
+	return 0;
+}
+
+static void *mpmc_consume(void *argument)
+{
+	worker *w = argument;
+	size_t i;
+	for (i = 0; i < w->count; ++i)
+	{
+		unsigned long long value;
+		mpmc_queue_pop(w->shared, &value);
+		w->sum += value;
+	}
+	return 0;
+}
+
+static void *mutex_produce(void *argument)
+{
+	worker *w = argument;
+	unsigned long long i;
+	for (i = 0; i < w->count; ++i)
+	{
+		mutex_queue_push(w->shared, &i);
+	}
+	return 0;
+}
+
+static void *mutex_consume(void *argument)
+{
+	worker *w = argument;
+	size_t i;
+	for (i = 0; i < w->count; ++i)
+	{
+		w->sum += mutex_queue_pop(w->shared);
+	}
+	return 0;
+}
+
+/* total / producers elements per producer, total / consumers per consumer */
+static double run(
+	void *shared,
+	void *(*produce)(void *),
+	void *(*consume)(void *),
+	size_t producers,
+	size_t consumers,
+	size_t total,
+	unsigned long long *checksum)
+{
+	pthread_t threads[2 * max_threads];
+	worker workers[2 * max_threads];
+	size_t i;
+	double start;
+
+	start = bench_seconds();
+	for (i = 0; i < producers + consumers; ++i)
+	{
+		workers[i].shared = shared;
+		workers[i].count = total / ((i < producers) ? producers : consumers);
+		workers[i].sum = 0;
+		if (pthread_create(&threads[i], 0, (i < producers) ? produce : consume, &workers[i]) != 0)
+		{
+			fprintf(stderr, "Could not start a thread\n");
+			exit(1);
+		}
+	}
+	*checksum = 0;
+	for (i = 0; i < producers + consumers; ++i)
+	{
+		pthread_join(threads[i], 0);
+		if (i >= producers)
+		{
+			*checksum += workers[i].sum;
+		}
+	}
+	return (double)total / (bench_seconds() - start) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t thread_counts[] = {1, 2, 4, 8};
+	size_t total = 10000000;
+	size_t i;
+	spsc_queue spsc;
+	mpmc_queue mpmc;
+	mutex_queue locked;
+	unsigned long long expected, spsc_sum, mpmc_sum, mutex_sum;
+	double rate;
+
+	if (argc >= 2)
+	{
+		total = (size_t)atol(argv[1]);
+	}
+	/* divisible by every thread count */
+	total -= total % 8;
+
+	if (!spsc_queue_create(&spsc, sizeof(unsigned long long), ring_capacity) ||
+		!mpmc_queue_create(&mpmc, sizeof(unsigned long long), ring_capacity))
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	pthread_mutex_init(&locked.mutex, 0);
+	queue_create(&locked.q, sizeof(unsigned long long));
+
+	printf("elements: %u, capacity %u, million elements handed over per second\n", (unsigned)total, (unsigned)ring_capacity);
+	printf("%-22s %12s %12s %12s\n", "producers x consumers", "spsc_queue", "mpmc_queue", "mutex+queue");
+	for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i)
+	{
+		const size_t n = thread_counts[i];
+		char label[32];
+
+		sprintf(label, "%u x %u", (unsigned)n, (unsigned)n);
+		printf("%-22s ", label);
+		if (n == 1)
+		{
+			rate = run(&spsc, spsc_produce, spsc_consume, 1, 1, total, &spsc_sum);
+			printf("%12.2f ", rate);
+		}
+		else
+		{
+			printf("%12s ", "-");
+		}
+		rate = run(&mpmc, mpmc_produce, mpmc_consume, n, n, total, &mpmc_sum);
+		printf("%12.2f ", rate);
+		rate = run(&locked, mutex_produce, mutex_consume, n, n, total, &mutex_sum);
+		printf("%12.2f\n", rate);
+
+		expected = (unsigned long long)n * (total / n) * (total / n - 1) / 2;
+		if ((mpmc_sum != expected) || (mutex_sum != expected) || ((n == 1) && (spsc_sum != expected)))
+		{
+			fprintf(stderr, "Checksums differ\n");
+			return 1;
+		}
+	}
+
+	queue_destroy(&locked.q);
+	pthread_mutex_destroy(&locked.mutex);
+	mpmc_queue_destroy(&mpmc);
+	spsc_queue_destroy(&spsc);
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include "../hash_functions.h"
+#include "../hash_map.h"
+#include "bench_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * Compares the built-in hash functions with an FNV-1a byte loop, which is
+ * what most hand written hash_function_t callbacks look like: first the
+ * raw hashing rate per key size, then insertions and lookups of a
+ * hash_map whose keys are hashed either way.
+ */
+
+enum
+{
+	buffer_size = 1 << 16,
+	max_key_size = 4096
+};
+
+static hash_t fnv1a(const void *key, void *parameters)
+{
+	const hash_parameters *p = parameters;
+	const unsigned char *bytes = key;
+	unsigned long long h = 0xcbf29ce484222325ull;
+	size_t i;
+	for (i = 0; i < p->key_size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 0x100000001b3ull;
+	}
+	return (hash_t)h;
+}
+
+/*
+ * Hashes keys at varying offsets of buffer. The call goes through a
+ * function pointer like in a map, which also keeps the compiler from
+ * folding the loop.
+ */
+static double bench_hash(hash_function_t hash, hash_parameters *parameters, const unsigned char *buffer, size_t rounds, hash_t *sink)
+{
+	hash_function_t volatile call = hash;
+	const size_t span = buffer_size - parameters->key_size;
+	const double start = bench_seconds();
+	size_t i;
+	for (i = 0; i < rounds; ++i)
+	{
+		*sink += call(buffer + ((i * 64) % span), parameters);
+	}
+	return (bench_seconds() - start) / (double)rounds;
+}
+
+static double bench_map(hash_function_t hash, hash_parameters *parameters, const unsigned char *keys, size_t count)
+{
+	hash_map map;
+	size_t i, found = 0;
+	const double start = bench_seconds();
+
+	hash_map_create(&map, parameters->key_size, sizeof(unsigned), hash, parameters);
+	for (i = 0; i < count; ++i)
+	{
+		const unsigned value = (unsigned)i;
+		if (!hash_map_insert(&map, keys + (i * parameters->key_size), &value))
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	for (i = 0; i < count; ++i)
+	{
+		found += (hash_map_find(&map, keys + (i * parameters->key_size)) != 0);
+	}
+	hash_map_destroy(&map);
+	if (found != count)
+	{
+		fprintf(stderr, "Lost keys\n");
+		exit(1);
+	}
+	return (double)(2 * count) / (bench_seconds() - start) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t key_sizes[] = {4, 8, 16, 32, 64, 256, 1024, max_key_size};
+	static const size_t map_key_sizes[] = {4, 8, 16, 32};
+	size_t rounds = 20000000;
+	const size_t map_keys = 1000000;
+	unsigned char *buffer = malloc(buffer_size);
+	unsigned char *keys;
+	hash_t sink = 0;
+	size_t i, j;
+
+	if (argc >= 2)
+	{
+		rounds = (size_t)atol(argv[1]);
+	}
+	keys = malloc(map_keys * 32);
+	if (!buffer || !keys)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < buffer_size; ++i)
+	{
+		buffer[i] = (unsigned char)bench_mix(i);
+	}
+
+	printf("hashing, ns per key (GB/s)\n");
+	printf("%-10s %20s %20s\n", "key bytes", "fnv1a", "built-in");
+	for (i = 0; i < sizeof(key_sizes) / sizeof(key_sizes[0]); ++i)
+	{
+		hash_parameters parameters;
+		size_t key_rounds = rounds / (1 + key_sizes[i] / 16);
+		double fnv_time, builtin_time;
+
+		hash_parameters_create(&parameters, key_sizes[i], hash_random_seed());
+		fnv_time = bench_hash(fnv1a, &parameters, buffer, key_rounds, &sink);
+		builtin_time = bench_hash(hash_function_for_size(key_sizes[i]), &parameters, buffer, key_rounds, &sink);
+		printf("%-10u %10.2f (%6.2f) %10.2f (%6.2f)\n",
+			(unsigned)key_sizes[i],
+			fnv_time * 1e9, (double)key_sizes[i] / fnv_time / 1e9,
+			builtin_time * 1e9, (double)key_sizes[i] / builtin_time / 1e9);
+	}
+
+	printf("\nhash_map, %u distinct keys, million insertions + lookups per second\n", (unsigned)map_keys);
+	printf("%-10s %12s %12s\n", "key bytes", "fnv1a", "built-in");
+	for (i = 0; i < sizeof(map_key_sizes) / sizeof(map_key_sizes[0]); ++i)
+	{
+		const size_t key_size = map_key_sizes[i];
+		hash_parameters parameters;
+		double fnv_rate, builtin_rate;
+
+		/* sequential integers in the first bytes, like ids or packed tuples */
+		memset(keys, 0, map_keys * key_size);
+		for (j = 0; j < map_keys; ++j)
+		{
+			const unsigned long long id = j;
+			memcpy(keys + (j * key_size), &id, (key_size < sizeof(id)) ? key_size : sizeof(id));
+		}
+
+		hash_parameters_create(&parameters, key_size, hash_random_seed());
+		fnv_rate = bench_map(fnv1a, &parameters, keys, map_keys);
+		builtin_rate = bench_map(hash_function_for_size(key_size), &parameters, keys, map_keys);
+		printf("%-10u %12.2f %12.2f\n", (unsigned)key_size, fnv_rate, builtin_rate);
+	}
+
+	printf("\nchecksum %x\n", (unsigned)sink);
+	free(keys);
+	free(buffer);
+	return 0;
+}
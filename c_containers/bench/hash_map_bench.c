@@ -0,0 +1,271 @@
+#include "../hash_map.h"
+#include "chained_hash_map.h"
+#include "bench_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*
+ * Compares lookup rates of the open addressing hash_map against the old
+ * separately chained engine at several load factors (elements / buckets).
+ * The open addressing table never exceeds a load factor of 7/8.
+ */
+
+typedef unsigned long long bench_key;
+
+static hash_t hash_key(const void *key, void *user_data)
+{
+	const bench_key *k = key;
+	(void)user_data;
+	return (hash_t)(*k ^ (*k >> 29));
+}
+
+static bench_key hit_key(size_t i)
+{
+	return bench_mix(i) & ~1ull;
+}
+
+static bench_key miss_key(size_t i)
+{
+	return bench_mix(i) | 1ull;
+}
+
+/* visits 0..n-1 in a scattered order so that lookups do not stream */
+static size_t scatter(size_t i, size_t n)
+{
+	return (i * 2654435761u) % n;
+}
+
+typedef struct rates
+{
+	double hit;
+	double miss;
+	size_t found;
+}
+rates;
+
+static rates bench_open_addressing(size_t buckets, size_t n, size_t rounds)
+{
+	rates result = {0, 0, 0};
+	hash_map map;
+	size_t i, r;
+	double start;
+
+	hash_map_create(&map, sizeof(bench_key), sizeof(bench_key), hash_key, 0);
+	if (!hash_map_resize(&map, buckets))
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	for (i = 0; i < n; ++i)
+	{
+		const bench_key key = hit_key(i);
+		hash_map_insert(&map, &key, &key);
+	}
+
+	start = bench_seconds();
+	for (r = 0; r < rounds; ++r)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			const bench_key key = hit_key(scatter(i, n));
+			result.found += (hash_map_find(&map, &key) != 0);
+		}
+	}
+	result.hit = (double)(n * rounds) / (bench_seconds() - start) / 1e6;
+
+	start = bench_seconds();
+	for (r = 0; r < rounds; ++r)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			const bench_key key = miss_key(i);
+			result.found += (hash_map_find(&map, &key) != 0);
+		}
+	}
+	result.miss = (double)(n * rounds) / (bench_seconds() - start) / 1e6;
+
+	hash_map_destroy(&map);
+	return result;
+}
+
+static rates bench_chained(size_t buckets, size_t n, size_t rounds)
+{
+	rates result = {0, 0, 0};
+	chained_hash_map map;
+	size_t i, r;
+	double start;
+
+	chained_hash_map_create(&map, sizeof(bench_key), sizeof(bench_key), hash_key, 0);
+	if (!chained_hash_map_resize(&map, buckets))
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	for (i = 0; i < n; ++i)
+	{
+		const bench_key key = hit_key(i);
+		chained_hash_map_insert(&map, &key, &key);
+	}
+
+	start = bench_seconds();
+	for (r = 0; r < rounds; ++r)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			const bench_key key = hit_key(scatter(i, n));
+			result.found += (chained_hash_map_find(&map, &key) != 0);
+		}
+	}
+	result.hit = (double)(n * rounds) / (bench_seconds() - start) / 1e6;
+
+	start = bench_seconds();
+	for (r = 0; r < rounds; ++r)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			const bench_key key = miss_key(i);
+			result.found += (chained_hash_map_find(&map, &key) != 0);
+		}
+	}
+	result.miss = (double)(n * rounds) / (bench_seconds() - start) / 1e6;
+
+	chained_hash_map_destroy(&map);
+	return result;
+}
+
+/* slowest single insertion while growing from empty to n elements, in microseconds */
+static double worst_insert_open_addressing(size_t n)
+{
+	double worst = 0;
+	hash_map map;
+	size_t i;
+
+	hash_map_create(&map, sizeof(bench_key), sizeof(bench_key), hash_key, 0);
+	for (i = 0; i < n; ++i)
+	{
+		const bench_key key = hit_key(i);
+		const double start = bench_seconds();
+		double elapsed;
+		hash_map_insert(&map, &key, &key);
+		elapsed = bench_seconds() - start;
+		if (elapsed > worst)
+		{
+			worst = elapsed;
+		}
+	}
+	hash_map_destroy(&map);
+	return worst * 1e6;
+}
+
+static double worst_insert_chained(size_t n)
+{
+	double worst = 0;
+	chained_hash_map map;
+	size_t i;
+
+	chained_hash_map_create(&map, sizeof(bench_key), sizeof(bench_key), hash_key, 0);
+	for (i = 0; i < n; ++i)
+	{
+		const bench_key key = hit_key(i);
+		const double start = bench_seconds();
+		double elapsed;
+		chained_hash_map_insert(&map, &key, &key);
+		elapsed = bench_seconds() - start;
+		if (elapsed > worst)
+		{
+			worst = elapsed;
+		}
+	}
+	chained_hash_map_destroy(&map);
+	return worst * 1e6;
+}
+
+/* seconds to load n keys one by one (batched == 0) or with hash_map_insert_n */
+static double bulk_load(const bench_key *keys, size_t n, int batched)
+{
+	hash_map map;
+	size_t i;
+	double elapsed;
+	const double start = bench_seconds();
+
+	hash_map_create(&map, sizeof(bench_key), sizeof(bench_key), hash_key, 0);
+	if (batched)
+	{
+		if (!hash_map_insert_n(&map, keys, keys, n))
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	else
+	{
+		for (i = 0; i < n; ++i)
+		{
+			hash_map_insert(&map, keys + i, keys + i);
+		}
+	}
+	elapsed = bench_seconds() - start;
+	hash_map_destroy(&map);
+	return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+	static const double load_factors[] = {0.5, 0.6, 0.7, 0.8, 0.87};
+	size_t buckets = (size_t)1 << 20;
+	size_t rounds = 3;
+	size_t i;
+
+	if (argc >= 2)
+	{
+		buckets = (size_t)1 << atoi(argv[1]);
+	}
+	if (argc >= 3)
+	{
+		rounds = (size_t)atoi(argv[2]);
+	}
+
+	printf("buckets: %u, rounds: %u, million lookups per second\n", (unsigned)buckets, (unsigned)rounds);
+	printf("%-6s %-16s %10s %10s\n", "load", "engine", "hit", "miss");
+
+	for (i = 0; i < sizeof(load_factors) / sizeof(load_factors[0]); ++i)
+	{
+		const size_t n = (size_t)(load_factors[i] * (double)buckets);
+		const rates open = bench_open_addressing(buckets, n, rounds);
+		const rates chained = bench_chained(buckets, n, rounds);
+		if ((open.found != (n * rounds)) ||
+			(chained.found != (n * rounds)))
+		{
+			fprintf(stderr, "Lookup results differ\n");
+			return 1;
+		}
+		printf("%-6.2f %-16s %10.2f %10.2f\n", load_factors[i], "open addressing", open.hit, open.miss);
+		printf("%-6.2f %-16s %10.2f %10.2f\n", load_factors[i], "chained", chained.hit, chained.miss);
+	}
+
+	printf("worst insertion while growing to %u elements: open addressing %.1f us, chained %.1f us\n",
+		(unsigned)buckets,
+		worst_insert_open_addressing(buckets),
+		worst_insert_chained(buckets));
+
+	{
+		bench_key *keys = malloc(sizeof(*keys) * buckets);
+		if (!keys)
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		for (i = 0; i < buckets; ++i)
+		{
+			keys[i] = hit_key(i);
+		}
+		printf("loading %u elements: insert loop %.1f ms, hash_map_insert_n %.1f ms\n",
+			(unsigned)buckets,
+			bulk_load(keys, buckets, 0) * 1e3,
+			bulk_load(keys, buckets, 1) * 1e3);
+		free(keys);
+	}
+
+	return 0;
+}
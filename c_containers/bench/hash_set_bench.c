@@ -0,0 +1,112 @@
+#include "../hash_set.h"
+#include "bench_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*
+ * Intersects two sets of n random keys that share half their keys, once
+ * with hash_set_intersect and once the way it used to be done: iterate
+ * one set and call hash_set_contains on the other for every key. Also
+ * reports the table bytes per element of the key-only layout.
+ */
+
+typedef unsigned long long bench_key;
+
+static hash_t hash_key(const void *key, void *user_data)
+{
+	const bench_key *k = key;
+	(void)user_data;
+	return (hash_t)(*k ^ (*k >> 29));
+}
+
+static void fill(hash_set *set, size_t n, size_t first)
+{
+	size_t i;
+	for (i = 0; i < n; ++i)
+	{
+		const bench_key key = bench_mix(first + i);
+		if (!hash_set_insert(set, &key))
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+}
+
+static double bench_contains(hash_set *result, hash_set *left, const hash_set *right)
+{
+	const double start = bench_seconds();
+	hash_set_iterator i = hash_set_iterate(left);
+	hash_set_clear(result);
+	while (hash_set_iterator_next(&i))
+	{
+		const void *key = hash_set_iterator_key(&i);
+		if (hash_set_contains(right, key) &&
+			!hash_set_insert(result, key))
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	return bench_seconds() - start;
+}
+
+static double bench_intersect(hash_set *result, const hash_set *left, const hash_set *right)
+{
+	const double start = bench_seconds();
+	if (!hash_set_intersect(result, left, right))
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	return bench_seconds() - start;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t sizes[] = {1000, 100000, 1000000, 10000000};
+	size_t max_size = 10000000;
+	size_t i;
+
+	if (argc >= 2)
+	{
+		max_size = (size_t)atol(argv[1]);
+	}
+
+	printf("%-10s %14s %14s %14s %10s\n", "keys", "contains ns", "intersect ns", "bytes/key", "common");
+	for (i = 0; (i < sizeof(sizes) / sizeof(sizes[0])) && (sizes[i] <= max_size); ++i)
+	{
+		const size_t n = sizes[i];
+		hash_set left, right, by_contains, by_intersect;
+		double contains_time, intersect_time;
+
+		hash_set_create(&left, sizeof(bench_key), hash_key, 0);
+		hash_set_create(&right, sizeof(bench_key), hash_key, 0);
+		hash_set_create(&by_contains, sizeof(bench_key), hash_key, 0);
+		hash_set_create(&by_intersect, sizeof(bench_key), hash_key, 0);
+		fill(&left, n, 0);
+		fill(&right, n, n / 2);
+
+		contains_time = bench_contains(&by_contains, &left, &right);
+		intersect_time = bench_intersect(&by_intersect, &left, &right);
+		if (hash_set_size(&by_contains) != hash_set_size(&by_intersect))
+		{
+			fprintf(stderr, "Results differ\n");
+			return 1;
+		}
+
+		printf("%-10u %14.1f %14.1f %14.2f %10u\n",
+			(unsigned)n,
+			contains_time / (double)n * 1e9,
+			intersect_time / (double)n * 1e9,
+			(double)left.bucket_count * (1.0 + sizeof(bench_key)) / (double)n,
+			(unsigned)hash_set_size(&by_intersect));
+
+		hash_set_destroy(&by_intersect);
+		hash_set_destroy(&by_contains);
+		hash_set_destroy(&right);
+		hash_set_destroy(&left);
+	}
+	return 0;
+}
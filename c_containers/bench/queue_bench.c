@@ -0,0 +1,110 @@
+#include "../queue.h"
+#include "../linked_list.h"
+#include "bench_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*
+ * Compares the block based queue with the linked_list the queue used to
+ * wrap. Each pass pushes a burst of small records and pops them again,
+ * so that the queue length oscillates like in a producer/consumer setup.
+ */
+
+typedef struct record
+{
+	unsigned long long id;
+	unsigned long long payload;
+}
+record;
+
+static double bench_queue(size_t total, size_t burst, unsigned long long *checksum)
+{
+	queue q;
+	size_t done;
+	const double start = bench_seconds();
+
+	queue_create(&q, sizeof(record));
+	for (done = 0; done < total; done += burst)
+	{
+		size_t i;
+		for (i = 0; i < burst; ++i)
+		{
+			record r;
+			r.id = done + i;
+			r.payload = r.id * 3;
+			if (!queue_push(&q, &r))
+			{
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+		}
+		while (!queue_empty(&q))
+		{
+			*checksum += ((const record *)queue_front(&q))->payload;
+			queue_pop(&q);
+		}
+	}
+	queue_destroy(&q);
+	return (double)total / (bench_seconds() - start) / 1e6;
+}
+
+static double bench_linked_list(size_t total, size_t burst, unsigned long long *checksum)
+{
+	linked_list list;
+	size_t done;
+	const double start = bench_seconds();
+
+	linked_list_create(&list, sizeof(record));
+	for (done = 0; done < total; done += burst)
+	{
+		size_t i;
+		for (i = 0; i < burst; ++i)
+		{
+			record r;
+			r.id = done + i;
+			r.payload = r.id * 3;
+			if (!linked_list_push_back(&list, &r))
+			{
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+		}
+		while (!linked_list_empty(&list))
+		{
+			*checksum += ((const record *)linked_list_front(&list))->payload;
+			linked_list_pop_front(&list);
+		}
+	}
+	linked_list_destroy(&list);
+	return (double)total / (bench_seconds() - start) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t bursts[] = {1, 16, 1024, 65536};
+	size_t total = 20000000;
+	size_t i;
+
+	if (argc >= 2)
+	{
+		total = (size_t)atol(argv[1]);
+	}
+
+	printf("records: %u of %u bytes, million push + pop per second\n", (unsigned)total, (unsigned)sizeof(record));
+	printf("%-8s %12s %12s\n", "burst", "queue", "linked_list");
+	for (i = 0; i < sizeof(bursts) / sizeof(bursts[0]); ++i)
+	{
+		unsigned long long queue_sum = 0;
+		unsigned long long list_sum = 0;
+		const double queue_rate = bench_queue(total, bursts[i], &queue_sum);
+		const double list_rate = bench_linked_list(total, bursts[i], &list_sum);
+		if (queue_sum != list_sum)
+		{
+			fprintf(stderr, "Checksums differ\n");
+			return 1;
+		}
+		printf("%-8u %12.2f %12.2f\n", (unsigned)bursts[i], queue_rate, list_rate);
+	}
+	return 0;
+}
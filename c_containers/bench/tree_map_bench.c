@@ -0,0 +1,164 @@
+#include "../tree_map.h"
+#include "binary_tree_map.h"
+#include "bench_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * Compares the B+-tree tree_map against the former node per key tree on
+ * random keys. The former tree is not balanced, so sorted insertion orders
+ * would only measure its degenerate case.
+ */
+
+typedef unsigned long long bench_key;
+
+static int compare_key(const void *left, const void *right, void *user_data)
+{
+	bench_key l, r;
+	(void)user_data;
+	memcpy(&l, left, sizeof(l));
+	memcpy(&r, right, sizeof(r));
+	return (l > r) - (l < r);
+}
+
+typedef struct rates
+{
+	double insert;
+	double find;
+	double scan;
+	size_t found;
+}
+rates;
+
+static rates bench_b_tree(const bench_key *keys, size_t n, size_t rounds)
+{
+	rates result = {0, 0, 0, 0};
+	tree_map map;
+	size_t i, r;
+	double start;
+
+	tree_map_create(&map, sizeof(bench_key), sizeof(bench_key), compare_key, 0);
+
+	start = bench_seconds();
+	for (i = 0; i < n; ++i)
+	{
+		if (!tree_map_insert(&map, keys + i, keys + i))
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	result.insert = (double)n / (bench_seconds() - start) / 1e6;
+
+	start = bench_seconds();
+	for (r = 0; r < rounds; ++r)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			result.found += (tree_map_find(&map, keys + ((i * 2654435761u) % n)) != 0);
+		}
+	}
+	result.find = (double)(n * rounds) / (bench_seconds() - start) / 1e6;
+
+	start = bench_seconds();
+	for (r = 0; r < rounds; ++r)
+	{
+		tree_map_iterator iterator = tree_map_iterate(&map);
+		size_t visited = 0;
+		while (tree_map_iterator_next(&iterator))
+		{
+			++visited;
+		}
+		if (visited != n)
+		{
+			fprintf(stderr, "Iteration is incomplete\n");
+			exit(1);
+		}
+	}
+	result.scan = (double)(n * rounds) / (bench_seconds() - start) / 1e6;
+
+	tree_map_destroy(&map);
+	return result;
+}
+
+static rates bench_binary_tree(const bench_key *keys, size_t n, size_t rounds)
+{
+	rates result = {0, 0, 0, 0};
+	binary_tree_map map;
+	size_t i, r;
+	double start;
+
+	binary_tree_map_create(&map, sizeof(bench_key), sizeof(bench_key), compare_key, 0);
+
+	start = bench_seconds();
+	for (i = 0; i < n; ++i)
+	{
+		if (!binary_tree_map_insert(&map, keys + i, keys + i))
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	result.insert = (double)n / (bench_seconds() - start) / 1e6;
+
+	start = bench_seconds();
+	for (r = 0; r < rounds; ++r)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			result.found += (binary_tree_map_find(&map, keys + ((i * 2654435761u) % n)) != 0);
+		}
+	}
+	result.find = (double)(n * rounds) / (bench_seconds() - start) / 1e6;
+
+	binary_tree_map_destroy(&map);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = 1000000;
+	size_t rounds = 3;
+	size_t i;
+	bench_key *keys;
+	rates b_tree, binary_tree;
+
+	if (argc >= 2)
+	{
+		n = (size_t)atol(argv[1]);
+	}
+	if (argc >= 3)
+	{
+		rounds = (size_t)atoi(argv[2]);
+	}
+
+	keys = malloc(sizeof(*keys) * n);
+	if (!keys)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < n; ++i)
+	{
+		keys[i] = bench_mix(i);
+	}
+
+	b_tree = bench_b_tree(keys, n, rounds);
+	binary_tree = bench_binary_tree(keys, n, rounds);
+	if (b_tree.found != binary_tree.found)
+	{
+		fprintf(stderr, "Lookup results differ\n");
+		return 1;
+	}
+
+	printf("keys: %u, rounds: %u, million operations per second\n", (unsigned)n, (unsigned)rounds);
+	printf("%-12s %10s %10s\n", "engine", "insert", "find");
+	printf("%-12s %10.2f %10.2f\n", "B+-tree", b_tree.insert, b_tree.find);
+	printf("%-12s %10.2f %10.2f\n", "binary tree", binary_tree.insert, binary_tree.find);
+	printf("B+-tree in-order scan: %.2f million keys per second\n", b_tree.scan);
+
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include "concurrent_hash_map.h"
+#include "hash_group.h"
+#include <string.h>
+#include <assert.h>
+
+
+enum
+{
+	/* high bits of the mixed hash that select a shard; the shard's table uses the low ones */
+	shard_bits = 16
+};
+
+static size_t round_up_to_power_of_two(size_t value)
+{
+	size_t result = 1;
+	while (result < value)
+	{
+		assert((result * 2) > result);
+		result *= 2;
+	}
+	return result;
+}
+
+static concurrent_hash_map_shard *shard_of(const concurrent_hash_map *map, const void *key)
+{
+	return map->shards + concurrent_hash_map_shard_of(map, key);
+}
+
+
+int concurrent_hash_map_create(
+	concurrent_hash_map *map,
+	size_t key_size,
+	size_t value_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	size_t shard_count)
+{
+	const allocator heap = heap_allocator();
+	return concurrent_hash_map_create_with_allocator(map, key_size, value_size, hash, hash_user_data, shard_count, &heap);
+}
+
+int concurrent_hash_map_create_with_allocator(
+	concurrent_hash_map *map,
+	size_t key_size,
+	size_t value_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	size_t shard_count,
+	const allocator *a)
+{
+	size_t i;
+
+	assert(shard_count > 0);
+	assert(shard_count <= ((size_t)1 << shard_bits));
+
+	map->allocator = *a;
+	map->shard_count = round_up_to_power_of_two(shard_count);
+	map->value_size = value_size;
+	map->hash = hash;
+	map->hash_user_data = hash_user_data;
+	map->shards = allocator_allocate(&map->allocator, map->shard_count * sizeof(*map->shards));
+	if (!map->shards)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < map->shard_count; ++i)
+	{
+		if (pthread_rwlock_init(&map->shards[i].lock, 0) != 0)
+		{
+			while (i > 0)
+			{
+				--i;
+				pthread_rwlock_destroy(&map->shards[i].lock);
+			}
+			allocator_deallocate(&map->allocator, map->shards, map->shard_count * sizeof(*map->shards));
+			return 0;
+		}
+		hash_map_create_with_allocator(&map->shards[i].map, key_size, value_size, hash, hash_user_data, a);
+	}
+	return 1;
+}
+
+void concurrent_hash_map_destroy(concurrent_hash_map *map)
+{
+	size_t i;
+	for (i = 0; i < map->shard_count; ++i)
+	{
+		hash_map_destroy(&map->shards[i].map);
+		pthread_rwlock_destroy(&map->shards[i].lock);
+	}
+	allocator_deallocate(&map->allocator, map->shards, map->shard_count * sizeof(*map->shards));
+}
+
+int concurrent_hash_map_reserve(concurrent_hash_map *map, size_t count)
+{
+	/* leave some headroom, the keys never spread perfectly evenly */
+	const size_t per_shard = (count / map->shard_count) + (count / map->shard_count / 8) + 1;
+	size_t i;
+
+	for (i = 0; i < map->shard_count; ++i)
+	{
+		if (!concurrent_hash_map_grow_shard(map, i, per_shard))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int concurrent_hash_map_insert(concurrent_hash_map *map, const void *key, const void *value)
+{
+	concurrent_hash_map_shard * const shard = shard_of(map, key);
+	int result;
+	pthread_rwlock_wrlock(&shard->lock);
+	result = hash_map_insert(&shard->map, key, value);
+	pthread_rwlock_unlock(&shard->lock);
+	return result;
+}
+
+int concurrent_hash_map_find(concurrent_hash_map *map, const void *key, void *value)
+{
+	concurrent_hash_map_shard * const shard = shard_of(map, key);
+	const void *found;
+	/* hash_map_find does not move elements between tables, so readers can share the shard */
+	pthread_rwlock_rdlock(&shard->lock);
+	found = hash_map_find(&shard->map, key);
+	if (found && value && map->value_size)
+	{
+		memcpy(value, found, map->value_size);
+	}
+	pthread_rwlock_unlock(&shard->lock);
+	return found != 0;
+}
+
+int concurrent_hash_map_erase(concurrent_hash_map *map, const void *key)
+{
+	concurrent_hash_map_shard * const shard = shard_of(map, key);
+	int result;
+	pthread_rwlock_wrlock(&shard->lock);
+	result = hash_map_erase(&shard->map, key);
+	pthread_rwlock_unlock(&shard->lock);
+	return result;
+}
+
+size_t concurrent_hash_map_size(concurrent_hash_map *map)
+{
+	/* shards are counted one after another, so concurrent writers make this a snapshot of no single moment */
+	size_t result = 0;
+	size_t i;
+	for (i = 0; i < map->shard_count; ++i)
+	{
+		pthread_rwlock_rdlock(&map->shards[i].lock);
+		result += hash_map_size(&map->shards[i].map);
+		pthread_rwlock_unlock(&map->shards[i].lock);
+	}
+	return result;
+}
+
+size_t concurrent_hash_map_shard_count(const concurrent_hash_map *map)
+{
+	return map->shard_count;
+}
+
+size_t concurrent_hash_map_shard_of(const concurrent_hash_map *map, const void *key)
+{
+	const hash_t code = group_mix(map->hash(key, map->hash_user_data));
+	return (size_t)(code >> (sizeof(hash_t) * 8 - shard_bits)) & (map->shard_count - 1);
+}
+
+int concurrent_hash_map_grow_shard(concurrent_hash_map *map, size_t shard, size_t count)
+{
+	int result;
+	assert(shard < map->shard_count);
+	pthread_rwlock_wrlock(&map->shards[shard].lock);
+	result = hash_map_reserve(&map->shards[shard].map, count);
+	pthread_rwlock_unlock(&map->shards[shard].lock);
+	return result;
+}
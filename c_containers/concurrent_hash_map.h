@@ -0,0 +1,74 @@
+#ifndef CONCURRENT_HASH_MAP_H
+#define CONCURRENT_HASH_MAP_H
+
+
+#include "hash_map.h"
+#include <pthread.h>
+
+
+#define CONCURRENT_HASH_MAP_CACHE_LINE 64
+
+/*
+ * One hash_map per shard with its own reader/writer lock. The trailing
+ * padding keeps the lock of a shard off the cache line of the previous
+ * shard's map, which is written on every insertion.
+ */
+typedef struct concurrent_hash_map_shard
+{
+	pthread_rwlock_t lock;
+	hash_map map;
+	char padding[CONCURRENT_HASH_MAP_CACHE_LINE];
+}
+concurrent_hash_map_shard;
+
+/*
+ * hash_map striped into a power of two number of independently locked
+ * shards, chosen by the high bits of the key's hash. Lookups take the
+ * read lock of one shard, so they run in parallel with each other and
+ * with writers to the other shards. Every shard grows on its own, so a
+ * resize only holds up the keys of that shard.
+ *
+ * Values are copied out under the lock because a pointer into a shard
+ * would not survive a concurrent insertion.
+ */
+typedef struct concurrent_hash_map
+{
+	concurrent_hash_map_shard *shards;
+	size_t shard_count;
+	size_t value_size;
+	hash_function_t hash;
+	void *hash_user_data;
+	allocator allocator;
+}
+concurrent_hash_map;
+
+
+int concurrent_hash_map_create(
+	concurrent_hash_map *map,
+	size_t key_size,
+	size_t value_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	size_t shard_count);
+/* the allocator is called from all threads that modify the map */
+int concurrent_hash_map_create_with_allocator(
+	concurrent_hash_map *map,
+	size_t key_size,
+	size_t value_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	size_t shard_count,
+	const allocator *a);
+void concurrent_hash_map_destroy(concurrent_hash_map *map);
+int concurrent_hash_map_reserve(concurrent_hash_map *map, size_t count);
+int concurrent_hash_map_insert(concurrent_hash_map *map, const void *key, const void *value);
+int concurrent_hash_map_find(concurrent_hash_map *map, const void *key, void *value);
+int concurrent_hash_map_erase(concurrent_hash_map *map, const void *key);
+size_t concurrent_hash_map_size(concurrent_hash_map *map);
+size_t concurrent_hash_map_shard_count(const concurrent_hash_map *map);
+size_t concurrent_hash_map_shard_of(const concurrent_hash_map *map, const void *key);
+/* makes room for count elements in one shard, locking only that shard */
+int concurrent_hash_map_grow_shard(concurrent_hash_map *map, size_t shard, size_t count);
+
+
+#endif
@@ -0,0 +1,198 @@
+#include "hash_functions.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+/* the constants and structure follow wyhash, final version 4, which is public domain */
+#define HASH_P0 0xa0761d6478bd642full
+#define HASH_P1 0xe7037ed1a0b428dbull
+#define HASH_P2 0x8ebc6af09c88c6e3ull
+#define HASH_P3 0x589965cc75374cc3ull
+
+
+/* 64 x 64 -> 128 bit multiplication, low half in *a and high half in *b */
+static void hash_multiply(unsigned long long *a, unsigned long long *b)
+{
+#if defined(__SIZEOF_INT128__)
+	const unsigned __int128 product = (unsigned __int128)*a * *b;
+	*a = (unsigned long long)product;
+	*b = (unsigned long long)(product >> 64);
+#else
+	const unsigned long long a_high = *a >> 32, a_low = (unsigned)*a;
+	const unsigned long long b_high = *b >> 32, b_low = (unsigned)*b;
+	const unsigned long long high = a_high * b_high, middle0 = a_high * b_low;
+	const unsigned long long middle1 = b_high * a_low, low = a_low * b_low;
+	const unsigned long long t = low + (middle0 << 32);
+	const unsigned long long carry = (t < low);
+	const unsigned long long result_low = t + (middle1 << 32);
+	*a = result_low;
+	*b = high + (middle0 >> 32) + (middle1 >> 32) + carry + (result_low < t);
+#endif
+}
+
+static unsigned long long hash_mix(unsigned long long a, unsigned long long b)
+{
+	hash_multiply(&a, &b);
+	return a ^ b;
+}
+
+/* little endian loads, so that results do not depend on alignment */
+static unsigned long long hash_read_64(const unsigned char *p)
+{
+	return (unsigned long long)p[0] |
+		((unsigned long long)p[1] << 8) |
+		((unsigned long long)p[2] << 16) |
+		((unsigned long long)p[3] << 24) |
+		((unsigned long long)p[4] << 32) |
+		((unsigned long long)p[5] << 40) |
+		((unsigned long long)p[6] << 48) |
+		((unsigned long long)p[7] << 56);
+}
+
+static unsigned long long hash_read_32(const unsigned char *p)
+{
+	return (unsigned long long)p[0] |
+		((unsigned long long)p[1] << 8) |
+		((unsigned long long)p[2] << 16) |
+		((unsigned long long)p[3] << 24);
+}
+
+/* one to three bytes */
+static unsigned long long hash_read_small(const unsigned char *p, size_t size)
+{
+	return ((unsigned long long)p[0] << 16) |
+		((unsigned long long)p[size >> 1] << 8) |
+		p[size - 1];
+}
+
+static unsigned long long hash_seed_of(const void *parameters)
+{
+	return parameters ? ((const hash_parameters *)parameters)->seed : 0;
+}
+
+
+void hash_parameters_create(hash_parameters *parameters, size_t key_size, unsigned long long seed)
+{
+	parameters->key_size = key_size;
+	parameters->seed = seed;
+}
+
+unsigned long long hash_random_seed(void)
+{
+	unsigned long long seed = 0;
+	FILE * const random = fopen("/dev/urandom", "rb");
+	if (random)
+	{
+		const size_t read = fread(&seed, 1, sizeof(seed), random);
+		fclose(random);
+		if (read == sizeof(seed))
+		{
+			return seed;
+		}
+	}
+	/* weaker fallback: the clock and where this process placed its stack and code */
+	seed = (unsigned long long)time(0);
+	seed = hash_mix(seed ^ HASH_P0, (unsigned long long)clock() ^ HASH_P1);
+	seed = hash_mix(seed ^ (unsigned long long)(size_t)&seed, (unsigned long long)(size_t)&hash_random_seed ^ HASH_P2);
+	return seed;
+}
+
+hash_t hash_bytes(const void *data, size_t size, unsigned long long seed)
+{
+	const unsigned char *p = data;
+	unsigned long long a, b;
+
+	seed ^= hash_mix(seed ^ HASH_P0, HASH_P1);
+	if (size <= 16)
+	{
+		if (size >= 4)
+		{
+			const size_t middle = (size >> 3) << 2;
+			a = (hash_read_32(p) << 32) | hash_read_32(p + middle);
+			b = (hash_read_32(p + size - 4) << 32) | hash_read_32(p + size - 4 - middle);
+		}
+		else if (size > 0)
+		{
+			a = hash_read_small(p, size);
+			b = 0;
+		}
+		else
+		{
+			a = 0;
+			b = 0;
+		}
+	}
+	else
+	{
+		size_t remaining = size;
+		if (remaining > 48)
+		{
+			/* three independent lanes keep the multipliers busy */
+			unsigned long long lane1 = seed, lane2 = seed;
+			do
+			{
+				seed = hash_mix(hash_read_64(p) ^ HASH_P1, hash_read_64(p + 8) ^ seed);
+				lane1 = hash_mix(hash_read_64(p + 16) ^ HASH_P2, hash_read_64(p + 24) ^ lane1);
+				lane2 = hash_mix(hash_read_64(p + 32) ^ HASH_P3, hash_read_64(p + 40) ^ lane2);
+				p += 48;
+				remaining -= 48;
+			}
+			while (remaining > 48);
+			seed ^= lane1 ^ lane2;
+		}
+		while (remaining > 16)
+		{
+			seed = hash_mix(hash_read_64(p) ^ HASH_P1, hash_read_64(p + 8) ^ seed);
+			p += 16;
+			remaining -= 16;
+		}
+		a = hash_read_64(p + remaining - 16);
+		b = hash_read_64(p + remaining - 8);
+	}
+
+	a ^= HASH_P1;
+	b ^= seed;
+	hash_multiply(&a, &b);
+	return (hash_t)hash_mix(a ^ HASH_P0 ^ size, b ^ HASH_P1);
+}
+
+hash_t hash_key_32(const void *key, void *parameters)
+{
+	unsigned key32;
+	unsigned long long value;
+	memcpy(&key32, key, sizeof(key32));
+	value = key32;
+	/* the key goes into both halves so that all of its bits reach the high
+	   half of the product, and the seed gets a second round as in hash_key_64 */
+	return (hash_t)hash_mix(HASH_P1 ^ sizeof(key32), hash_mix((value | (value << 32)) ^ HASH_P1, value ^ hash_seed_of(parameters) ^ HASH_P0));
+}
+
+hash_t hash_key_64(const void *key, void *parameters)
+{
+	unsigned long long value;
+	memcpy(&value, key, sizeof(value));
+	/* the key against its own swapped halves and the seed, then a second
+	   round as in wyhash, because a single product left the low bits
+	   poorly spread for some seeds */
+	return (hash_t)hash_mix(HASH_P1 ^ sizeof(value), hash_mix(value ^ HASH_P1, ((value >> 32) | (value << 32)) ^ hash_seed_of(parameters) ^ HASH_P0));
+}
+
+hash_t hash_key_bytes(const void *key, void *parameters)
+{
+	const hash_parameters *p = parameters;
+	return hash_bytes(key, p->key_size, p->seed);
+}
+
+hash_function_t hash_function_for_size(size_t key_size)
+{
+	if (key_size == 4)
+	{
+		return hash_key_32;
+	}
+	if (key_size == 8)
+	{
+		return hash_key_64;
+	}
+	return hash_key_bytes;
+}
@@ -0,0 +1,40 @@
+#ifndef HASH_FUNCTIONS_H
+#define HASH_FUNCTIONS_H
+
+
+#include "hash_map.h"
+
+
+/*
+ * Parameters of the built-in hash functions, passed as the hash user data
+ * of a hash_map, hash_set or concurrent_hash_map. A secret seed, for
+ * example from hash_random_seed, keeps an attacker who controls the keys
+ * from predicting collisions.
+ */
+typedef struct hash_parameters
+{
+	size_t key_size;
+	unsigned long long seed;
+}
+hash_parameters;
+
+
+void hash_parameters_create(hash_parameters *parameters, size_t key_size, unsigned long long seed);
+unsigned long long hash_random_seed(void);
+
+/* wyhash, for any number of bytes */
+hash_t hash_bytes(const void *data, size_t size, unsigned long long seed);
+
+/*
+ * hash_function_t implementations. The fixed size ones accept null
+ * parameters, meaning seed 0. hash_key_bytes needs parameters for the size.
+ */
+hash_t hash_key_32(const void *key, void *parameters);
+hash_t hash_key_64(const void *key, void *parameters);
+hash_t hash_key_bytes(const void *key, void *parameters);
+
+/* the fastest of the above for keys of key_size bytes */
+hash_function_t hash_function_for_size(size_t key_size);
+
+
+#endif
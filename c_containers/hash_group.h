@@ -0,0 +1,179 @@
+#ifndef HASH_GROUP_H
+#define HASH_GROUP_H
+
+
+/*
+ * Control byte groups shared by the open addressing tables of hash_map and
+ * hash_set. Every slot has one control byte: empty, deleted, or the high
+ * bit plus seven bits of the hash of the occupant. Lookups compare a whole
+ * group of control bytes at once. Only for inclusion by the table sources.
+ */
+
+#include "hash_map.h"
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#	define HASH_GROUP_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#	define HASH_GROUP_PREFETCH(address) __builtin_prefetch(address)
+#else
+#	define HASH_GROUP_PREFETCH(address) ((void)(address))
+#endif
+
+
+enum
+{
+	control_empty = 0x00,
+	control_deleted = 0x01,
+	control_full = 0x80,
+	tag_mask = 0x7F,
+	group_width = 16
+};
+
+/* one bit per control byte of a group, lowest bit for the first slot */
+typedef unsigned group_mask;
+
+#ifdef HASH_GROUP_SSE2
+
+static inline group_mask group_match(const unsigned char *group, unsigned char tag)
+{
+	const __m128i controls = _mm_loadu_si128((const __m128i *)group);
+	return (group_mask)_mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8((char)tag)));
+}
+
+static inline group_mask group_match_empty_or_deleted(const unsigned char *group)
+{
+	/* occupied slots are the only ones with the high bit set */
+	const __m128i controls = _mm_loadu_si128((const __m128i *)group);
+	return (group_mask)_mm_movemask_epi8(controls) ^ 0xFFFFu;
+}
+
+#else
+
+static inline group_mask group_match(const unsigned char *group, unsigned char tag)
+{
+	group_mask result = 0;
+	size_t i;
+	for (i = 0; i < group_width; ++i)
+	{
+		result |= (group_mask)(group[i] == tag) << i;
+	}
+	return result;
+}
+
+static inline group_mask group_match_empty_or_deleted(const unsigned char *group)
+{
+	group_mask result = 0;
+	size_t i;
+	for (i = 0; i < group_width; ++i)
+	{
+		result |= (group_mask)!(group[i] & control_full) << i;
+	}
+	return result;
+}
+
+#endif
+
+static inline group_mask group_match_empty(const unsigned char *group)
+{
+	return group_match(group, control_empty);
+}
+
+static inline size_t group_mask_lowest(group_mask mask)
+{
+	assert(mask);
+#if defined(__GNUC__)
+	return (size_t)__builtin_ctz(mask);
+#else
+	{
+		size_t index = 0;
+		while (!(mask & 1))
+		{
+			mask >>= 1;
+			++index;
+		}
+		return index;
+	}
+#endif
+}
+
+/* number of consecutive zero bits from the top of a group mask */
+static inline size_t group_mask_leading_zeros(group_mask mask)
+{
+#if defined(__GNUC__)
+	return mask ? ((size_t)__builtin_clz(mask) - (sizeof(mask) * 8 - group_width)) : group_width;
+#else
+	size_t count = 0;
+	while ((count < group_width) &&
+		!(mask & (1u << (group_width - 1 - count))))
+	{
+		++count;
+	}
+	return count;
+#endif
+}
+
+static inline size_t group_mask_trailing_zeros(group_mask mask)
+{
+	return mask ? group_mask_lowest(mask) : group_width;
+}
+
+static inline hash_t group_mix(hash_t code)
+{
+	/* user hashes are often weak in the low bits which select the slot */
+	code *= (hash_t)0x9E3779B97F4A7C15ull;
+	code ^= code >> (sizeof(code) * 4);
+	return code;
+}
+
+static inline unsigned char group_tag(hash_t code)
+{
+	return (unsigned char)(control_full | (code & tag_mask));
+}
+
+static inline int group_is_full(unsigned char control)
+{
+	return (control & control_full) != 0;
+}
+
+static inline int group_is_overloaded(size_t used, size_t bucket_count)
+{
+	return (used * 8) >= (bucket_count * 7);
+}
+
+static inline size_t group_home(hash_t code, size_t bucket_count)
+{
+	return (size_t)(code >> 7) & (bucket_count - 1);
+}
+
+/* bucket_count control bytes followed by a mirror of the first group_width - 1 */
+static inline size_t group_control_size(size_t bucket_count)
+{
+	return bucket_count + group_width - 1;
+}
+
+static inline void group_set_control(unsigned char *control, size_t bucket_count, size_t slot, unsigned char value)
+{
+	const size_t mask = bucket_count - 1;
+	control[slot] = value;
+	control[((slot - (group_width - 1)) & mask) + (group_width - 1)] = value;
+}
+
+/*
+ * Control byte for a slot that is being erased. The slot may become empty
+ * again only if every group_width wide window containing it has an empty
+ * slot, because then no probe ever went past it.
+ */
+static inline unsigned char group_erased_control(const unsigned char *control, size_t bucket_count, size_t slot)
+{
+	const size_t before = (slot - group_width) & (bucket_count - 1);
+	const size_t full_before = group_mask_leading_zeros(group_match_empty(control + before));
+	const size_t full_after = group_mask_trailing_zeros(group_match_empty(control + slot));
+	return ((full_before + full_after) < group_width) ? control_empty : control_deleted;
+}
+
+
+#endif
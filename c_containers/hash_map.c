@@ -1,103 +1,266 @@
 #include "hash_map.h"
+#include "hash_group.h"
 #include <string.h>
 #include <assert.h>
-#include <stdlib.h>
 
 
-struct hash_map_entry
+enum
 {
-	void *data;
+	slot_alignment = 16,
+	drain_step = 8,
+	insert_batch = 32
 };
 
-struct hash_map_bucket
+static hash_t hash_map_code(const hash_map *map, const void *key)
 {
-	hash_map_entry *entries;
-	size_t count;
-};
+	return group_mix(map->hash(key, map->hash_user_data));
+}
+
+static size_t hash_map_slot_size(const hash_map *map)
+{
+	return map->key_size + map->value_size;
+}
+
+static char *table_slot(const hash_map *map, const hash_map_table *table, size_t index)
+{
+	return table->slots + (index * hash_map_slot_size(map));
+}
+
+static size_t table_home(const hash_map_table *table, hash_t code)
+{
+	return group_home(code, table->bucket_count);
+}
+
+static size_t table_align(size_t size)
+{
+	return (size + (slot_alignment - 1)) & ~(size_t)(slot_alignment - 1);
+}
+
+static void table_create(hash_map_table *table)
+{
+	table->control = 0;
+	table->codes = 0;
+	table->slots = 0;
+	table->bucket_count = 0;
+	table->elements = 0;
+	table->tombstones = 0;
+}
+
+static size_t table_control_size(size_t bucket_count)
+{
+	return table_align(group_control_size(bucket_count));
+}
 
-static int hash_map_entry_create(
-	hash_map_entry *entry,
-	const void *key, size_t key_size,
-	const void *value, size_t value_size)
+static size_t table_codes_size(size_t bucket_count)
 {
-	entry->data = malloc(key_size + value_size);
-	if (!entry->data)
+	return table_align(bucket_count * sizeof(hash_t));
+}
+
+static size_t table_memory_size(const hash_map *map, size_t bucket_count)
+{
+	return table_control_size(bucket_count) +
+		table_codes_size(bucket_count) +
+		(bucket_count * hash_map_slot_size(map));
+}
+
+static void table_destroy(const hash_map *map, hash_map_table *table)
+{
+	if (table->bucket_count)
+	{
+		allocator_deallocate(&map->allocator, table->control, table_memory_size(map, table->bucket_count));
+	}
+}
+
+static int table_allocate(const hash_map *map, hash_map_table *table, size_t bucket_count)
+{
+	const size_t control_size = table_control_size(bucket_count);
+	const size_t codes_size = table_codes_size(bucket_count);
+	char *memory;
+
+	/*
+	 * control_empty is zero so that large tables come straight from zeroed
+	 * pages and growing does not have to touch every new slot up front
+	 */
+	memory = allocator_allocate_zeroed(&map->allocator, table_memory_size(map, bucket_count));
+	if (!memory)
 	{
 		return 0;
 	}
-	memcpy(entry->data, key, key_size);
-	memcpy(((char *)entry->data) + key_size, value, value_size);
+	table->control = (unsigned char *)memory;
+	table->codes = (hash_t *)(memory + control_size);
+	table->slots = memory + control_size + codes_size;
+	table->bucket_count = bucket_count;
+	table->elements = 0;
+	table->tombstones = 0;
 	return 1;
 }
 
-static void hash_map_entry_destroy(hash_map_entry *entry)
+static void table_set_control(hash_map_table *table, size_t slot, unsigned char control)
+{
+	group_set_control(table->control, table->bucket_count, slot, control);
+}
+
+/*
+ * Returns 1 and the slot of the key if it is present. Otherwise returns 0
+ * and the first slot along the probe sequence that an insertion can reuse.
+ * The probe looks at group_width control bytes at a time.
+ */
+static int table_probe(const hash_map *map, const hash_map_table *table, const void *key, hash_t code, size_t *slot)
+{
+	const size_t mask = table->bucket_count - 1;
+	const unsigned char tag = group_tag(code);
+	size_t index = table_home(table, code);
+	size_t reusable = table->bucket_count;
+
+	for (;;)
+	{
+		const unsigned char *group = table->control + index;
+		group_mask candidates = group_match(group, tag);
+		while (candidates)
+		{
+			const size_t candidate = (index + group_mask_lowest(candidates)) & mask;
+			if ((table->codes[candidate] == code) &&
+				!memcmp(table_slot(map, table, candidate), key, map->key_size))
+			{
+				*slot = candidate;
+				return 1;
+			}
+			candidates &= candidates - 1;
+		}
+		if (reusable == table->bucket_count)
+		{
+			const group_mask free_slots = group_match_empty_or_deleted(group);
+			if (free_slots)
+			{
+				reusable = (index + group_mask_lowest(free_slots)) & mask;
+			}
+		}
+		if (group_match_empty(group))
+		{
+			*slot = reusable;
+			return 0;
+		}
+		index = (index + group_width) & mask;
+	}
+}
+
+/* first reusable slot for a key that is known to be absent */
+static size_t table_find_free(const hash_map_table *table, hash_t code)
 {
-	free(entry->data);
+	const size_t mask = table->bucket_count - 1;
+	size_t index = table_home(table, code);
+	for (;;)
+	{
+		const group_mask free_slots = group_match_empty_or_deleted(table->control + index);
+		if (free_slots)
+		{
+			return (index + group_mask_lowest(free_slots)) & mask;
+		}
+		index = (index + group_width) & mask;
+	}
 }
 
-static void hash_map_bucket_create(hash_map_bucket *bucket)
+static char *table_place(const hash_map *map, hash_map_table *table, size_t slot, hash_t code)
 {
-	bucket->entries = 0;
-	bucket->count = 0;
+	if (table->control[slot] == control_deleted)
+	{
+		assert(table->tombstones);
+		--(table->tombstones);
+	}
+	table_set_control(table, slot, group_tag(code));
+	table->codes[slot] = code;
+	++(table->elements);
+	return table_slot(map, table, slot);
 }
 
-static void hash_map_bucket_destroy(hash_map_bucket *bucket)
+static void table_erase(hash_map_table *table, size_t slot)
 {
-	size_t i;
-	for (i = 0; i < bucket->count; ++i)
+	const unsigned char control = group_erased_control(table->control, table->bucket_count, slot);
+	table_set_control(table, slot, control);
+	if (control == control_deleted)
 	{
-		hash_map_entry *entry = bucket->entries + i;
-		hash_map_entry_destroy(entry);
+		++(table->tombstones);
 	}
-	free(bucket->entries);
+	assert(table->elements);
+	--(table->elements);
 }
 
-static hash_map_entry *hash_map_bucket_get(hash_map_bucket *bucket, const void *key, size_t key_size)
+static void hash_map_store(const hash_map *map, char *destination, const void *key, const void *value)
 {
-	size_t i;
-	for (i = 0; i < bucket->count; ++i)
+	memcpy(destination, key, map->key_size);
+	if (map->value_size)
 	{
-		hash_map_entry *entry = bucket->entries + i;
-		if (!memcmp(entry->data, key, key_size))
+		memcpy(destination + map->key_size, value, map->value_size);
+	}
+}
+
+/* moves up to slot_count slots of the draining table into the current one */
+static void hash_map_drain(hash_map *map, size_t slot_count)
+{
+	hash_map_table * const draining = &map->draining;
+	const size_t slot_size = hash_map_slot_size(map);
+	size_t end;
+
+	if (!draining->bucket_count)
+	{
+		return;
+	}
+
+	end = draining->bucket_count;
+	if (slot_count < (end - map->drained))
+	{
+		end = map->drained + slot_count;
+	}
+
+	for (; map->drained < end; ++(map->drained))
+	{
+		const size_t i = map->drained;
+		if (group_is_full(draining->control[i]))
 		{
-			return entry;
+			const hash_t code = draining->codes[i];
+			char * const destination = table_place(map, &map->table, table_find_free(&map->table, code), code);
+			memcpy(destination, table_slot(map, draining, i), slot_size);
+			/* a tombstone keeps the probe sequences of the remaining slots intact */
+			table_set_control(draining, i, control_deleted);
+			--(draining->elements);
 		}
 	}
-	return 0;
+
+	if ((map->drained == draining->bucket_count) ||
+		!draining->elements)
+	{
+		assert(!draining->elements);
+		table_destroy(map, draining);
+		table_create(draining);
+		map->drained = 0;
+	}
 }
 
-static int hash_map_bucket_add(
-	hash_map_bucket *bucket,
-	const void *key,
-	size_t key_size,
-	const void *value,
-	size_t value_size)
+/* makes the current table a draining one and allocates a new current table */
+static int hash_map_migrate(hash_map *map, size_t bucket_count)
 {
-	hash_map_entry *entries = realloc(bucket->entries, sizeof(*entries) * (bucket->count + 1));
-	if (!entries)
+	hash_map_table resized;
+	const size_t elements = hash_map_size(map);
+	size_t capacity = group_width;
+
+	assert(!map->draining.bucket_count);
+
+	while ((capacity < bucket_count) ||
+		group_is_overloaded(elements, capacity))
 	{
-		return 0;
+		assert((capacity * 2) > capacity);
+		capacity *= 2;
 	}
-	if (!hash_map_entry_create(
-		entries + bucket->count,
-		key,
-		key_size,
-		value,
-		value_size))
+
+	if (!table_allocate(map, &resized, capacity))
 	{
 		return 0;
 	}
-	bucket->entries = entries;
-	++(bucket->count);
-	return 1;
-}
 
-static void hash_map_bucket_clear(
-	hash_map_bucket *bucket)
-{
-	hash_map_bucket_destroy(bucket);
-	bucket->entries = 0;
-	bucket->count = 0;
+	map->draining = map->table;
+	map->table = resized;
+	map->drained = 0;
+	return 1;
 }
 
 
@@ -105,52 +268,40 @@ hash_map_iterator hash_map_iterate(const hash_map *map)
 {
 	hash_map_iterator iterator;
 	iterator.map = map;
-	iterator.bucket = map->buckets;
-	iterator.entry = 0;
+	iterator.table = &map->table;
+	iterator.slot = (size_t)-1;
 	return iterator;
 }
 
 const void *hash_map_iterator_key(const hash_map_iterator *iterator)
 {
-	return iterator->entry->data;
+	return table_slot(iterator->map, iterator->table, iterator->slot);
 }
 
 const void *hash_map_iterator_value(const hash_map_iterator *iterator)
 {
-	return ((const char *)iterator->entry->data) + iterator->map->key_size;
+	return table_slot(iterator->map, iterator->table, iterator->slot) + iterator->map->key_size;
 }
 
 int hash_map_iterator_next(hash_map_iterator *iterator)
 {
-	if (iterator->entry)
+	for (;;)
 	{
-		++(iterator->entry);
-		while (iterator->entry == iterator->bucket->entries + iterator->bucket->count)
+		const hash_map_table * const table = iterator->table;
+		for (++(iterator->slot); iterator->slot < table->bucket_count; ++(iterator->slot))
 		{
-			++(iterator->bucket);
-			if (iterator->bucket == iterator->map->buckets + iterator->map->bucket_count)
+			if (group_is_full(table->control[iterator->slot]))
 			{
-				return 0;
+				return 1;
 			}
-			iterator->entry = iterator->bucket->entries;
 		}
-		return 1;
-	}
-	else
-	{
-		do 
+		if (table == &iterator->map->draining)
 		{
-			if (iterator->bucket == iterator->map->buckets + iterator->map->bucket_count)
-			{
-				return 0;
-			}
-			iterator->entry = iterator->bucket->entries;
-			if (!iterator->entry)
-			{
-				++(iterator->bucket);
-			}
-		} while (!iterator->entry);
-		return 1;
+			iterator->slot = table->bucket_count;
+			return 0;
+		}
+		iterator->table = &iterator->map->draining;
+		iterator->slot = (size_t)-1;
 	}
 }
 
@@ -161,183 +312,249 @@ void hash_map_create(
 	hash_function_t hash,
 	void *hash_user_data)
 {
-	map->buckets = 0;
+	const allocator heap = heap_allocator();
+	hash_map_create_with_allocator(map, key_size, value_size, hash, hash_user_data, &heap);
+}
+
+void hash_map_create_with_allocator(
+	hash_map *map,
+	size_t key_size,
+	size_t value_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	const allocator *a)
+{
+	map->allocator = *a;
+	table_create(&map->table);
+	table_create(&map->draining);
+	map->drained = 0;
 	map->key_size = key_size;
 	map->value_size = value_size;
-	map->elements = 0;
-	map->bucket_count = 0;
 	map->hash = hash;
 	map->hash_user_data = hash_user_data;
 }
 
 void hash_map_destroy(hash_map *map)
 {
-	size_t i;
-	for (i = 0; i < map->bucket_count; ++i)
-	{
-		hash_map_bucket_destroy(map->buckets + i);
-	}
-	free(map->buckets);
+	table_destroy(map, &map->table);
+	table_destroy(map, &map->draining);
 }
 
 int hash_map_resize(hash_map *map, size_t bucket_count)
 {
-	hash_map resized;
-	size_t i;
-	hash_map_iterator iterator;
-
 	assert(map);
 	assert(bucket_count > 0);
 
-	hash_map_create(&resized, map->key_size, map->value_size, map->hash, map->hash_user_data);
-	resized.buckets = malloc(sizeof(*resized.buckets) * bucket_count);
-	if (!resized.buckets)
+	hash_map_drain(map, (size_t)-1);
+	if (!hash_map_migrate(map, bucket_count))
 	{
-		hash_map_destroy(&resized);
 		return 0;
 	}
-	for (i = 0; i < bucket_count; ++i)
-	{
-		hash_map_bucket_create(resized.buckets + i);
-	}
-	resized.bucket_count = bucket_count;
+	hash_map_drain(map, (size_t)-1);
+	return 1;
+}
+
+int hash_map_reserve(hash_map *map, size_t count)
+{
+	size_t bucket_count = group_width;
 
-	iterator = hash_map_iterate(map);
+	/* a bulk load is about to touch the table anyway, so stop migrating now */
+	hash_map_drain(map, (size_t)-1);
 
-	while (hash_map_iterator_next(&iterator))
+	if (map->table.bucket_count &&
+		!group_is_overloaded(count + map->table.tombstones + 1, map->table.bucket_count))
 	{
-		const void *key = hash_map_iterator_key(&iterator);
-		const void *value = hash_map_iterator_value(&iterator);
-		if (!hash_map_insert(&resized, key, value))
-		{
-			hash_map_destroy(&resized);
-			return 0;
-		}
+		return 1;
 	}
 
-	hash_map_destroy(map);
-	*map = resized;
-	return 1;
+	while (group_is_overloaded(count + 1, bucket_count))
+	{
+		assert((bucket_count * 2) > bucket_count);
+		bucket_count *= 2;
+	}
+	return hash_map_resize(map, bucket_count);
 }
 
 int hash_map_grow(hash_map *map)
 {
-	if (map->elements >= map->bucket_count)
+	hash_map_drain(map, drain_step);
+
+	if (!map->table.bucket_count ||
+		group_is_overloaded(hash_map_size(map) + map->table.tombstones + 1, map->table.bucket_count))
 	{
-		size_t new_size = map->elements * 2;
-		assert(!new_size || (new_size > map->elements));
+		size_t new_size = hash_map_size(map) * 2;
+		assert(!new_size || (new_size > hash_map_size(map)));
+
+		/* never shrink, so that draining finishes before the new table fills up */
+		if (new_size < map->table.bucket_count)
+		{
+			new_size = map->table.bucket_count;
+		}
 
-		if (new_size < 4)
+		/* only happens when erasures pile up tombstones faster than draining */
+		hash_map_drain(map, (size_t)-1);
+
+		if (!hash_map_migrate(map, new_size))
 		{
-			new_size = 4; 
+			return 0;
 		}
-		return hash_map_resize(map, new_size);
+		hash_map_drain(map, drain_step);
 	}
 	return 1;
 }
 
 hash_map_bucket *hash_map_find_bucket(const hash_map *map, const void *key)
 {
-	if (!map->bucket_count)
+	if (!map->table.bucket_count)
 	{
 		return 0;
 	}
 	else
 	{
-		const hash_t code = map->hash(key, map->hash_user_data);
-		hash_map_bucket *bucket = map->buckets + (code % map->bucket_count);
-		return bucket;
+		const hash_t code = hash_map_code(map, key);
+		size_t slot;
+		if (map->draining.elements &&
+			table_probe(map, &map->draining, key, code, &slot))
+		{
+			return (hash_map_bucket *)table_slot(map, &map->draining, slot);
+		}
+		table_probe(map, &map->table, key, code, &slot);
+		return (hash_map_bucket *)table_slot(map, &map->table, slot);
 	}
 }
 
 int hash_map_insert(hash_map *map, const void *key, const void *value)
 {
-	hash_map_bucket *bucket;
+	hash_t code;
+	size_t slot;
+	char *destination;
 	if (!hash_map_grow(map))
 	{
 		return 0;
 	}
-	bucket = hash_map_find_bucket(map, key);
-	if (hash_map_bucket_get(bucket, key, map->key_size))
+	code = hash_map_code(map, key);
+	if (map->draining.elements &&
+		table_probe(map, &map->draining, key, code, &slot))
 	{
 		return 1;
 	}
-	else
+	if (table_probe(map, &map->table, key, code, &slot))
+	{
+		return 1;
+	}
+	destination = table_place(map, &map->table, slot, code);
+	hash_map_store(map, destination, key, value);
+	return 1;
+}
+
+int hash_map_insert_n(hash_map *map, const void *keys, const void *values, size_t count)
+{
+	const char *key = keys;
+	const char *value = values;
+	hash_t codes[insert_batch];
+	size_t begin;
+
+	if (!hash_map_reserve(map, hash_map_size(map) + count))
+	{
+		return 0;
+	}
+	assert(!map->draining.bucket_count);
+
+	for (begin = 0; begin < count; begin += insert_batch)
 	{
-		if (hash_map_bucket_add(bucket, key, map->key_size, value, map->value_size))
+		const size_t batch = ((count - begin) < insert_batch) ? (count - begin) : insert_batch;
+		const char *batch_key = key;
+		size_t i;
+
+		/* hash the whole batch first so that the slots are in cache when inserting */
+		for (i = 0; i < batch; ++i, batch_key += map->key_size)
 		{
-			++(map->elements);
-			return 1;
+			const size_t home = table_home(&map->table, codes[i] = hash_map_code(map, batch_key));
+			HASH_GROUP_PREFETCH(map->table.control + home);
+			HASH_GROUP_PREFETCH(map->table.codes + home);
+			HASH_GROUP_PREFETCH(table_slot(map, &map->table, home));
+		}
+
+		for (i = 0; i < batch; ++i, key += map->key_size)
+		{
+			size_t slot;
+			if (!table_probe(map, &map->table, key, codes[i], &slot))
+			{
+				hash_map_store(map, table_place(map, &map->table, slot, codes[i]), key, value);
+			}
+			if (map->value_size)
+			{
+				value += map->value_size;
+			}
 		}
-		return 0;
 	}
+	return 1;
 }
 
 const void *hash_map_find(const hash_map *map, const void *key)
 {
-	hash_map_bucket *bucket = hash_map_find_bucket(map, key);
-	hash_map_entry *entry;
-	if (!bucket)
+	hash_t code;
+	size_t slot;
+	if (!hash_map_size(map))
 	{
 		return 0;
 	}
-	entry = hash_map_bucket_get(bucket, key, map->key_size);
-	if (!entry)
+	code = hash_map_code(map, key);
+	if (map->table.elements &&
+		table_probe(map, &map->table, key, code, &slot))
 	{
-		return 0;
+		return table_slot(map, &map->table, slot) + map->key_size;
 	}
-	return ((char *)entry->data) + map->key_size;
+	if (map->draining.elements &&
+		table_probe(map, &map->draining, key, code, &slot))
+	{
+		return table_slot(map, &map->draining, slot) + map->key_size;
+	}
+	return 0;
 }
 
 int hash_map_erase(hash_map *map, const void *key)
 {
-	hash_map_bucket *bucket = hash_map_find_bucket(map, key);
-	hash_map_entry *entry;
-	hash_map_entry entry_copy;
-	hash_map_entry *back;
-	hash_map_entry *new_entries;
-	if (!bucket)
+	hash_t code;
+	size_t slot;
+	if (!hash_map_size(map))
 	{
 		return 0;
 	}
-	entry = hash_map_bucket_get(bucket, key, map->key_size);
-	if (!entry)
+	code = hash_map_code(map, key);
+	if (map->table.elements &&
+		table_probe(map, &map->table, key, code, &slot))
 	{
-		return 0;
+		table_erase(&map->table, slot);
 	}
-	entry_copy = *entry;
-	back = bucket->entries + (bucket->count - 1);
-	if (entry != back)
+	else if (map->draining.elements &&
+		table_probe(map, &map->draining, key, code, &slot))
 	{
-		*entry = *back;
+		table_set_control(&map->draining, slot, control_deleted);
+		--(map->draining.elements);
 	}
-	new_entries = realloc(bucket->entries, sizeof(*new_entries) * (bucket->count - 1));
-	if (!new_entries &&
-		(bucket->count > 1))
+	else
 	{
-		*back = entry_copy;
 		return 0;
 	}
-	hash_map_entry_destroy(&entry_copy);
-	bucket->entries = new_entries;
-	--(bucket->count);
-	assert(map->elements);
-	--(map->elements);
+	hash_map_drain(map, drain_step);
 	return 1;
 }
 
 size_t hash_map_size(const hash_map *map)
 {
-	return map->elements;
+	return map->table.elements + map->draining.elements;
 }
 
 void hash_map_clear(hash_map *map)
 {
-	size_t b;
-	for (b = 0; b < map->bucket_count; ++b)
+	table_destroy(map, &map->draining);
+	table_create(&map->draining);
+	map->drained = 0;
+	if (map->table.bucket_count)
 	{
-		hash_map_bucket *bucket = map->buckets + b;
-		hash_map_bucket_clear(bucket);
+		memset(map->table.control, control_empty, group_control_size(map->table.bucket_count));
 	}
-	map->elements = 0;
+	map->table.elements = 0;
+	map->table.tombstones = 0;
 }
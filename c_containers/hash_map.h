@@ -2,31 +2,53 @@
 #define HASH_MAP_H
 
 
+#include "allocator.h"
 #include <stddef.h>
 
 
 typedef size_t hash_t;
 typedef struct hash_map_bucket hash_map_bucket;
-typedef struct hash_map_entry hash_map_entry;
 typedef hash_t (*hash_function_t)(const void *, void *);
 
+/*
+ * Open addressing table in one allocation: bucket_count control bytes
+ * (empty, deleted or seven bits of the hash of the occupant), the cached
+ * hash code of every slot, then the slots with key and value stored inline.
+ */
+typedef struct hash_map_table
+{
+	unsigned char *control;
+	hash_t *codes;
+	char *slots;
+	size_t bucket_count;
+	size_t elements;
+	size_t tombstones;
+}
+hash_map_table;
+
+/*
+ * Growing allocates a larger table and moves the elements of the previous
+ * one over a few slots at a time during later insertions and erasures.
+ * Until it is drained, lookups search both tables.
+ */
 typedef struct hash_map
 {
-	hash_map_bucket *buckets;
+	hash_map_table table;
+	hash_map_table draining;
+	size_t drained;
 	size_t key_size;
 	size_t value_size;
-	size_t elements;
-	size_t bucket_count;
 	hash_function_t hash;
 	void *hash_user_data;
+	allocator allocator;
 }
 hash_map;
 
 typedef struct hash_map_iterator
 {
 	const hash_map *map;
-	const hash_map_bucket *bucket;
-	const hash_map_entry *entry;
+	const hash_map_table *table;
+	size_t slot;
 }
 hash_map_iterator;
 
@@ -40,11 +62,20 @@ void hash_map_create(
 	size_t value_size,
 	hash_function_t hash,
 	void *hash_user_data);
+void hash_map_create_with_allocator(
+	hash_map *map,
+	size_t key_size,
+	size_t value_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	const allocator *a);
 void hash_map_destroy(hash_map *map);
 int hash_map_resize(hash_map *map, size_t bucket_count);
+int hash_map_reserve(hash_map *map, size_t count);
 int hash_map_grow(hash_map *map);
 hash_map_bucket *hash_map_find_bucket(const hash_map *map, const void *key);
 int hash_map_insert(hash_map *map, const void *key, const void *value);
+int hash_map_insert_n(hash_map *map, const void *keys, const void *values, size_t count);
 const void *hash_map_find(const hash_map *map, const void *key);
 int hash_map_erase(hash_map *map, const void *key);
 size_t hash_map_size(const hash_map *map);
@@ -1,19 +1,334 @@
 #include "hash_set.h"
+#include "hash_group.h"
+#include <string.h>
+#include <assert.h>
+
+
+enum
+{
+	batch_size = 32
+};
+
+/* occupied slots of a set read in order, together with the hash codes of their keys */
+typedef struct hash_set_batch
+{
+	const char *keys[batch_size];
+	hash_t codes[batch_size];
+	size_t count;
+}
+hash_set_batch;
+
+static hash_t hash_set_code(const hash_set *set, const void *key)
+{
+	return group_mix(set->hash(key, set->hash_user_data));
+}
+
+static int hash_set_same_hash(const hash_set *left, const hash_set *right)
+{
+	return (left->hash == right->hash) &&
+		(left->hash_user_data == right->hash_user_data);
+}
+
+static char *hash_set_slot(const hash_set *set, size_t index)
+{
+	return set->keys + (index * set->key_size);
+}
+
+static size_t hash_set_memory_size(const hash_set *set, size_t bucket_count)
+{
+	return allocator_align(group_control_size(bucket_count)) + (bucket_count * set->key_size);
+}
+
+static void hash_set_release(hash_set *set)
+{
+	if (set->bucket_count)
+	{
+		allocator_deallocate(&set->allocator, set->control, hash_set_memory_size(set, set->bucket_count));
+	}
+	set->control = 0;
+	set->keys = 0;
+	set->bucket_count = 0;
+	set->elements = 0;
+	set->tombstones = 0;
+}
+
+/* same as table_probe of hash_map, but only the tag guards the key comparison */
+static int hash_set_probe(const hash_set *set, const void *key, hash_t code, size_t *slot)
+{
+	const size_t mask = set->bucket_count - 1;
+	const unsigned char tag = group_tag(code);
+	size_t index = group_home(code, set->bucket_count);
+	size_t reusable = set->bucket_count;
+
+	for (;;)
+	{
+		const unsigned char *group = set->control + index;
+		group_mask candidates = group_match(group, tag);
+		while (candidates)
+		{
+			const size_t candidate = (index + group_mask_lowest(candidates)) & mask;
+			if (!memcmp(hash_set_slot(set, candidate), key, set->key_size))
+			{
+				*slot = candidate;
+				return 1;
+			}
+			candidates &= candidates - 1;
+		}
+		if (reusable == set->bucket_count)
+		{
+			const group_mask free_slots = group_match_empty_or_deleted(group);
+			if (free_slots)
+			{
+				reusable = (index + group_mask_lowest(free_slots)) & mask;
+			}
+		}
+		if (group_match_empty(group))
+		{
+			*slot = reusable;
+			return 0;
+		}
+		index = (index + group_width) & mask;
+	}
+}
+
+static int hash_set_find(const hash_set *set, const void *key, hash_t code)
+{
+	size_t slot;
+	return set->elements && hash_set_probe(set, key, code, &slot);
+}
+
+static void hash_set_place(hash_set *set, size_t slot, const void *key, hash_t code)
+{
+	if (set->control[slot] == control_deleted)
+	{
+		assert(set->tombstones);
+		--(set->tombstones);
+	}
+	group_set_control(set->control, set->bucket_count, slot, group_tag(code));
+	memcpy(hash_set_slot(set, slot), key, set->key_size);
+	++(set->elements);
+}
+
+static void hash_set_erase_slot(hash_set *set, size_t slot)
+{
+	const unsigned char control = group_erased_control(set->control, set->bucket_count, slot);
+	group_set_control(set->control, set->bucket_count, slot, control);
+	if (control == control_deleted)
+	{
+		++(set->tombstones);
+	}
+	assert(set->elements);
+	--(set->elements);
+}
+
+/* moves every key into a table of at least bucket_count slots, dropping the tombstones */
+static int hash_set_rehash(hash_set *set, size_t bucket_count)
+{
+	hash_set resized = *set;
+	size_t capacity = group_width;
+	size_t i;
+	char *memory;
+
+	while ((capacity < bucket_count) ||
+		group_is_overloaded(set->elements, capacity))
+	{
+		assert((capacity * 2) > capacity);
+		capacity *= 2;
+	}
+
+	/* control_empty is zero, see table_allocate of hash_map */
+	memory = allocator_allocate_zeroed(&set->allocator, hash_set_memory_size(set, capacity));
+	if (!memory)
+	{
+		return 0;
+	}
+	resized.control = (unsigned char *)memory;
+	resized.keys = memory + allocator_align(group_control_size(capacity));
+	resized.bucket_count = capacity;
+	resized.elements = 0;
+	resized.tombstones = 0;
+
+	for (i = 0; i < set->bucket_count; ++i)
+	{
+		if (group_is_full(set->control[i]))
+		{
+			const char *key = hash_set_slot(set, i);
+			const hash_t code = hash_set_code(set, key);
+			size_t slot;
+			hash_set_probe(&resized, key, code, &slot);
+			hash_set_place(&resized, slot, key, code);
+		}
+	}
+
+	hash_set_release(set);
+	*set = resized;
+	return 1;
+}
+
+static int hash_set_insert_code(hash_set *set, const void *key, hash_t code)
+{
+	size_t slot;
+	if (!hash_set_grow(set))
+	{
+		return 0;
+	}
+	if (!hash_set_probe(set, key, code, &slot))
+	{
+		hash_set_place(set, slot, key, code);
+	}
+	return 1;
+}
+
+/*
+ * Collects the next occupied slots of source from *slot on and hashes them
+ * for target, prefetching the home group of every key in target so that
+ * the following lookups overlap their cache misses.
+ */
+static int hash_set_gather(const hash_set *source, size_t *slot, const hash_set *target, hash_set_batch *batch)
+{
+	batch->count = 0;
+	for (; (*slot < source->bucket_count) && (batch->count < batch_size); ++(*slot))
+	{
+		if (group_is_full(source->control[*slot]))
+		{
+			const char *key = hash_set_slot(source, *slot);
+			const hash_t code = hash_set_code(target, key);
+			if (target->bucket_count)
+			{
+				const size_t home = group_home(code, target->bucket_count);
+				HASH_GROUP_PREFETCH(target->control + home);
+				HASH_GROUP_PREFETCH(hash_set_slot(target, home));
+			}
+			batch->keys[batch->count] = key;
+			batch->codes[batch->count] = code;
+			++(batch->count);
+		}
+	}
+	return batch->count != 0;
+}
+
+/* inserts the keys of source into destination */
+static int hash_set_insert_all(hash_set *destination, const hash_set *source)
+{
+	hash_set_batch batch;
+	size_t slot = 0;
+
+	if (!hash_set_reserve(destination, destination->elements + source->elements))
+	{
+		return 0;
+	}
+	while (hash_set_gather(source, &slot, destination, &batch))
+	{
+		size_t i;
+		for (i = 0; i < batch.count; ++i)
+		{
+			if (!hash_set_insert_code(destination, batch.keys[i], batch.codes[i]))
+			{
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* inserts the keys of source whose presence in filter equals keep_found */
+static int hash_set_insert_filtered(hash_set *destination, const hash_set *source, const hash_set *filter, int keep_found)
+{
+	const int reuse_codes = hash_set_same_hash(destination, filter);
+	hash_set_batch batch;
+	size_t slot = 0;
+
+	while (hash_set_gather(source, &slot, filter, &batch))
+	{
+		size_t i;
+		for (i = 0; i < batch.count; ++i)
+		{
+			if (hash_set_find(filter, batch.keys[i], batch.codes[i]) == keep_found)
+			{
+				const hash_t code = reuse_codes ? batch.codes[i] : hash_set_code(destination, batch.keys[i]);
+				if (!hash_set_insert_code(destination, batch.keys[i], code))
+				{
+					return 0;
+				}
+			}
+		}
+	}
+	return 1;
+}
+
+/* erases the keys of set whose presence in filter equals erase_found, in place */
+static void hash_set_erase_filtered(hash_set *set, const hash_set *filter, int erase_found)
+{
+	hash_set_batch batch;
+	size_t slot = 0;
+
+	while (hash_set_gather(set, &slot, filter, &batch))
+	{
+		size_t i;
+		for (i = 0; i < batch.count; ++i)
+		{
+			if (hash_set_find(filter, batch.keys[i], batch.codes[i]) == erase_found)
+			{
+				/* erasing only rewrites control bytes, so the gathered keys stay valid */
+				hash_set_erase_slot(set, (size_t)(batch.keys[i] - set->keys) / set->key_size);
+			}
+		}
+	}
+}
+
+/* erases the keys of filter from set, walking filter instead of set */
+static void hash_set_erase_all(hash_set *set, const hash_set *filter)
+{
+	hash_set_batch batch;
+	size_t slot = 0;
+
+	while (hash_set_gather(filter, &slot, set, &batch))
+	{
+		size_t i;
+		for (i = 0; i < batch.count; ++i)
+		{
+			size_t found;
+			if (set->elements &&
+				hash_set_probe(set, batch.keys[i], batch.codes[i], &found))
+			{
+				hash_set_erase_slot(set, found);
+			}
+		}
+	}
+}
+
+/* an empty set with the parameters of model */
+static void hash_set_create_like(hash_set *set, const hash_set *model)
+{
+	hash_set_create_with_allocator(set, model->key_size, model->hash, model->hash_user_data, &model->allocator);
+}
 
 
 hash_set_iterator hash_set_iterate(hash_set *set)
 {
-	return hash_map_iterate(&set->map);
+	hash_set_iterator iterator;
+	iterator.set = set;
+	iterator.slot = (size_t)-1;
+	return iterator;
 }
 
 const void *hash_set_iterator_key(hash_set_iterator *iterator)
 {
-	return hash_map_iterator_key(iterator);
+	return hash_set_slot(iterator->set, iterator->slot);
 }
 
 int hash_set_iterator_next(hash_set_iterator *iterator)
 {
-	return hash_map_iterator_next(iterator);
+	const hash_set * const set = iterator->set;
+	for (++(iterator->slot); iterator->slot < set->bucket_count; ++(iterator->slot))
+	{
+		if (group_is_full(set->control[iterator->slot]))
+		{
+			return 1;
+		}
+	}
+	iterator->slot = set->bucket_count;
+	return 0;
 }
 
 void hash_set_create(
@@ -22,45 +337,221 @@ void hash_set_create(
 	hash_function_t hash,
 	void *hash_user_data)
 {
-	hash_map_create(&set->map, key_size, 0, hash, hash_user_data);
+	const allocator heap = heap_allocator();
+	hash_set_create_with_allocator(set, key_size, hash, hash_user_data, &heap);
+}
+
+void hash_set_create_with_allocator(
+	hash_set *set,
+	size_t key_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	const allocator *a)
+{
+	set->allocator = *a;
+	set->control = 0;
+	set->keys = 0;
+	set->bucket_count = 0;
+	set->elements = 0;
+	set->tombstones = 0;
+	set->key_size = key_size;
+	set->hash = hash;
+	set->hash_user_data = hash_user_data;
 }
 
 void hash_set_destroy(hash_set *set)
 {
-	hash_map_destroy(&set->map);
+	hash_set_release(set);
 }
 
 int hash_set_resize(hash_set *set, size_t bucket_count)
 {
-	return hash_map_resize(&set->map, bucket_count);
+	assert(set);
+	assert(bucket_count > 0);
+	return hash_set_rehash(set, bucket_count);
+}
+
+int hash_set_reserve(hash_set *set, size_t count)
+{
+	size_t bucket_count = group_width;
+
+	if (set->bucket_count &&
+		!group_is_overloaded(count + set->tombstones + 1, set->bucket_count))
+	{
+		return 1;
+	}
+
+	while (group_is_overloaded(count + 1, bucket_count))
+	{
+		assert((bucket_count * 2) > bucket_count);
+		bucket_count *= 2;
+	}
+	return hash_set_rehash(set, bucket_count);
 }
 
 int hash_set_grow(hash_set *set)
 {
-	return hash_map_grow(&set->map);
+	if (!set->bucket_count ||
+		group_is_overloaded(set->elements + set->tombstones + 1, set->bucket_count))
+	{
+		/* tombstones alone are cleared by rehashing at the same size */
+		size_t new_size = set->elements * 2;
+		if (new_size < set->bucket_count)
+		{
+			new_size = set->bucket_count;
+		}
+		return hash_set_rehash(set, new_size);
+	}
+	return 1;
 }
 
 int hash_set_insert(hash_set *set, const void *key)
 {
-	return hash_map_insert(&set->map, key, 0);
+	return hash_set_insert_code(set, key, hash_set_code(set, key));
+}
+
+int hash_set_insert_n(hash_set *set, const void *keys, size_t count)
+{
+	const char *key = keys;
+	hash_t codes[batch_size];
+	size_t begin;
+
+	if (!hash_set_reserve(set, set->elements + count))
+	{
+		return 0;
+	}
+
+	for (begin = 0; begin < count; begin += batch_size)
+	{
+		const size_t batch = ((count - begin) < batch_size) ? (count - begin) : batch_size;
+		const char *batch_key = key;
+		size_t i;
+
+		/* hash the whole batch first so that the slots are in cache when inserting */
+		for (i = 0; i < batch; ++i, batch_key += set->key_size)
+		{
+			const size_t home = group_home(codes[i] = hash_set_code(set, batch_key), set->bucket_count);
+			HASH_GROUP_PREFETCH(set->control + home);
+			HASH_GROUP_PREFETCH(hash_set_slot(set, home));
+		}
+
+		for (i = 0; i < batch; ++i, key += set->key_size)
+		{
+			size_t slot;
+			if (!hash_set_probe(set, key, codes[i], &slot))
+			{
+				hash_set_place(set, slot, key, codes[i]);
+			}
+		}
+	}
+	return 1;
 }
 
 int hash_set_contains(const hash_set *set, const void *key)
 {
-	return hash_map_find(&set->map, key) != 0;
+	return hash_set_find(set, key, hash_set_code(set, key));
 }
 
 int hash_set_erase(hash_set *set, const void *key)
 {
-	return hash_map_erase(&set->map, key);
+	size_t slot;
+	if (!set->elements ||
+		!hash_set_probe(set, key, hash_set_code(set, key), &slot))
+	{
+		return 0;
+	}
+	hash_set_erase_slot(set, slot);
+	return 1;
 }
 
 size_t hash_set_size(hash_set *set)
 {
-	return hash_map_size(&set->map);
+	return set->elements;
 }
 
 void hash_set_clear(hash_set *set)
 {
-	hash_map_clear(&set->map);
+	if (set->bucket_count)
+	{
+		memset(set->control, control_empty, group_control_size(set->bucket_count));
+	}
+	set->elements = 0;
+	set->tombstones = 0;
+}
+
+int hash_set_union(hash_set *destination, const hash_set *left, const hash_set *right)
+{
+	assert(left->key_size == right->key_size);
+	assert(destination->key_size == left->key_size);
+
+	if (destination == left)
+	{
+		return hash_set_insert_all(destination, right);
+	}
+	if (destination == right)
+	{
+		return hash_set_insert_all(destination, left);
+	}
+	hash_set_clear(destination);
+	return hash_set_insert_all(destination, left) &&
+		hash_set_insert_all(destination, right);
+}
+
+int hash_set_intersect(hash_set *destination, const hash_set *left, const hash_set *right)
+{
+	const hash_set *smaller = (left->elements <= right->elements) ? left : right;
+	const hash_set *larger = (smaller == left) ? right : left;
+
+	assert(left->key_size == right->key_size);
+	assert(destination->key_size == left->key_size);
+
+	if (destination == left)
+	{
+		hash_set_erase_filtered(destination, right, 0);
+		return 1;
+	}
+	if (destination == right)
+	{
+		hash_set_erase_filtered(destination, left, 0);
+		return 1;
+	}
+	hash_set_clear(destination);
+	/* the result is no larger than the smaller operand, which is also the one to walk */
+	return hash_set_reserve(destination, smaller->elements) &&
+		hash_set_insert_filtered(destination, smaller, larger, 1);
+}
+
+int hash_set_difference(hash_set *destination, const hash_set *left, const hash_set *right)
+{
+	assert(left->key_size == right->key_size);
+	assert(destination->key_size == left->key_size);
+
+	if (destination == left)
+	{
+		if (right->elements < left->elements)
+		{
+			hash_set_erase_all(destination, right);
+		}
+		else
+		{
+			hash_set_erase_filtered(destination, right, 1);
+		}
+		return 1;
+	}
+	if (destination == right)
+	{
+		hash_set result;
+		hash_set_create_like(&result, destination);
+		if (!hash_set_difference(&result, left, right))
+		{
+			hash_set_destroy(&result);
+			return 0;
+		}
+		hash_set_release(destination);
+		*destination = result;
+		return 1;
+	}
+	hash_set_clear(destination);
+	return hash_set_reserve(destination, left->elements) &&
+		hash_set_insert_filtered(destination, left, right, 0);
 }
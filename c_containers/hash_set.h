@@ -5,13 +5,31 @@
 #include "hash_map.h"
 
 
+/*
+ * Open addressing table of keys only: bucket_count control bytes followed
+ * by the keys back to back. Unlike hash_map it caches no hash codes and
+ * grows in one step, so a set of 8 byte keys costs 9 bytes per slot.
+ */
 typedef struct hash_set
 {
-	hash_map map;
+	unsigned char *control;
+	char *keys;
+	size_t bucket_count;
+	size_t elements;
+	size_t tombstones;
+	size_t key_size;
+	hash_function_t hash;
+	void *hash_user_data;
+	allocator allocator;
 }
 hash_set;
 
-typedef hash_map_iterator hash_set_iterator;
+typedef struct hash_set_iterator
+{
+	const hash_set *set;
+	size_t slot;
+}
+hash_set_iterator;
 
 
 hash_set_iterator hash_set_iterate(hash_set *set);
@@ -22,14 +40,32 @@ void hash_set_create(
 	size_t key_size,
 	hash_function_t hash,
 	void *hash_user_data);
+void hash_set_create_with_allocator(
+	hash_set *set,
+	size_t key_size,
+	hash_function_t hash,
+	void *hash_user_data,
+	const allocator *a);
 void hash_set_destroy(hash_set *set);
 int hash_set_resize(hash_set *set, size_t bucket_count);
+int hash_set_reserve(hash_set *set, size_t count);
 int hash_set_grow(hash_set *set);
 int hash_set_insert(hash_set *set, const void *key);
+int hash_set_insert_n(hash_set *set, const void *keys, size_t count);
 int hash_set_contains(const hash_set *set, const void *key);
 int hash_set_erase(hash_set *set, const void *key);
 size_t hash_set_size(hash_set *set);
 void hash_set_clear(hash_set *set);
 
+/*
+ * Replace destination with the union, intersection or difference of left
+ * and right, which must have the same key size. destination may be one of
+ * the operands. The operands are read in slot order and the lookups into
+ * the other set are issued a batch at a time.
+ */
+int hash_set_union(hash_set *destination, const hash_set *left, const hash_set *right);
+int hash_set_intersect(hash_set *destination, const hash_set *left, const hash_set *right);
+int hash_set_difference(hash_set *destination, const hash_set *left, const hash_set *right);
+
 
 #endif
@@ -1,7 +1,6 @@
 #include "linked_list.h"
 #include <assert.h>
 #include <string.h>
-#include <stdlib.h>
 
 
 struct linked_list_entry
@@ -10,30 +9,42 @@ struct linked_list_entry
 	char value[0];
 };
 
-static linked_list_entry *allocate_entry(const void *value, size_t size)
+static linked_list_entry *allocate_entry(linked_list *list, const void *value)
 {
-	linked_list_entry *entry = malloc(sizeof(*entry) + size);
+	linked_list_entry *entry = allocator_allocate(&list->allocator, linked_list_entry_size(list->value_size));
 	if (entry)
 	{
-		memcpy(entry->value, value, size);
+		memcpy(entry->value, value, list->value_size);
 	}
 	return entry;
 }
 
-static void deallocate_entry(linked_list_entry *entry)
+static void deallocate_entry(linked_list *list, linked_list_entry *entry)
 {
-	free(entry);
+	allocator_deallocate(&list->allocator, entry, linked_list_entry_size(list->value_size));
 }
 
 
 void linked_list_create(linked_list *list, size_t value_size)
+{
+	const allocator heap = heap_allocator();
+	linked_list_create_with_allocator(list, value_size, &heap);
+}
+
+void linked_list_create_with_allocator(linked_list *list, size_t value_size, const allocator *a)
 {
 	list->first = list->last = 0;
 	list->value_size = value_size;
+	list->allocator = *a;
 }
 
 void linked_list_destroy(linked_list *list)
 {
+	if (allocator_frees_in_bulk(&list->allocator))
+	{
+		list->first = list->last = 0;
+		return;
+	}
 	while (!linked_list_empty(list))
 	{
 		linked_list_pop_back(list);
@@ -42,7 +53,7 @@ void linked_list_destroy(linked_list *list)
 
 int linked_list_push_front(linked_list *list, const void *value)
 {
-	linked_list_entry *entry = allocate_entry(value, list->value_size);
+	linked_list_entry *entry = allocate_entry(list, value);
 	if (!entry)
 	{
 		return 0;
@@ -63,7 +74,7 @@ int linked_list_push_front(linked_list *list, const void *value)
 
 int linked_list_push_back(linked_list *list, const void *value)
 {
-	linked_list_entry *entry = allocate_entry(value, list->value_size);
+	linked_list_entry *entry = allocate_entry(list, value);
 	if (!entry)
 	{
 		return 0;
@@ -99,7 +110,7 @@ void linked_list_pop_front(linked_list *list)
 	assert(!linked_list_empty(list));
 
 	new_first = list->first->next;
-	deallocate_entry(list->first);
+	deallocate_entry(list, list->first);
 	list->first = new_first;
 	if (new_first)
 	{
@@ -118,7 +129,7 @@ void linked_list_pop_back(linked_list *list)
 	assert(!linked_list_empty(list));
 
 	new_last = list->last->previous;
-	deallocate_entry(list->last);
+	deallocate_entry(list, list->last);
 	list->last = new_last;
 	if (new_last)
 	{
@@ -137,9 +148,8 @@ int linked_list_empty(const linked_list *list)
 
 void linked_list_clear(linked_list *list)
 {
-	size_t value_size = list->value_size;
 	linked_list_destroy(list);
-	linked_list_create(list, value_size);
+	list->first = list->last = 0;
 }
 
 size_t linked_list_size(const linked_list *list)
@@ -169,3 +179,14 @@ void linked_list_next(linked_list_iterator *iterator)
 	assert(*iterator);
 	*iterator = (*iterator)->next;
 }
+
+void *linked_list_deref(linked_list_iterator iterator)
+{
+	assert(iterator);
+	return iterator->value;
+}
+
+size_t linked_list_entry_size(size_t value_size)
+{
+	return sizeof(linked_list_entry) + value_size;
+}
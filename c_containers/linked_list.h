@@ -2,6 +2,7 @@
 #define LINKED_LIST_H
 
 
+#include "allocator.h"
 #include <stddef.h>
 
 
@@ -11,11 +12,13 @@ typedef struct linked_list
 {
 	size_t value_size;
 	linked_list_entry *first, *last;
+	allocator allocator;
 }
 linked_list;
 
 
 void linked_list_create(linked_list *list, size_t value_size);
+void linked_list_create_with_allocator(linked_list *list, size_t value_size, const allocator *a);
 void linked_list_destroy(linked_list *list);
 int linked_list_push_front(linked_list *list, const void *value);
 int linked_list_push_back(linked_list *list, const void *value);
@@ -32,6 +35,9 @@ typedef linked_list_entry *linked_list_iterator;
 linked_list_iterator linked_list_first(const linked_list *list);
 linked_list_iterator linked_list_last(const linked_list *list);
 void linked_list_next(linked_list_iterator *iterator);
+void *linked_list_deref(linked_list_iterator iterator);
+/* bytes the list allocates per value, e.g. for the block size of a pool */
+size_t linked_list_entry_size(size_t value_size);
 
 
 #endif
@@ -5,6 +5,17 @@
 #include "vector.h"
 #include "stack.h"
 #include "tree_map.h"
+#include "pool.h"
+#include "arena.h"
+#ifdef CONTAINERS_LOCK_FREE
+#include "spsc_queue.h"
+#include "mpmc_queue.h"
+#endif
+#ifdef CONTAINERS_CONCURRENT
+#include "concurrent_hash_map.h"
+#include <pthread.h>
+#endif
+#include "hash_functions.h"
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
@@ -83,6 +94,131 @@ static void test_hash_map()
 	hash_map_destroy(&map);
 }
 
+static void test_hash_map_growth()
+{
+	typedef long long value_t;
+
+	map_key key;
+	value_t value;
+	size_t visited = 0;
+	hash_map_iterator i;
+	hash_map map;
+	hash_map_create(&map, sizeof(map_key), sizeof(value_t), hash, 0);
+
+	for (key = 0; key < 5000; ++key)
+	{
+		map_key half = key / 2;
+		value = -key;
+		ENSURE(hash_map_insert(&map, &key, &value));
+		ENSURE(hash_map_find(&map, &half));
+	}
+
+	for (key = 0; key < 5000; key += 3)
+	{
+		ENSURE(hash_map_erase(&map, &key));
+		ENSURE(!hash_map_erase(&map, &key));
+	}
+
+	for (key = 0; key < 5000; ++key)
+	{
+		const void *found = hash_map_find(&map, &key);
+		if (key % 3)
+		{
+			ENSURE(found);
+			memcpy(&value, found, sizeof(value));
+			ENSURE(value == -key);
+		}
+		else
+		{
+			ENSURE(!found);
+		}
+	}
+
+	ENSURE(hash_map_size(&map) == 3333);
+
+	i = hash_map_iterate(&map);
+	while (hash_map_iterator_next(&i))
+	{
+		memcpy(&key, hash_map_iterator_key(&i), sizeof(key));
+		memcpy(&value, hash_map_iterator_value(&i), sizeof(value));
+		ENSURE(key % 3);
+		ENSURE(value == -key);
+		++visited;
+	}
+	ENSURE(visited == hash_map_size(&map));
+
+	hash_map_destroy(&map);
+}
+
+static hash_t counting_hash(const void *key, void *user_data)
+{
+	size_t *calls = user_data;
+	++(*calls);
+	return hash(key, 0);
+}
+
+static void test_hash_map_growth_keeps_hashes()
+{
+	map_key key;
+	value_t value = 'v';
+	size_t calls = 0;
+	hash_map map;
+	hash_map_create(&map, sizeof(map_key), sizeof(value_t), counting_hash, &calls);
+
+	for (key = 0; key < 3000; ++key)
+	{
+		ENSURE(hash_map_insert(&map, &key, &value));
+		if (key % 4 == 0)
+		{
+			map_key erased = key / 2;
+			ENSURE(hash_map_erase(&map, &erased));
+		}
+	}
+	ENSURE(calls == 3750);
+
+	ENSURE(hash_map_resize(&map, 20000));
+	ENSURE(calls == 3750);
+
+	hash_map_destroy(&map);
+}
+
+static void test_hash_map_insert_n()
+{
+	enum
+	{
+		count = 1000
+	};
+	map_key keys[count];
+	value_t values[count];
+	map_key key;
+	size_t i;
+	hash_map map;
+	hash_map_create(&map, sizeof(map_key), sizeof(value_t), hash, 0);
+
+	key = -1;
+	ENSURE(hash_map_insert(&map, &key, "x"));
+
+	for (i = 0; i < count; ++i)
+	{
+		keys[i] = (map_key)(i % 700);
+		values[i] = (value_t)('a' + (i % 26));
+	}
+
+	ENSURE(hash_map_reserve(&map, count));
+	ENSURE(hash_map_insert_n(&map, keys, values, count));
+	ENSURE(hash_map_size(&map) == 701);
+
+	for (i = 0; i < 700; ++i)
+	{
+		const value_t *found = hash_map_find(&map, keys + i);
+		ENSURE(found);
+		ENSURE(*found == values[i]);
+	}
+	ENSURE(*(const value_t *)hash_map_find(&map, &key) == 'x');
+
+	hash_map_destroy(&map);
+}
+
 static void test_hash_set()
 {
 	size_t j;
@@ -110,11 +246,221 @@ static void test_hash_set()
 		}
 
 		ENSURE(hash_set_size(&set) == 13);
+
+		{
+			const map_key more[] = {1, 2, 3, 2, 100, 101};
+			ENSURE(hash_set_insert_n(&set, more, sizeof(more) / sizeof(more[0])));
+			ENSURE(hash_set_size(&set) == 16);
+			ENSURE(hash_set_contains(&set, more + 5));
+		}
 	}
 
 	hash_set_destroy(&set);
 }
 
+static hash_t identity_hash(const void *key, void *user_data)
+{
+	map_key original;
+	memcpy(&original, key, sizeof(original));
+	return (hash_t)original;
+}
+
+/* every key of set is in [0, limit) and matches the predicate */
+static int set_matches(hash_set *set, int (*expected)(map_key), map_key limit)
+{
+	size_t count = 0;
+	map_key key;
+	hash_set_iterator i = hash_set_iterate(set);
+	while (hash_set_iterator_next(&i))
+	{
+		memcpy(&key, hash_set_iterator_key(&i), sizeof(key));
+		if ((key < 0) || (key >= limit) || !expected(key))
+		{
+			return 0;
+		}
+	}
+	for (key = 0; key < limit; ++key)
+	{
+		if (expected(key))
+		{
+			if (!hash_set_contains(set, &key))
+			{
+				return 0;
+			}
+			++count;
+		}
+	}
+	return count == hash_set_size(set);
+}
+
+static int is_even(map_key key) { return (key % 2) == 0; }
+static int is_multiple_of_3(map_key key) { return (key % 3) == 0; }
+static int is_even_or_multiple_of_3(map_key key) { return is_even(key) || is_multiple_of_3(key); }
+static int is_multiple_of_6(map_key key) { return (key % 6) == 0; }
+static int is_even_not_multiple_of_3(map_key key) { return is_even(key) && !is_multiple_of_3(key); }
+static int is_multiple_of_3_not_even(map_key key) { return is_multiple_of_3(key) && !is_even(key); }
+
+static void fill_sets(hash_set *left, hash_set *right, map_key limit)
+{
+	map_key key;
+	hash_set_clear(left);
+	hash_set_clear(right);
+	for (key = 0; key < limit; ++key)
+	{
+		if (is_even(key))
+		{
+			ENSURE(hash_set_insert(left, &key));
+		}
+		if (is_multiple_of_3(key))
+		{
+			ENSURE(hash_set_insert(right, &key));
+		}
+	}
+}
+
+static void test_hash_set_algebra()
+{
+	const map_key limit = 3000;
+	map_key key;
+	hash_set left, right, result;
+
+	/* the operands need not share a hash function */
+	hash_set_create(&left, sizeof(map_key), hash, 0);
+	hash_set_create(&right, sizeof(map_key), identity_hash, 0);
+	hash_set_create(&result, sizeof(map_key), hash, 0);
+
+	fill_sets(&left, &right, limit);
+	ENSURE(hash_set_union(&result, &left, &right));
+	ENSURE(set_matches(&result, is_even_or_multiple_of_3, limit));
+	ENSURE(hash_set_intersect(&result, &left, &right));
+	ENSURE(set_matches(&result, is_multiple_of_6, limit));
+	ENSURE(hash_set_difference(&result, &left, &right));
+	ENSURE(set_matches(&result, is_even_not_multiple_of_3, limit));
+	ENSURE(hash_set_difference(&result, &right, &left));
+	ENSURE(set_matches(&result, is_multiple_of_3_not_even, limit));
+
+	/* in place */
+	ENSURE(hash_set_union(&left, &left, &right));
+	ENSURE(set_matches(&left, is_even_or_multiple_of_3, limit));
+	fill_sets(&left, &right, limit);
+	ENSURE(hash_set_union(&right, &left, &right));
+	ENSURE(set_matches(&right, is_even_or_multiple_of_3, limit));
+	fill_sets(&left, &right, limit);
+	ENSURE(hash_set_intersect(&left, &left, &right));
+	ENSURE(set_matches(&left, is_multiple_of_6, limit));
+	fill_sets(&left, &right, limit);
+	ENSURE(hash_set_intersect(&right, &left, &right));
+	ENSURE(set_matches(&right, is_multiple_of_6, limit));
+	fill_sets(&left, &right, limit);
+	ENSURE(hash_set_difference(&left, &left, &right));
+	ENSURE(set_matches(&left, is_even_not_multiple_of_3, limit));
+	fill_sets(&left, &right, limit);
+	key = limit * 2;
+	ENSURE(hash_set_insert(&right, &key));
+	ENSURE(hash_set_difference(&left, &left, &right));
+	ENSURE(set_matches(&left, is_even_not_multiple_of_3, limit));
+	fill_sets(&left, &right, limit);
+	ENSURE(hash_set_difference(&right, &left, &right));
+	ENSURE(set_matches(&right, is_even_not_multiple_of_3, limit));
+
+	hash_set_clear(&right);
+	ENSURE(hash_set_intersect(&result, &left, &right));
+	ENSURE(hash_set_size(&result) == 0);
+
+	/* churn leaves tombstones behind which growing has to clean up */
+	hash_set_destroy(&left);
+	hash_set_create(&left, sizeof(map_key), hash, 0);
+	for (key = 0; key < 100000; ++key)
+	{
+		ENSURE(hash_set_insert(&left, &key));
+		if (key >= 10)
+		{
+			const map_key old = key - 10;
+			ENSURE(hash_set_erase(&left, &old));
+		}
+	}
+	ENSURE(hash_set_size(&left) == 10);
+	ENSURE(left.bucket_count <= 64);
+
+	hash_set_destroy(&result);
+	hash_set_destroy(&right);
+	hash_set_destroy(&left);
+}
+
+static void test_hash_functions()
+{
+	unsigned char bytes[100];
+	hash_t hashes[sizeof(bytes) + 1];
+	hash_parameters parameters, seeded;
+	hash_map map;
+	size_t i, j;
+	unsigned key32;
+	unsigned long long key64;
+
+	for (i = 0; i < sizeof(bytes); ++i)
+	{
+		bytes[i] = (unsigned char)(i * 37);
+	}
+
+	/* every length reads exactly its own bytes */
+	for (i = 0; i <= sizeof(bytes); ++i)
+	{
+		unsigned char copy[sizeof(bytes) + 1];
+		hashes[i] = hash_bytes(bytes, i, 0);
+		memcpy(copy + 1, bytes, i);
+		ENSURE(hash_bytes(copy + 1, i, 0) == hashes[i]);
+		for (j = 0; j < i; ++j)
+		{
+			ENSURE(hashes[j] != hashes[i]);
+		}
+		for (j = 0; j < i; ++j)
+		{
+			copy[1 + j] ^= 1;
+			ENSURE(hash_bytes(copy + 1, i, 0) != hashes[i]);
+			copy[1 + j] ^= 1;
+		}
+		ENSURE(hash_bytes(bytes, i, 1) != hashes[i]);
+	}
+
+	ENSURE(hash_function_for_size(4) == hash_key_32);
+	ENSURE(hash_function_for_size(8) == hash_key_64);
+	ENSURE(hash_function_for_size(12) == hash_key_bytes);
+
+	hash_parameters_create(&parameters, 12, 0);
+	hash_parameters_create(&seeded, 8, hash_random_seed());
+	ENSURE(hash_key_bytes(bytes, &parameters) == hash_bytes(bytes, 12, 0));
+	key32 = 1;
+	key64 = 1;
+	ENSURE(hash_key_32(&key32, 0) != hash_key_64(&key64, 0));
+	ENSURE(hash_key_64(&key64, 0) != hash_key_64(&key64, &seeded) || (seeded.seed == 0));
+
+	/* consecutive integers spread over the low bits */
+	{
+		unsigned low_bits = 0, used = 0;
+		for (key64 = 0; key64 < 64; ++key64)
+		{
+			low_bits |= 1u << (hash_key_64(&key64, &seeded) & 31);
+		}
+		for (; low_bits; low_bits &= low_bits - 1)
+		{
+			++used;
+		}
+		ENSURE(used >= 16);
+	}
+
+	hash_map_create(&map, sizeof(key64), 0, hash_function_for_size(sizeof(key64)), &seeded);
+	for (key64 = 0; key64 < 1000; ++key64)
+	{
+		ENSURE(hash_map_insert(&map, &key64, 0));
+	}
+	for (key64 = 0; key64 < 1000; ++key64)
+	{
+		ENSURE(hash_map_find(&map, &key64));
+	}
+	ENSURE(hash_map_size(&map) == 1000);
+	hash_map_destroy(&map);
+}
+
 static void test_vector()
 {
 	typedef unsigned element_t;
@@ -149,6 +495,141 @@ static void test_vector()
 	vector_destroy(&v);
 }
 
+static void test_vector_both_ends()
+{
+	typedef unsigned element_t;
+
+	element_t e;
+	size_t reallocations = 0;
+	size_t capacity = 0;
+	vector v;
+	vector_create(&v, sizeof(e));
+
+	for (e = 0; e < 10000; ++e)
+	{
+		ENSURE(vector_push_front(&v, &e));
+		ENSURE(*(const element_t *)vector_front(&v) == e);
+		if (v.capacity != capacity)
+		{
+			capacity = v.capacity;
+			++reallocations;
+		}
+	}
+	ENSURE(reallocations < 20);
+	ENSURE(*(const element_t *)vector_back(&v) == 0);
+	for (e = 0; e < 10000; ++e)
+	{
+		ENSURE(*(const element_t *)vector_get(&v, e) == 9999 - e);
+	}
+
+	/* used as a queue, the buffer grows at most once and then recycles the free slots in front */
+	reallocations = 0;
+	for (e = 0; e < 100000; ++e)
+	{
+		element_t first = *(const element_t *)vector_front(&v);
+		ENSURE(first == 9999 - (e % 10000));
+		vector_pop_front(&v);
+		ENSURE(vector_push_back(&v, &first));
+		if (v.capacity != capacity)
+		{
+			capacity = v.capacity;
+			++reallocations;
+		}
+	}
+	ENSURE(reallocations <= 1);
+	ENSURE(vector_size(&v) == 10000);
+
+	vector_erase_n(&v, 2, 5);
+	ENSURE(vector_size(&v) == 9997);
+	ENSURE(*(const element_t *)vector_get(&v, 1) == 9998);
+	ENSURE(*(const element_t *)vector_get(&v, 2) == 9994);
+	vector_erase_n(&v, 9990, 9995);
+	ENSURE(vector_size(&v) == 9992);
+	ENSURE(*(const element_t *)vector_get(&v, 9989) == 7);
+	ENSURE(*(const element_t *)vector_get(&v, 9990) == 1);
+
+	/* clearing gives the free slots in front back to the back */
+	for (e = 0; e < 100; ++e)
+	{
+		vector_pop_front(&v);
+	}
+	ENSURE(vector_capacity(&v) < v.capacity);
+	vector_clear(&v);
+	ENSURE(vector_empty(&v));
+	ENSURE(vector_capacity(&v) == v.capacity);
+	e = 42;
+	ENSURE(vector_push_back(&v, &e));
+	ENSURE(*(const element_t *)vector_front(&v) == 42);
+
+	vector_destroy(&v);
+}
+
+static void test_vector_bulk()
+{
+	typedef unsigned element_t;
+
+	element_t small[8];
+	element_t batch[100];
+	element_t e;
+	size_t j;
+	vector v;
+
+	vector_create_with_buffer(&v, sizeof(e), small, 8);
+	for (e = 0; e < 8; ++e)
+	{
+		ENSURE(vector_push_back(&v, &e));
+	}
+	ENSURE(vector_data(&v) == small);
+	ENSURE(vector_push_back(&v, &e));
+	ENSURE(vector_data(&v) != small);
+	for (e = 0; e < 9; ++e)
+	{
+		ENSURE(*(const element_t *)vector_get(&v, e) == e);
+	}
+
+	for (e = 0; e < 100; ++e)
+	{
+		batch[e] = 1000 + e;
+	}
+	ENSURE(vector_append_n(&v, batch, 100));
+	ENSURE(vector_size(&v) == 109);
+	ENSURE(vector_capacity(&v) == 109);
+	ENSURE(*(const element_t *)vector_get(&v, 9) == 1000);
+	ENSURE(*(const element_t *)vector_back(&v) == 1099);
+	ENSURE(vector_append_n(&v, batch, 1));
+	ENSURE(vector_capacity(&v) == 218);
+
+	e = 7;
+	ENSURE(vector_resize(&v, 1000, &e));
+	ENSURE(*(const element_t *)vector_get(&v, 109) == 1000);
+	for (j = 110; j < 1000; ++j)
+	{
+		ENSURE(*(const element_t *)vector_get(&v, j) == 7);
+	}
+	vector_fill(&v, vector_get(&v, 3));
+	for (j = 0; j < 1000; ++j)
+	{
+		ENSURE(*(const element_t *)vector_get(&v, j) == 3);
+	}
+	ENSURE(vector_resize(&v, 5, &e));
+	ENSURE(vector_size(&v) == 5);
+	vector_destroy(&v);
+
+	/* a vector that stays small never allocates */
+	vector_create_with_buffer(&v, sizeof(e), small, 8);
+	for (j = 0; j < 100; ++j)
+	{
+		e = (element_t)j;
+		ENSURE(vector_push_front(&v, &e));
+		ENSURE(vector_push_back(&v, &e));
+		vector_pop_front(&v);
+		vector_pop_back(&v);
+	}
+	ENSURE(vector_empty(&v));
+	ENSURE(vector_data(&v) >= (void *)small && vector_data(&v) < (void *)(small + 8));
+	vector_destroy(&v);
+}
+
 static void test_queue()
 {
 	typedef unsigned element_t;
@@ -194,6 +675,43 @@ static void test_queue()
 	queue_destroy(&q);
 }
 
+static void test_queue_blocks()
+{
+	typedef unsigned long long element_t;
+
+	element_t pushed = 0;
+	element_t popped = 0;
+	size_t round;
+	queue q;
+	queue_create(&q, sizeof(element_t));
+
+	/* grow and shrink across many blocks while keeping FIFO order */
+	for (round = 0; round < 20; ++round)
+	{
+		const size_t push_count = (round % 2) ? 700 : 2500;
+		const size_t pop_count = (round % 2) ? 2000 : 900;
+		size_t i;
+
+		for (i = 0; i < push_count; ++i, ++pushed)
+		{
+			ENSURE(queue_push(&q, &pushed));
+		}
+		for (i = 0; (i < pop_count) && !queue_empty(&q); ++i, ++popped)
+		{
+			ENSURE(*(const element_t *)queue_front(&q) == popped);
+			queue_pop(&q);
+		}
+		ENSURE(queue_size(&q) == (size_t)(pushed - popped));
+	}
+
+	queue_clear(&q);
+	ENSURE(queue_empty(&q));
+	ENSURE(queue_push(&q, &pushed));
+	ENSURE(*(const element_t *)queue_front(&q) == pushed);
+
+	queue_destroy(&q);
+}
+
 static void test_stack()
 {
 	typedef long long element_t;
@@ -237,6 +755,14 @@ static int compare_uchar(const void *left, const void *right, void *user)
 	return memcmp(left, right, 1);
 }
 
+static int compare_unsigned(const void *left, const void *right, void *user)
+{
+	unsigned l, r;
+	memcpy(&l, left, sizeof(l));
+	memcpy(&r, right, sizeof(r));
+	return (l > r) - (l < r);
+}
+
 static void test_tree_map()
 {
 	typedef unsigned char map_key;
@@ -266,16 +792,492 @@ static void test_tree_map()
 			ENSURE(found);
 			ENSURE(!memcmp(found, &value, sizeof(value)));
 
-#if 0
 			tree_map_erase(&map, &key);
 			ENSURE(!tree_map_find(&map, &key));
-#endif
 		}
 	}
 
 	tree_map_destroy(&map);
 }
 
+static void test_tree_map_against_reference()
+{
+	enum
+	{
+		key_range = 3000,
+		steps = 20000
+	};
+	typedef struct value_t
+	{
+		unsigned key;
+		char padding[120];
+	}
+	value_t;
+
+	static unsigned char present[key_range];
+	unsigned state = 12345;
+	unsigned key;
+	size_t step;
+	value_t value;
+	tree_map map;
+	tree_map_create(&map, sizeof(key), sizeof(value), compare_unsigned, 0);
+	memset(present, 0, sizeof(present));
+	memset(&value, 0, sizeof(value));
+
+	for (step = 0; step < steps; ++step)
+	{
+		const value_t *found;
+		state = state * 1103515245u + 12345u;
+		key = (state >> 8) % key_range;
+		found = tree_map_find(&map, &key);
+		ENSURE(!found == !present[key]);
+		ENSURE(!found || (found->key == key));
+		if ((state >> 4) % 3)
+		{
+			value.key = key;
+			ENSURE(tree_map_insert(&map, &key, &value));
+			present[key] = 1;
+		}
+		else
+		{
+			tree_map_erase(&map, &key);
+			present[key] = 0;
+		}
+	}
+
+	for (key = 0; key < key_range; ++key)
+	{
+		ENSURE(!tree_map_find(&map, &key) == !present[key]);
+		tree_map_erase(&map, &key);
+	}
+	ENSURE(!map.root);
+
+	tree_map_destroy(&map);
+}
+
+typedef struct range_sum
+{
+	unsigned sum;
+	size_t visited;
+	size_t limit;
+}
+range_sum;
+
+static int sum_range(const void *key, void *value, void *user_data)
+{
+	range_sum *state = user_data;
+	unsigned k;
+	memcpy(&k, key, sizeof(k));
+	ENSURE(!memcmp(value, key, sizeof(k)));
+	state->sum += k;
+	++(state->visited);
+	return state->visited < state->limit;
+}
+
+static void test_tree_map_iteration()
+{
+	unsigned key;
+	unsigned previous = 0;
+	size_t count = 0;
+	range_sum range;
+	tree_map_iterator i;
+	tree_map map;
+	tree_map_create(&map, sizeof(key), sizeof(key), compare_unsigned, 0);
+
+	i = tree_map_iterate(&map);
+	ENSURE(!tree_map_iterator_next(&i));
+
+	/* the multiples of three below 3000 in a scrambled order */
+	for (key = 0; key < 1000; ++key)
+	{
+		const unsigned inserted = ((key * 7919) % 1000) * 3;
+		ENSURE(tree_map_insert(&map, &inserted, &inserted));
+	}
+
+	i = tree_map_iterate(&map);
+	while (tree_map_iterator_next(&i))
+	{
+		memcpy(&key, tree_map_iterator_key(&i), sizeof(key));
+		ENSURE(!count || (key == previous + 3));
+		ENSURE(!memcmp(tree_map_iterator_value(&i), &key, sizeof(key)));
+		previous = key;
+		++count;
+	}
+	ENSURE(count == 1000);
+
+	key = 10;
+	i = tree_map_lower_bound(&map, &key);
+	ENSURE(tree_map_iterator_next(&i));
+	ENSURE(*(const unsigned *)tree_map_iterator_key(&i) == 12);
+
+	key = 12;
+	i = tree_map_lower_bound(&map, &key);
+	ENSURE(tree_map_iterator_next(&i));
+	ENSURE(*(const unsigned *)tree_map_iterator_key(&i) == 12);
+
+	i = tree_map_upper_bound(&map, &key);
+	ENSURE(tree_map_iterator_next(&i));
+	ENSURE(*(const unsigned *)tree_map_iterator_key(&i) == 15);
+
+	key = 2997;
+	i = tree_map_upper_bound(&map, &key);
+	ENSURE(!tree_map_iterator_next(&i));
+
+	{
+		const unsigned begin = 100;
+		const unsigned end = 200;
+		range.sum = 0;
+		range.visited = 0;
+		range.limit = (size_t)-1;
+		ENSURE(tree_map_visit_range(&map, &begin, &end, sum_range, &range));
+		ENSURE(range.visited == 33);
+		ENSURE(range.sum == (102 + 198) * 33 / 2);
+
+		range.visited = 0;
+		range.limit = 5;
+		ENSURE(!tree_map_visit_range(&map, &begin, 0, sum_range, &range));
+		ENSURE(range.visited == 5);
+
+		range.visited = 0;
+		range.limit = (size_t)-1;
+		ENSURE(tree_map_visit_range(&map, 0, 0, sum_range, &range));
+		ENSURE(range.visited == 1000);
+
+		range.visited = 0;
+		ENSURE(tree_map_visit_range(&map, &end, &begin, sum_range, &range));
+		ENSURE(range.visited == 0);
+	}
+
+	tree_map_destroy(&map);
+}
+
+static void test_pool()
+{
+	typedef long long element_t;
+
+	size_t i;
+	element_t *blocks[100];
+	element_t *big;
+	pool p;
+	allocator a;
+	pool_create(&p, sizeof(element_t), 16);
+
+	for (i = 0; i < 100; ++i)
+	{
+		blocks[i] = pool_allocate(&p);
+		ENSURE(blocks[i]);
+		*blocks[i] = (element_t)i;
+	}
+	for (i = 0; i < 100; ++i)
+	{
+		ENSURE(*blocks[i] == (element_t)i);
+	}
+	pool_deallocate(&p, blocks[42]);
+	ENSURE(pool_allocate(&p) == blocks[42]);
+
+	a = pool_allocator(&p);
+	big = allocator_allocate(&a, 10 * sizeof(*big));
+	ENSURE(big);
+	big[9] = 9;
+	big = allocator_reallocate(&a, big, 10 * sizeof(*big), 20 * sizeof(*big));
+	ENSURE(big && (big[9] == 9));
+	allocator_deallocate(&a, big, 20 * sizeof(*big));
+
+	pool_destroy(&p);
+}
+
+static void test_containers_with_allocators()
+{
+	typedef unsigned element_t;
+
+	element_t e;
+	pool p;
+	arena ar;
+	allocator pooled, bump;
+	queue q;
+	vector v;
+	tree_map tree;
+	hash_map map;
+
+	pool_create(&p, 64, 32);
+	pooled = pool_allocator(&p);
+	arena_create(&ar, 4096);
+	bump = arena_allocator(&ar);
+
+	queue_create_with_allocator(&q, sizeof(e), &pooled);
+	for (e = 0; e < 100; ++e)
+	{
+		ENSURE(queue_push(&q, &e));
+	}
+	for (e = 0; e < 100; ++e)
+	{
+		ENSURE(*(const element_t *)queue_front(&q) == e);
+		queue_pop(&q);
+	}
+	ENSURE(queue_empty(&q));
+	queue_destroy(&q);
+
+	vector_create_with_allocator(&v, sizeof(e), &bump);
+	for (e = 0; e < 1000; ++e)
+	{
+		ENSURE(vector_push_back(&v, &e));
+	}
+	ENSURE(*(const element_t *)vector_back(&v) == 999);
+
+	tree_map_create_with_allocator(&tree, sizeof(e), sizeof(e), compare_unsigned, 0, &bump);
+	for (e = 0; e < 200; ++e)
+	{
+		ENSURE(tree_map_insert(&tree, &e, &e));
+	}
+	e = 7;
+	ENSURE(tree_map_find(&tree, &e));
+
+	hash_map_create_with_allocator(&map, sizeof(map_key), sizeof(e), hash, 0, &bump);
+	for (e = 0; e < 1000; ++e)
+	{
+		const map_key key = e;
+		ENSURE(hash_map_insert(&map, &key, &e));
+	}
+	ENSURE(hash_map_size(&map) == 1000);
+
+	/* these do not visit any element because the arena is released as a whole */
+	hash_map_destroy(&map);
+	tree_map_destroy(&tree);
+	vector_destroy(&v);
+	arena_destroy(&ar);
+
+	pool_destroy(&p);
+}
+
+#ifdef CONTAINERS_LOCK_FREE
+enum
+{
+	stress_count = 200000,
+	stress_producers = 4,
+	stress_consumers = 4
+};
+
+static void *spsc_producer(void *argument)
+{
+	spsc_queue *q = argument;
+	unsigned long long value;
+	for (value = 0; value < stress_count; ++value)
+	{
+		/* mix both kinds of push so that both see a full queue */
+		if ((value % 2) || !spsc_queue_try_push(q, &value))
+		{
+			spsc_queue_push(q, &value);
+		}
+	}
+	return 0;
+}
+
+static void test_spsc_queue()
+{
+	spsc_queue q;
+	pthread_t producer;
+	unsigned long long expected, value;
+
+	ENSURE(spsc_queue_create(&q, sizeof(value), 100));
+	ENSURE(spsc_queue_capacity(&q) == 128);
+	ENSURE(!spsc_queue_try_pop(&q, &value));
+
+	ENSURE(pthread_create(&producer, 0, spsc_producer, &q) == 0);
+	for (expected = 0; expected < stress_count; ++expected)
+	{
+		if ((expected % 3) || !spsc_queue_try_pop(&q, &value))
+		{
+			spsc_queue_pop(&q, &value);
+		}
+		ENSURE(value == expected);
+	}
+	ENSURE(pthread_join(producer, 0) == 0);
+	ENSURE(!spsc_queue_try_pop(&q, &value));
+
+	for (value = 0; value < spsc_queue_capacity(&q); ++value)
+	{
+		ENSURE(spsc_queue_try_push(&q, &value));
+	}
+	ENSURE(!spsc_queue_try_push(&q, &value));
+	spsc_queue_destroy(&q);
+}
+
+typedef struct mpmc_stress
+{
+	mpmc_queue *q;
+	unsigned long long id;
+	unsigned long long received[stress_producers];
+	unsigned long long sum;
+}
+mpmc_stress;
+
+static void *mpmc_producer(void *argument)
+{
+	mpmc_stress *s = argument;
+	unsigned long long sequence;
+	for (sequence = 0; sequence < stress_count; ++sequence)
+	{
+		const unsigned long long value = (s->id << 32) | sequence;
+		mpmc_queue_push(s->q, &value);
+	}
+	return 0;
+}
+
+static void *mpmc_consumer(void *argument)
+{
+	mpmc_stress *s = argument;
+	size_t i;
+	for (i = 0; i < (stress_count * stress_producers / stress_consumers); ++i)
+	{
+		unsigned long long value, producer, sequence;
+		mpmc_queue_pop(s->q, &value);
+		producer = value >> 32;
+		sequence = value & 0xFFFFFFFFu;
+		/* elements of one producer reach any single consumer in order */
+		ENSURE(producer < stress_producers);
+		ENSURE(sequence + 1 > s->received[producer]);
+		s->received[producer] = sequence + 1;
+		s->sum += sequence;
+	}
+	return 0;
+}
+
+static void test_mpmc_queue()
+{
+	mpmc_queue q;
+	pthread_t producers[stress_producers], consumers[stress_consumers];
+	mpmc_stress producer_states[stress_producers], consumer_states[stress_consumers];
+	unsigned long long value, sum = 0;
+	size_t i;
+
+	ENSURE(mpmc_queue_create(&q, sizeof(value), 64));
+	ENSURE(!mpmc_queue_try_pop(&q, &value));
+	for (value = 0; value < mpmc_queue_capacity(&q); ++value)
+	{
+		ENSURE(mpmc_queue_try_push(&q, &value));
+	}
+	ENSURE(!mpmc_queue_try_push(&q, &value));
+	for (i = 0; i < mpmc_queue_capacity(&q); ++i)
+	{
+		ENSURE(mpmc_queue_try_pop(&q, &value));
+		ENSURE(value == i);
+	}
+	ENSURE(!mpmc_queue_try_pop(&q, &value));
+
+	memset(producer_states, 0, sizeof(producer_states));
+	memset(consumer_states, 0, sizeof(consumer_states));
+	for (i = 0; i < stress_consumers; ++i)
+	{
+		consumer_states[i].q = &q;
+		ENSURE(pthread_create(&consumers[i], 0, mpmc_consumer, &consumer_states[i]) == 0);
+	}
+	for (i = 0; i < stress_producers; ++i)
+	{
+		producer_states[i].q = &q;
+		producer_states[i].id = i;
+		ENSURE(pthread_create(&producers[i], 0, mpmc_producer, &producer_states[i]) == 0);
+	}
+	for (i = 0; i < stress_producers; ++i)
+	{
+		ENSURE(pthread_join(producers[i], 0) == 0);
+	}
+	for (i = 0; i < stress_consumers; ++i)
+	{
+		ENSURE(pthread_join(consumers[i], 0) == 0);
+		sum += consumer_states[i].sum;
+	}
+	ENSURE(sum == (unsigned long long)stress_producers * stress_count * (stress_count - 1) / 2);
+	ENSURE(!mpmc_queue_try_pop(&q, &value));
+	mpmc_queue_destroy(&q);
+}
+#endif
+
+#ifdef CONTAINERS_CONCURRENT
+typedef struct concurrent_worker
+{
+	concurrent_hash_map *map;
+	map_key first;
+	size_t found;
+}
+concurrent_worker;
+
+enum
+{
+	concurrent_threads = 8,
+	concurrent_keys = 20000
+};
+
+/* inserts its own range while looking up the ranges of the others */
+static void *concurrent_hash_map_worker(void *argument)
+{
+	concurrent_worker *w = argument;
+	map_key i;
+	for (i = 0; i < concurrent_keys; ++i)
+	{
+		const map_key key = w->first + i;
+		const map_key other = (key * 7) % (concurrent_threads * concurrent_keys);
+		const long long value = key * 3;
+		long long found = -1;
+		ENSURE(concurrent_hash_map_insert(w->map, &key, &value));
+		ENSURE(concurrent_hash_map_find(w->map, &key, &found));
+		ENSURE(found == value);
+		if (concurrent_hash_map_find(w->map, &other, &found))
+		{
+			/* a value is never seen half written */
+			ENSURE(found == other * 3);
+			++(w->found);
+		}
+		if (i % 4 == 0)
+		{
+			ENSURE(concurrent_hash_map_erase(w->map, &key));
+			ENSURE(!concurrent_hash_map_find(w->map, &key, 0));
+		}
+	}
+	return 0;
+}
+
+static void test_concurrent_hash_map()
+{
+	concurrent_hash_map map;
+	pthread_t threads[concurrent_threads];
+	concurrent_worker workers[concurrent_threads];
+	map_key key;
+	long long value;
+	size_t i;
+
+	ENSURE(concurrent_hash_map_create(&map, sizeof(map_key), sizeof(value), hash, 0, 6));
+	ENSURE(concurrent_hash_map_shard_count(&map) == 8);
+	ENSURE(concurrent_hash_map_reserve(&map, 1000));
+
+	for (i = 0; i < concurrent_threads; ++i)
+	{
+		workers[i].map = &map;
+		workers[i].first = (map_key)(i * concurrent_keys);
+		workers[i].found = 0;
+		ENSURE(pthread_create(&threads[i], 0, concurrent_hash_map_worker, &workers[i]) == 0);
+	}
+	for (i = 0; i < concurrent_threads; ++i)
+	{
+		ENSURE(pthread_join(threads[i], 0) == 0);
+	}
+
+	ENSURE(concurrent_hash_map_size(&map) == concurrent_threads * concurrent_keys * 3 / 4);
+	for (key = 0; key < concurrent_threads * concurrent_keys; ++key)
+	{
+		const int present = concurrent_hash_map_find(&map, &key, &value);
+		ENSURE(present == ((key % concurrent_keys) % 4 != 0));
+		ENSURE(!present || (value == key * 3));
+	}
+
+	/* keys spread over every shard */
+	for (i = 0; i < concurrent_hash_map_shard_count(&map); ++i)
+	{
+		ENSURE(hash_map_size(&map.shards[i].map) > 0);
+	}
+	concurrent_hash_map_destroy(&map);
+}
+#endif
+
 int main()
 {
 	size_t i;
@@ -283,11 +1285,30 @@ int main()
 	for (i = 0; i < 4; ++i)
 	{
 		test_hash_map();
+		test_hash_map_growth();
+		test_hash_map_growth_keeps_hashes();
+		test_hash_map_insert_n();
 		test_hash_set();
+		test_hash_set_algebra();
+		test_hash_functions();
 		test_vector();
+		test_vector_both_ends();
+		test_vector_bulk();
 		test_queue();
+		test_queue_blocks();
 		test_stack();
 		test_tree_map();
+		test_tree_map_against_reference();
+		test_tree_map_iteration();
+		test_pool();
+		test_containers_with_allocators();
+#ifdef CONTAINERS_LOCK_FREE
+		test_spsc_queue();
+		test_mpmc_queue();
+#endif
+#ifdef CONTAINERS_CONCURRENT
+		test_concurrent_hash_map();
+#endif
 	}
 
 	return 0;
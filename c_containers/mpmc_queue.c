@@ -0,0 +1,169 @@
+#include "mpmc_queue.h"
+#include "backoff.h"
+#include <assert.h>
+#include <string.h>
+
+
+/*
+ * A cell is ready for the producer of position p when its sequence is p
+ * and ready for the consumer of position p when its sequence is p + 1.
+ * The consumer hands it to the next lap by setting p + capacity.
+ */
+typedef struct mpmc_cell
+{
+	atomic_size_t sequence;
+}
+mpmc_cell;
+
+static size_t round_up_to_power_of_two(size_t value)
+{
+	size_t result = 1;
+	while (result < value)
+	{
+		assert((result * 2) > result);
+		result *= 2;
+	}
+	return result;
+}
+
+static mpmc_cell *get_cell(const mpmc_queue *q, size_t position)
+{
+	return (mpmc_cell *)(q->cells + ((position & (q->capacity - 1)) * q->cell_size));
+}
+
+static char *cell_value(mpmc_cell *cell)
+{
+	return (char *)cell + allocator_align(sizeof(mpmc_cell));
+}
+
+
+int mpmc_queue_create(mpmc_queue *q, size_t value_size, size_t capacity)
+{
+	const allocator heap = heap_allocator();
+	return mpmc_queue_create_with_allocator(q, value_size, capacity, &heap);
+}
+
+int mpmc_queue_create_with_allocator(mpmc_queue *q, size_t value_size, size_t capacity, const allocator *a)
+{
+	size_t i;
+	assert(capacity > 0);
+	q->allocator = *a;
+	q->value_size = value_size;
+	q->cell_size = allocator_align(allocator_align(sizeof(mpmc_cell)) + value_size);
+	/* two cells at least, so that a full queue can be told from an empty one */
+	q->capacity = round_up_to_power_of_two((capacity < 2) ? 2 : capacity);
+	q->cells = allocator_allocate(&q->allocator, q->capacity * q->cell_size);
+	if (!q->cells)
+	{
+		return 0;
+	}
+	for (i = 0; i < q->capacity; ++i)
+	{
+		atomic_init(&get_cell(q, i)->sequence, i);
+	}
+	atomic_init(&q->enqueue_position, 0);
+	atomic_init(&q->dequeue_position, 0);
+	return 1;
+}
+
+void mpmc_queue_destroy(mpmc_queue *q)
+{
+	allocator_deallocate(&q->allocator, q->cells, q->capacity * q->cell_size);
+}
+
+int mpmc_queue_try_push(mpmc_queue *q, const void *element)
+{
+	size_t position = atomic_load_explicit(&q->enqueue_position, memory_order_relaxed);
+	mpmc_cell *cell;
+	for (;;)
+	{
+		size_t sequence;
+		cell = get_cell(q, position);
+		sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		if (sequence == position)
+		{
+			if (atomic_compare_exchange_weak_explicit(
+				&q->enqueue_position,
+				&position,
+				position + 1,
+				memory_order_relaxed,
+				memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if ((ptrdiff_t)(sequence - position) < 0)
+		{
+			/* the consumer of the previous lap has not released this cell yet */
+			return 0;
+		}
+		else
+		{
+			position = atomic_load_explicit(&q->enqueue_position, memory_order_relaxed);
+		}
+	}
+	memcpy(cell_value(cell), element, q->value_size);
+	atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+	return 1;
+}
+
+int mpmc_queue_try_pop(mpmc_queue *q, void *element)
+{
+	size_t position = atomic_load_explicit(&q->dequeue_position, memory_order_relaxed);
+	mpmc_cell *cell;
+	for (;;)
+	{
+		size_t sequence;
+		cell = get_cell(q, position);
+		sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		if (sequence == (position + 1))
+		{
+			if (atomic_compare_exchange_weak_explicit(
+				&q->dequeue_position,
+				&position,
+				position + 1,
+				memory_order_relaxed,
+				memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if ((ptrdiff_t)(sequence - (position + 1)) < 0)
+		{
+			/* no producer has filled this cell yet */
+			return 0;
+		}
+		else
+		{
+			position = atomic_load_explicit(&q->dequeue_position, memory_order_relaxed);
+		}
+	}
+	memcpy(element, cell_value(cell), q->value_size);
+	atomic_store_explicit(&cell->sequence, position + q->capacity, memory_order_release);
+	return 1;
+}
+
+void mpmc_queue_push(mpmc_queue *q, const void *element)
+{
+	backoff b;
+	backoff_create(&b);
+	while (!mpmc_queue_try_push(q, element))
+	{
+		backoff_wait(&b);
+	}
+}
+
+void mpmc_queue_pop(mpmc_queue *q, void *element)
+{
+	backoff b;
+	backoff_create(&b);
+	while (!mpmc_queue_try_pop(q, element))
+	{
+		backoff_wait(&b);
+	}
+}
+
+size_t mpmc_queue_capacity(const mpmc_queue *q)
+{
+	return q->capacity;
+}
@@ -0,0 +1,46 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+
+#include "allocator.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+
+#define MPMC_QUEUE_CACHE_LINE 64
+
+/*
+ * Bounded ring buffer for any number of producer and consumer threads.
+ * Every cell carries a sequence number that tells whether it is ready to
+ * be written or read in the current lap, so producers and consumers only
+ * contend on their own position counter.
+ */
+typedef struct mpmc_queue
+{
+	char *cells;
+	size_t value_size;
+	size_t cell_size;
+	size_t capacity;
+	allocator allocator;
+	char padding0[MPMC_QUEUE_CACHE_LINE];
+
+	atomic_size_t enqueue_position;
+	char padding1[MPMC_QUEUE_CACHE_LINE - sizeof(atomic_size_t)];
+
+	atomic_size_t dequeue_position;
+	char padding2[MPMC_QUEUE_CACHE_LINE - sizeof(atomic_size_t)];
+}
+mpmc_queue;
+
+
+int mpmc_queue_create(mpmc_queue *q, size_t value_size, size_t capacity);
+int mpmc_queue_create_with_allocator(mpmc_queue *q, size_t value_size, size_t capacity, const allocator *a);
+void mpmc_queue_destroy(mpmc_queue *q);
+int mpmc_queue_try_push(mpmc_queue *q, const void *element);
+int mpmc_queue_try_pop(mpmc_queue *q, void *element);
+void mpmc_queue_push(mpmc_queue *q, const void *element);
+void mpmc_queue_pop(mpmc_queue *q, void *element);
+size_t mpmc_queue_capacity(const mpmc_queue *q);
+
+
+#endif
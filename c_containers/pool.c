@@ -0,0 +1,142 @@
+#include "pool.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+struct pool_slab
+{
+	pool_slab *next;
+};
+
+static void *pool_allocator_allocate(void *state, size_t size)
+{
+	pool * const p = state;
+	if (size > p->block_size)
+	{
+		return malloc(size);
+	}
+	return pool_allocate(p);
+}
+
+static void *pool_allocator_reallocate(void *state, void *memory, size_t old_size, size_t new_size)
+{
+	pool * const p = state;
+	void *moved;
+	if (!memory)
+	{
+		return pool_allocator_allocate(p, new_size);
+	}
+	if ((old_size > p->block_size) &&
+		(new_size > p->block_size))
+	{
+		return realloc(memory, new_size);
+	}
+	if ((old_size <= p->block_size) &&
+		(new_size <= p->block_size))
+	{
+		return memory;
+	}
+	moved = pool_allocator_allocate(p, new_size);
+	if (moved)
+	{
+		memcpy(moved, memory, (old_size < new_size) ? old_size : new_size);
+		if (old_size > p->block_size)
+		{
+			free(memory);
+		}
+		else
+		{
+			pool_deallocate(p, memory);
+		}
+	}
+	return moved;
+}
+
+static void pool_allocator_deallocate(void *state, void *memory, size_t size)
+{
+	pool * const p = state;
+	if (size > p->block_size)
+	{
+		free(memory);
+	}
+	else
+	{
+		pool_deallocate(p, memory);
+	}
+}
+
+
+void pool_create(pool *p, size_t block_size, size_t slab_blocks)
+{
+	assert(slab_blocks > 0);
+	if (block_size < sizeof(void *))
+	{
+		block_size = sizeof(void *);
+	}
+	p->block_size = allocator_align(block_size);
+	p->slab_blocks = slab_blocks;
+	p->slabs = 0;
+	p->unused = p->unused_end = 0;
+	p->free_list = 0;
+}
+
+void pool_destroy(pool *p)
+{
+	while (p->slabs)
+	{
+		pool_slab * const next = p->slabs->next;
+		free(p->slabs);
+		p->slabs = next;
+	}
+	p->unused = p->unused_end = 0;
+	p->free_list = 0;
+}
+
+void *pool_allocate(pool *p)
+{
+	void *block;
+
+	if (p->free_list)
+	{
+		block = p->free_list;
+		memcpy(&p->free_list, block, sizeof(p->free_list));
+		return block;
+	}
+
+	if (p->unused == p->unused_end)
+	{
+		const size_t header = allocator_align(sizeof(pool_slab));
+		pool_slab * const slab = malloc(header + (p->block_size * p->slab_blocks));
+		if (!slab)
+		{
+			return 0;
+		}
+		slab->next = p->slabs;
+		p->slabs = slab;
+		p->unused = ((char *)slab) + header;
+		p->unused_end = p->unused + (p->block_size * p->slab_blocks);
+	}
+
+	block = p->unused;
+	p->unused += p->block_size;
+	return block;
+}
+
+void pool_deallocate(pool *p, void *block)
+{
+	assert(block);
+	memcpy(block, &p->free_list, sizeof(p->free_list));
+	p->free_list = block;
+}
+
+allocator pool_allocator(pool *p)
+{
+	allocator result;
+	result.allocate = pool_allocator_allocate;
+	result.allocate_zeroed = 0;
+	result.reallocate = pool_allocator_reallocate;
+	result.deallocate = pool_allocator_deallocate;
+	result.state = p;
+	return result;
+}
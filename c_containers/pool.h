@@ -0,0 +1,33 @@
+#ifndef POOL_H
+#define POOL_H
+
+
+#include "allocator.h"
+
+
+typedef struct pool_slab pool_slab;
+
+/*
+ * Fixed-size blocks carved from large slabs and recycled through a free
+ * list. Requests larger than the block size fall back to the heap.
+ */
+typedef struct pool
+{
+	size_t block_size;
+	size_t slab_blocks;
+	pool_slab *slabs;
+	char *unused;
+	char *unused_end;
+	void *free_list;
+}
+pool;
+
+
+void pool_create(pool *p, size_t block_size, size_t slab_blocks);
+void pool_destroy(pool *p);
+void *pool_allocate(pool *p);
+void pool_deallocate(pool *p, void *block);
+allocator pool_allocator(pool *p);
+
+
+#endif
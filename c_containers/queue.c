@@ -1,42 +1,184 @@
 #include "queue.h"
+#include <assert.h>
+#include <string.h>
+
+
+enum
+{
+	block_bytes = 4096,
+	minimum_block_capacity = 8,
+	spare_limit = 4
+};
+
+struct queue_block
+{
+	queue_block *next;
+};
+
+static size_t block_header_size(void)
+{
+	return allocator_align(sizeof(queue_block));
+}
+
+static size_t block_size(const queue *q)
+{
+	return block_header_size() + (q->block_capacity * q->value_size);
+}
+
+static char *block_element(const queue *q, const queue_block *block, size_t index)
+{
+	return (char *)block + block_header_size() + (index * q->value_size);
+}
+
+static queue_block *acquire_block(queue *q)
+{
+	queue_block *block = q->spare;
+	if (block)
+	{
+		q->spare = block->next;
+		--(q->spare_count);
+	}
+	else
+	{
+		block = allocator_allocate(&q->allocator, block_size(q));
+		if (!block)
+		{
+			return 0;
+		}
+	}
+	block->next = 0;
+	return block;
+}
+
+static void release_block(queue *q, queue_block *block)
+{
+	if (q->spare_count < spare_limit)
+	{
+		block->next = q->spare;
+		q->spare = block;
+		++(q->spare_count);
+	}
+	else
+	{
+		allocator_deallocate(&q->allocator, block, block_size(q));
+	}
+}
+
+static void free_chain(queue *q, queue_block *block)
+{
+	while (block)
+	{
+		queue_block * const next = block->next;
+		allocator_deallocate(&q->allocator, block, block_size(q));
+		block = next;
+	}
+}
 
 
 void queue_create(queue *q, size_t value_size)
 {
-	linked_list_create(&q->list, value_size);
+	const allocator heap = heap_allocator();
+	queue_create_with_allocator(q, value_size, &heap);
+}
+
+void queue_create_with_allocator(queue *q, size_t value_size, const allocator *a)
+{
+	const size_t capacity = value_size ? ((block_bytes - block_header_size()) / value_size) : block_bytes;
+	q->value_size = value_size;
+	q->block_capacity = (capacity < minimum_block_capacity) ? minimum_block_capacity : capacity;
+	q->head = q->tail = 0;
+	q->head_index = q->tail_index = 0;
+	q->size = 0;
+	q->spare = 0;
+	q->spare_count = 0;
+	q->allocator = *a;
 }
 
 void queue_destroy(queue *q)
 {
-	linked_list_destroy(&q->list);
+	if (allocator_frees_in_bulk(&q->allocator))
+	{
+		return;
+	}
+	free_chain(q, q->head);
+	free_chain(q, q->spare);
 }
 
 int queue_push(queue *q, const void *element)
 {
-	return linked_list_push_back(&q->list, element);
+	if (!q->tail ||
+		(q->tail_index == q->block_capacity))
+	{
+		queue_block * const block = acquire_block(q);
+		if (!block)
+		{
+			return 0;
+		}
+		if (q->tail)
+		{
+			q->tail->next = block;
+		}
+		else
+		{
+			q->head = block;
+			q->head_index = 0;
+		}
+		q->tail = block;
+		q->tail_index = 0;
+	}
+	memcpy(block_element(q, q->tail, q->tail_index), element, q->value_size);
+	++(q->tail_index);
+	++(q->size);
+	return 1;
 }
 
 const void *queue_front(const queue *q)
 {
-	return linked_list_front(&q->list);
+	assert(!queue_empty(q));
+	return block_element(q, q->head, q->head_index);
 }
 
 void queue_pop(queue *q)
 {
-	linked_list_pop_front(&q->list);
+	assert(!queue_empty(q));
+
+	++(q->head_index);
+	--(q->size);
+
+	if (!q->size)
+	{
+		/* start over at the beginning of the block that is left */
+		assert(q->head == q->tail);
+		q->head_index = q->tail_index = 0;
+	}
+	else if (q->head_index == q->block_capacity)
+	{
+		queue_block * const emptied = q->head;
+		q->head = emptied->next;
+		q->head_index = 0;
+		release_block(q, emptied);
+	}
 }
 
 void queue_clear(queue *q)
 {
-	linked_list_clear(&q->list);
+	while (q->head &&
+		(q->head != q->tail))
+	{
+		queue_block * const emptied = q->head;
+		q->head = emptied->next;
+		release_block(q, emptied);
+	}
+	q->head_index = q->tail_index = 0;
+	q->size = 0;
 }
 
 size_t queue_size(const queue *q)
 {
-	return linked_list_size(&q->list);
+	return q->size;
 }
 
 int queue_empty(const queue *q)
 {
-	return linked_list_empty(&q->list);
+	return q->size == 0;
 }
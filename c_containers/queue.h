@@ -2,17 +2,36 @@
 #define QUEUE_H
 
 
-#include "linked_list.h"
+#include "allocator.h"
+#include <stddef.h>
 
 
+typedef struct queue_block queue_block;
+
+/*
+ * FIFO over a chain of fixed-size blocks of elements. Pushing appends to
+ * the last block and popping consumes the first one. Emptied blocks are
+ * kept in a short free list and reused, so a queue that stays around the
+ * same length stops allocating.
+ */
 typedef struct queue
 {
-	linked_list list;
+	size_t value_size;
+	size_t block_capacity;
+	queue_block *head;
+	queue_block *tail;
+	size_t head_index;
+	size_t tail_index;
+	size_t size;
+	queue_block *spare;
+	size_t spare_count;
+	allocator allocator;
 }
 queue;
 
 
 void queue_create(queue *q, size_t value_size);
+void queue_create_with_allocator(queue *q, size_t value_size, const allocator *a);
 void queue_destroy(queue *q);
 int queue_push(queue *q, const void *element);
 const void *queue_front(const queue *q);
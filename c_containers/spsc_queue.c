@@ -0,0 +1,103 @@
+#include "spsc_queue.h"
+#include "backoff.h"
+#include <assert.h>
+#include <string.h>
+
+
+static size_t round_up_to_power_of_two(size_t value)
+{
+	size_t result = 1;
+	while (result < value)
+	{
+		assert((result * 2) > result);
+		result *= 2;
+	}
+	return result;
+}
+
+
+int spsc_queue_create(spsc_queue *q, size_t value_size, size_t capacity)
+{
+	const allocator heap = heap_allocator();
+	return spsc_queue_create_with_allocator(q, value_size, capacity, &heap);
+}
+
+int spsc_queue_create_with_allocator(spsc_queue *q, size_t value_size, size_t capacity, const allocator *a)
+{
+	assert(capacity > 0);
+	q->allocator = *a;
+	q->value_size = value_size;
+	q->capacity = round_up_to_power_of_two(capacity);
+	q->elements = allocator_allocate(&q->allocator, q->capacity * value_size);
+	if (!q->elements)
+	{
+		return 0;
+	}
+	atomic_init(&q->tail, 0);
+	atomic_init(&q->head, 0);
+	q->cached_head = 0;
+	q->cached_tail = 0;
+	return 1;
+}
+
+void spsc_queue_destroy(spsc_queue *q)
+{
+	allocator_deallocate(&q->allocator, q->elements, q->capacity * q->value_size);
+}
+
+int spsc_queue_try_push(spsc_queue *q, const void *element)
+{
+	const size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	if ((tail - q->cached_head) == q->capacity)
+	{
+		q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+		if ((tail - q->cached_head) == q->capacity)
+		{
+			return 0;
+		}
+	}
+	memcpy(q->elements + ((tail & (q->capacity - 1)) * q->value_size), element, q->value_size);
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+	return 1;
+}
+
+int spsc_queue_try_pop(spsc_queue *q, void *element)
+{
+	const size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	if (head == q->cached_tail)
+	{
+		q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+		if (head == q->cached_tail)
+		{
+			return 0;
+		}
+	}
+	memcpy(element, q->elements + ((head & (q->capacity - 1)) * q->value_size), q->value_size);
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+	return 1;
+}
+
+void spsc_queue_push(spsc_queue *q, const void *element)
+{
+	backoff b;
+	backoff_create(&b);
+	while (!spsc_queue_try_push(q, element))
+	{
+		backoff_wait(&b);
+	}
+}
+
+void spsc_queue_pop(spsc_queue *q, void *element)
+{
+	backoff b;
+	backoff_create(&b);
+	while (!spsc_queue_try_pop(q, element))
+	{
+		backoff_wait(&b);
+	}
+}
+
+size_t spsc_queue_capacity(const spsc_queue *q)
+{
+	return q->capacity;
+}
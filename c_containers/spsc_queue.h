@@ -0,0 +1,47 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+
+#include "allocator.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+
+#define SPSC_QUEUE_CACHE_LINE 64
+
+/*
+ * Bounded ring buffer for exactly one producer thread and one consumer
+ * thread. Each side owns one cache line with its index and a cached copy
+ * of the other side's index, so the lines only bounce when the cached
+ * copy runs out.
+ */
+typedef struct spsc_queue
+{
+	char *elements;
+	size_t value_size;
+	size_t capacity;
+	allocator allocator;
+	char padding0[SPSC_QUEUE_CACHE_LINE];
+
+	atomic_size_t tail;
+	size_t cached_head;
+	char padding1[SPSC_QUEUE_CACHE_LINE - sizeof(atomic_size_t) - sizeof(size_t)];
+
+	atomic_size_t head;
+	size_t cached_tail;
+	char padding2[SPSC_QUEUE_CACHE_LINE - sizeof(atomic_size_t) - sizeof(size_t)];
+}
+spsc_queue;
+
+
+int spsc_queue_create(spsc_queue *q, size_t value_size, size_t capacity);
+int spsc_queue_create_with_allocator(spsc_queue *q, size_t value_size, size_t capacity, const allocator *a);
+void spsc_queue_destroy(spsc_queue *q);
+int spsc_queue_try_push(spsc_queue *q, const void *element);
+int spsc_queue_try_pop(spsc_queue *q, void *element);
+void spsc_queue_push(spsc_queue *q, const void *element);
+void spsc_queue_pop(spsc_queue *q, void *element);
+size_t spsc_queue_capacity(const spsc_queue *q);
+
+
+#endif
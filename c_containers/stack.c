@@ -6,6 +6,11 @@ void stack_create(stack *s, size_t element_size)
 	vector_create(&s->storage, element_size);
 }
 
+void stack_create_with_allocator(stack *s, size_t element_size, const allocator *a)
+{
+	vector_create_with_allocator(&s->storage, element_size, a);
+}
+
 void stack_destroy(stack *s)
 {
 	vector_destroy(&s->storage);
@@ -13,6 +13,7 @@ stack;
 
 
 void stack_create(stack *s, size_t element_size);
+void stack_create_with_allocator(stack *s, size_t element_size, const allocator *a);
 void stack_destroy(stack *s);
 int stack_empty(const stack *s);
 int stack_push(stack *s, const void *element);
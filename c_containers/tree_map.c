@@ -1,114 +1,337 @@
 #include "tree_map.h"
 #include <assert.h>
 #include <string.h>
-#include <stdlib.h>
 
 
-typedef enum color_t
+enum
 {
-	Red,
-	Black,
+	/* a node spans this many bytes when the keys and values are small */
+	node_bytes = 512,
+	minimum_capacity = 4,
+
+	/* enough for any tree with a fan-out of at least two */
+	max_height = sizeof(size_t) * 8
+};
+
+/*
+ * The header is followed by the keys and values of a leaf or by the child
+ * pointers and keys of an inner node. Every node has room for one entry
+ * more than its capacity so that an insertion can overflow it before it is
+ * split. An inner node with count keys has count + 1 children, and every
+ * key is a lower bound of the subtree right of it.
+ */
+struct tree_node
+{
+	size_t count;
+	int is_leaf;
+	tree_node *next;
+};
+
+typedef struct tree_path_entry
+{
+	tree_node *node;
+	size_t child;
 }
-color_t;
+tree_path_entry;
 
-typedef enum child_t
+static size_t header_size(void)
 {
-	Left,
-	Right,
+	return allocator_align(sizeof(tree_node));
 }
-child_t;
 
-static child_t relationToChild(int relation)
+static char *leaf_keys(const tree_node *node)
 {
-	assert(relation != 0);
-	return (relation < 0) ? Left : Right;
+	return (char *)node + header_size();
 }
 
-struct tree_node
+static char *leaf_values(const tree_map *map, const tree_node *node)
 {
-	tree_node *parent;
-	tree_node *children[2];
-	color_t color;
-	char storage[0];
-};
+	return leaf_keys(node) + allocator_align((map->leaf_capacity + 1) * map->key_size);
+}
+
+static tree_node **inner_children(const tree_node *node)
+{
+	return (tree_node **)((char *)node + header_size());
+}
+
+static char *inner_keys(const tree_map *map, const tree_node *node)
+{
+	return (char *)inner_children(node) + allocator_align((map->inner_capacity + 2) * sizeof(tree_node *));
+}
+
+static char *node_keys(const tree_map *map, const tree_node *node)
+{
+	return node->is_leaf ? leaf_keys(node) : inner_keys(map, node);
+}
+
+static char *node_key(const tree_map *map, const tree_node *node, size_t index)
+{
+	return node_keys(map, node) + (index * map->key_size);
+}
+
+static char *leaf_value(const tree_map *map, const tree_node *node, size_t index)
+{
+	return leaf_values(map, node) + (index * map->value_size);
+}
+
+static size_t leaf_bytes(const tree_map *map)
+{
+	return header_size() +
+		allocator_align((map->leaf_capacity + 1) * map->key_size) +
+		((map->leaf_capacity + 1) * map->value_size);
+}
+
+static size_t inner_bytes(const tree_map *map)
+{
+	return header_size() +
+		allocator_align((map->inner_capacity + 2) * sizeof(tree_node *)) +
+		((map->inner_capacity + 1) * map->key_size);
+}
+
+static size_t node_capacity(size_t entry_size)
+{
+	const size_t capacity = (node_bytes - header_size()) / (entry_size ? entry_size : 1);
+	return (capacity < minimum_capacity) ? minimum_capacity : capacity;
+}
 
-static tree_node *allocate_node(const tree_map *map)
+static size_t node_minimum(const tree_map *map, const tree_node *node)
 {
-	tree_node *node = malloc(sizeof(*node) + map->key_size + map->value_size);
+	return (node->is_leaf ? map->leaf_capacity : map->inner_capacity) / 2;
+}
+
+static tree_node *allocate_node(const tree_map *map, int is_leaf)
+{
+	tree_node *node = allocator_allocate(&map->allocator, is_leaf ? leaf_bytes(map) : inner_bytes(map));
+	if (node)
+	{
+		node->count = 0;
+		node->is_leaf = is_leaf;
+		node->next = 0;
+	}
 	return node;
 }
 
-static void deallocate_node(tree_node *node)
+static void deallocate_node(const tree_map *map, tree_node *node)
 {
-	free(node);
+	allocator_deallocate(&map->allocator, node, node->is_leaf ? leaf_bytes(map) : inner_bytes(map));
 }
 
-static void destroy_nodes(tree_node *root)
+static void destroy_nodes(const tree_map *map, tree_node *root)
 {
-	size_t i;
-	for (i = 0; i < 2; ++i)
+	if (!root->is_leaf)
 	{
-		tree_node *child = root->children[i];
-		if (child)
+		size_t i;
+		for (i = 0; i <= root->count; ++i)
 		{
-			destroy_nodes(child);
+			destroy_nodes(map, inner_children(root)[i]);
 		}
 	}
-	deallocate_node(root);
+	deallocate_node(map, root);
 }
 
-static void *node_get_key(tree_node *node)
+/* index of the first key that is not less than key */
+static size_t node_lower_bound(const tree_map *map, const tree_node *node, const void *key)
 {
-	return node->storage;
+	const char * const keys = node_keys(map, node);
+	size_t begin = 0;
+	size_t end = node->count;
+	while (begin < end)
+	{
+		const size_t middle = begin + (end - begin) / 2;
+		if (map->comparator(keys + (middle * map->key_size), key, map->user_data) < 0)
+		{
+			begin = middle + 1;
+		}
+		else
+		{
+			end = middle;
+		}
+	}
+	return begin;
 }
 
-static void *node_get_value(tree_node *node, const tree_map *map)
+/* index of the first key that is greater than key */
+static size_t node_upper_bound(const tree_map *map, const tree_node *node, const void *key)
 {
-	return ((char *)node->storage) + map->key_size;
+	const char * const keys = node_keys(map, node);
+	size_t begin = 0;
+	size_t end = node->count;
+	while (begin < end)
+	{
+		const size_t middle = begin + (end - begin) / 2;
+		if (map->comparator(key, keys + (middle * map->key_size), map->user_data) < 0)
+		{
+			end = middle;
+		}
+		else
+		{
+			begin = middle + 1;
+		}
+	}
+	return begin;
 }
 
-static tree_node *find_node(tree_node *node, tree_map *map, const void *key)
+/* walks down to the leaf that may contain key and records the way */
+static tree_node *find_leaf(const tree_map *map, const void *key, tree_path_entry *path)
 {
+	tree_node *node = map->root;
+	size_t depth = 0;
 	assert(node);
-	assert(map);
-	assert(key);
+	while (!node->is_leaf)
+	{
+		const size_t child = node_upper_bound(map, node, key);
+		if (path)
+		{
+			path[depth].node = node;
+			path[depth].child = child;
+		}
+		++depth;
+		node = inner_children(node)[child];
+	}
+	assert(depth + 1 == map->height);
+	return node;
+}
+
+static void leaf_insert_at(const tree_map *map, tree_node *leaf, size_t index, const void *key, const void *value)
+{
+	char * const key_position = node_key(map, leaf, index);
+	char * const value_position = leaf_value(map, leaf, index);
+	memmove(key_position + map->key_size, key_position, (leaf->count - index) * map->key_size);
+	memmove(value_position + map->value_size, value_position, (leaf->count - index) * map->value_size);
+	memcpy(key_position, key, map->key_size);
+	memcpy(value_position, value, map->value_size);
+	++(leaf->count);
+}
+
+static void leaf_remove_at(const tree_map *map, tree_node *leaf, size_t index)
+{
+	char * const key_position = node_key(map, leaf, index);
+	char * const value_position = leaf_value(map, leaf, index);
+	--(leaf->count);
+	memmove(key_position, key_position + map->key_size, (leaf->count - index) * map->key_size);
+	memmove(value_position, value_position + map->value_size, (leaf->count - index) * map->value_size);
+}
+
+/* inserts key at index and child right of it */
+static void inner_insert_at(const tree_map *map, tree_node *node, size_t index, const void *key, tree_node *child)
+{
+	char * const key_position = node_key(map, node, index);
+	tree_node ** const children = inner_children(node);
+	memmove(key_position + map->key_size, key_position, (node->count - index) * map->key_size);
+	memmove(children + index + 2, children + index + 1, (node->count - index) * sizeof(*children));
+	memcpy(key_position, key, map->key_size);
+	children[index + 1] = child;
+	++(node->count);
+}
 
-	do
+/* removes key at index and the child right of it */
+static void inner_remove_at(const tree_map *map, tree_node *node, size_t index)
+{
+	char * const key_position = node_key(map, node, index);
+	tree_node ** const children = inner_children(node);
+	--(node->count);
+	memmove(key_position, key_position + map->key_size, (node->count - index) * map->key_size);
+	memmove(children + index + 1, children + index + 2, (node->count - index) * sizeof(*children));
+}
+
+/* moves the upper half of an overflowing node into right and returns the separator */
+static const void *split_node(const tree_map *map, tree_node *node, tree_node *right)
+{
+	const size_t middle = node->count / 2;
+	if (node->is_leaf)
+	{
+		right->count = node->count - middle;
+		memcpy(leaf_keys(right), node_key(map, node, middle), right->count * map->key_size);
+		memcpy(leaf_values(map, right), leaf_value(map, node, middle), right->count * map->value_size);
+		node->count = middle;
+		right->next = node->next;
+		node->next = right;
+		return leaf_keys(right);
+	}
+	else
 	{
-		int relation = map->comparator(
-			key,
-			node_get_key(node),
-			map->user_data
-			);
+		/* the middle key moves up, it stays readable behind the new end of node */
+		right->count = node->count - middle - 1;
+		memcpy(inner_keys(map, right), node_key(map, node, middle + 1), right->count * map->key_size);
+		memcpy(inner_children(right), inner_children(node) + middle + 1, (right->count + 1) * sizeof(tree_node *));
+		node->count = middle;
+		return node_key(map, node, middle);
+	}
+}
+
+/* restores the minimum fill of path[depth + 1] by borrowing or merging */
+static void rebalance(tree_map *map, tree_path_entry *path, size_t depth)
+{
+	tree_node * const parent = path[depth].node;
+	const size_t index = path[depth].child;
+	tree_node ** const siblings = inner_children(parent);
+	tree_node * const node = siblings[index];
+	tree_node * const left = (index > 0) ? siblings[index - 1] : 0;
+	tree_node * const right = (index < parent->count) ? siblings[index + 1] : 0;
 
-		if (relation == 0)
+	if (left && (left->count > node_minimum(map, left)))
+	{
+		if (node->is_leaf)
 		{
-			break;
+			leaf_insert_at(map, node, 0, node_key(map, left, left->count - 1), leaf_value(map, left, left->count - 1));
+			--(left->count);
+			memcpy(node_key(map, parent, index - 1), leaf_keys(node), map->key_size);
 		}
 		else
 		{
-			node = node->children[relationToChild(relation)];
+			tree_node ** const children = inner_children(node);
+			memmove(node_key(map, node, 1), node_key(map, node, 0), node->count * map->key_size);
+			memmove(children + 1, children, (node->count + 1) * sizeof(*children));
+			memcpy(node_key(map, node, 0), node_key(map, parent, index - 1), map->key_size);
+			children[0] = inner_children(left)[left->count];
+			++(node->count);
+			memcpy(node_key(map, parent, index - 1), node_key(map, left, left->count - 1), map->key_size);
+			--(left->count);
 		}
 	}
-	while (node);
-	return node;
-}
-
-static void node_remove_from_optional_parent(tree_node *node)
-{
-	tree_node *parent = node->parent;
-	if (parent)
+	else if (right && (right->count > node_minimum(map, right)))
 	{
-		size_t i;
-		for (i = 0; i < 2; ++i)
+		if (node->is_leaf)
 		{
-			if (parent->children[i] == node)
-			{
-				parent->children[i] = 0;
-				return;
-			}
+			leaf_insert_at(map, node, node->count, leaf_keys(right), leaf_values(map, right));
+			leaf_remove_at(map, right, 0);
+			memcpy(node_key(map, parent, index), leaf_keys(right), map->key_size);
+		}
+		else
+		{
+			tree_node ** const children = inner_children(right);
+			memcpy(node_key(map, node, node->count), node_key(map, parent, index), map->key_size);
+			inner_children(node)[node->count + 1] = children[0];
+			++(node->count);
+			memcpy(node_key(map, parent, index), inner_keys(map, right), map->key_size);
+			memmove(inner_keys(map, right), node_key(map, right, 1), (right->count - 1) * map->key_size);
+			memmove(children, children + 1, right->count * sizeof(*children));
+			--(right->count);
 		}
-		assert(!"broken parent/child relationship");
+	}
+	else
+	{
+		/* merge the right one of two neighbours into the left one */
+		tree_node * const into = left ? left : node;
+		tree_node * const from = left ? node : right;
+		const size_t separator = left ? (index - 1) : index;
+		assert(from);
+		if (into->is_leaf)
+		{
+			memcpy(node_key(map, into, into->count), leaf_keys(from), from->count * map->key_size);
+			memcpy(leaf_value(map, into, into->count), leaf_values(map, from), from->count * map->value_size);
+			into->count += from->count;
+			into->next = from->next;
+		}
+		else
+		{
+			memcpy(node_key(map, into, into->count), node_key(map, parent, separator), map->key_size);
+			memcpy(node_key(map, into, into->count + 1), inner_keys(map, from), from->count * map->key_size);
+			memcpy(inner_children(into) + into->count + 1, inner_children(from), (from->count + 1) * sizeof(tree_node *));
+			into->count += from->count + 1;
+		}
+		deallocate_node(map, from);
+		inner_remove_at(map, parent, separator);
 	}
 }
 
@@ -120,8 +343,24 @@ void tree_map_create(
 	tree_key_comparator_t comparator,
 	void *user_data)
 {
+	const allocator heap = heap_allocator();
+	tree_map_create_with_allocator(map, key_size, value_size, comparator, user_data, &heap);
+}
+
+void tree_map_create_with_allocator(
+	tree_map *map,
+	size_t key_size,
+	size_t value_size,
+	tree_key_comparator_t comparator,
+	void *user_data,
+	const allocator *a)
+{
+	map->allocator = *a;
 	map->key_size = key_size;
 	map->value_size = value_size;
+	map->leaf_capacity = node_capacity(key_size + value_size);
+	map->inner_capacity = node_capacity(key_size + sizeof(tree_node *));
+	map->height = 0;
 	map->root = 0;
 	map->comparator = comparator;
 	map->user_data = user_data;
@@ -129,121 +368,284 @@ void tree_map_create(
 
 void tree_map_destroy(tree_map *map)
 {
-	if (map->root)
+	if (map->root &&
+		!allocator_frees_in_bulk(&map->allocator))
 	{
-		destroy_nodes(map->root);
+		destroy_nodes(map, map->root);
 	}
 }
 
 int tree_map_insert(tree_map *map, const void *key, const void *value)
 {
-	if (map->root)
+	tree_path_entry path[max_height];
+	tree_node *spare[max_height + 1];
+	size_t spare_count = 0;
+	size_t needed = 1;
+	size_t depth;
+	tree_node *leaf;
+	size_t index;
+	const void *separator;
+	tree_node *right;
+
+	if (!map->root)
 	{
-		tree_node *node = map->root;
-		for (;;)
+		tree_node *root = allocate_node(map, 1);
+		if (!root)
 		{
-			int relation = map->comparator(
-				key,
-				node_get_key(node),
-				map->user_data
-				);
-
-			if (relation == 0)
-			{
-				memmove(
-					node_get_value(node, map),
-					value,
-					map->value_size
-					);
-				break;
-			}
-			else
-			{
-				const child_t childId = relationToChild(relation);
-				tree_node *child = node->children[childId];
-				if (child)
-				{
-					node = child;
-				}
-				else
-				{
-					child = allocate_node(map);;
-					if (!child)
-					{
-						return 0;
-					}
-					child->parent = node;
-					child->color = Red;
-					child->children[Left] = 0;
-					child->children[Right] = 0;
-					memmove(node_get_key(child), key, map->key_size);
-					memmove(node_get_value(child, map), value, map->value_size);
-
-					node->children[childId] = child;
-
-					//TODO: balancing
-					break;
-				}
-			}
+			return 0;
 		}
+		leaf_insert_at(map, root, 0, key, value);
+		map->root = root;
+		map->height = 1;
+		return 1;
+	}
 
+	leaf = find_leaf(map, key, path);
+	index = node_lower_bound(map, leaf, key);
+	if ((index < leaf->count) &&
+		!map->comparator(key, node_key(map, leaf, index), map->user_data))
+	{
+		memmove(leaf_value(map, leaf, index), value, map->value_size);
 		return 1;
 	}
-	else
+
+	if (leaf->count < map->leaf_capacity)
 	{
-		tree_node *root = allocate_node(map);
-		if (!root)
+		leaf_insert_at(map, leaf, index, key, value);
+		return 1;
+	}
+
+	/* allocate every node that the splits need before changing anything */
+	for (depth = map->height - 1; depth > 0; --depth)
+	{
+		if (path[depth - 1].node->count < map->inner_capacity)
+		{
+			break;
+		}
+		++needed;
+	}
+	if (depth == 0)
+	{
+		/* the root splits too and a new root is needed above it */
+		++needed;
+	}
+	for (; spare_count < needed; ++spare_count)
+	{
+		spare[spare_count] = allocate_node(map, spare_count == 0);
+		if (!spare[spare_count])
 		{
+			while (spare_count > 0)
+			{
+				deallocate_node(map, spare[--spare_count]);
+			}
 			return 0;
 		}
-		root->color = Black;
-		root->parent = 0;
-		root->children[Left] = 0;
-		root->children[Right] = 0;
-		memcpy(node_get_key(root), key, map->key_size);
-		memcpy(node_get_value(root, map), value, map->value_size);
+	}
+
+	leaf_insert_at(map, leaf, index, key, value);
+	right = spare[0];
+	separator = split_node(map, leaf, right);
+
+	for (depth = map->height - 1, spare_count = 1; depth > 0; --depth)
+	{
+		tree_node * const parent = path[depth - 1].node;
+		inner_insert_at(map, parent, path[depth - 1].child, separator, right);
+		if (parent->count <= map->inner_capacity)
+		{
+			return 1;
+		}
+		right = spare[spare_count++];
+		separator = split_node(map, parent, right);
+	}
+
+	{
+		tree_node * const root = spare[spare_count];
+		inner_children(root)[0] = map->root;
+		inner_insert_at(map, root, 0, separator, right);
 		map->root = root;
-		return 1;
+		++(map->height);
 	}
+	return 1;
 }
 
 void tree_map_erase(tree_map *map, const void *key)
 {
-	tree_node *root = map->root;
-	tree_node *found;
-	if (!root)
+	tree_path_entry path[max_height];
+	tree_node *leaf;
+	size_t index;
+	size_t depth;
+
+	if (!map->root)
+	{
+		return;
+	}
+
+	leaf = find_leaf(map, key, path);
+	index = node_lower_bound(map, leaf, key);
+	if ((index == leaf->count) ||
+		map->comparator(key, node_key(map, leaf, index), map->user_data))
 	{
 		return;
 	}
-	found = find_node(root, map, key);
-	if (found)
+	leaf_remove_at(map, leaf, index);
+
+	for (depth = map->height - 1; depth > 0; --depth)
 	{
-		//TODO
-		//TODO: balancing
+		tree_node * const node = inner_children(path[depth - 1].node)[path[depth - 1].child];
+		if (node->count >= node_minimum(map, node))
+		{
+			return;
+		}
+		rebalance(map, path, depth - 1);
+	}
+
+	if (map->root->count == 0)
+	{
+		tree_node * const old_root = map->root;
+		map->root = old_root->is_leaf ? 0 : inner_children(old_root)[0];
+		--(map->height);
+		deallocate_node(map, old_root);
 	}
 }
 
 void *tree_map_find(tree_map *map, const void *key)
 {
-	tree_node *root = map->root;
-	tree_node *found;
-	if (!root)
+	tree_node *leaf;
+	size_t index;
+	if (!map->root)
 	{
 		return 0;
 	}
-	found = find_node(root, map, key);
-	return found ?
-		node_get_value(found, map) :
-		0;
+	leaf = find_leaf(map, key, 0);
+	index = node_lower_bound(map, leaf, key);
+	if ((index < leaf->count) &&
+		!map->comparator(key, node_key(map, leaf, index), map->user_data))
+	{
+		return leaf_value(map, leaf, index);
+	}
+	return 0;
 }
 
 void tree_map_clear(tree_map *map)
 {
-	size_t key_size = map->key_size;
-	size_t value_size = map->value_size;
-	tree_key_comparator_t comparator = map->comparator;
-	void *user_data = map->user_data;
-
 	tree_map_destroy(map);
-	tree_map_create(map, key_size, value_size, comparator, user_data);
+	map->root = 0;
+	map->height = 0;
+}
+
+tree_map_iterator tree_map_iterate(const tree_map *map)
+{
+	tree_map_iterator iterator;
+	tree_node *node = map->root;
+	while (node && !node->is_leaf)
+	{
+		node = inner_children(node)[0];
+	}
+	iterator.map = map;
+	iterator.leaf = node;
+	iterator.index = 0;
+	iterator.started = 0;
+	return iterator;
+}
+
+tree_map_iterator tree_map_lower_bound(const tree_map *map, const void *key)
+{
+	tree_map_iterator iterator = tree_map_iterate(map);
+	if (map->root)
+	{
+		iterator.leaf = find_leaf(map, key, 0);
+		iterator.index = node_lower_bound(map, iterator.leaf, key);
+	}
+	return iterator;
+}
+
+tree_map_iterator tree_map_upper_bound(const tree_map *map, const void *key)
+{
+	tree_map_iterator iterator = tree_map_iterate(map);
+	if (map->root)
+	{
+		iterator.leaf = find_leaf(map, key, 0);
+		iterator.index = node_upper_bound(map, iterator.leaf, key);
+	}
+	return iterator;
+}
+
+int tree_map_iterator_next(tree_map_iterator *iterator)
+{
+	if (iterator->started)
+	{
+		++(iterator->index);
+	}
+	iterator->started = 1;
+	while (iterator->leaf &&
+		(iterator->index >= iterator->leaf->count))
+	{
+		iterator->leaf = iterator->leaf->next;
+		iterator->index = 0;
+	}
+	return iterator->leaf != 0;
+}
+
+const void *tree_map_iterator_key(const tree_map_iterator *iterator)
+{
+	return node_key(iterator->map, iterator->leaf, iterator->index);
+}
+
+void *tree_map_iterator_value(const tree_map_iterator *iterator)
+{
+	return leaf_value(iterator->map, iterator->leaf, iterator->index);
+}
+
+int tree_map_visit_range(
+	const tree_map *map,
+	const void *begin,
+	const void *end,
+	tree_map_visitor_t visitor,
+	void *user_data)
+{
+	tree_node *leaf;
+	size_t index;
+
+	if (!map->root)
+	{
+		return 1;
+	}
+
+	if (begin)
+	{
+		leaf = find_leaf(map, begin, 0);
+		index = node_lower_bound(map, leaf, begin);
+	}
+	else
+	{
+		leaf = tree_map_iterate(map).leaf;
+		index = 0;
+	}
+
+	for (; leaf; leaf = leaf->next, index = 0)
+	{
+		size_t stop = leaf->count;
+
+		/* only the leaf that contains end needs a comparison per key */
+		if (end &&
+			leaf->count &&
+			(map->comparator(node_key(map, leaf, leaf->count - 1), end, map->user_data) >= 0))
+		{
+			stop = node_lower_bound(map, leaf, end);
+		}
+
+		for (; index < stop; ++index)
+		{
+			if (!visitor(node_key(map, leaf, index), leaf_value(map, leaf, index), user_data))
+			{
+				return 0;
+			}
+		}
+
+		if (stop < leaf->count)
+		{
+			break;
+		}
+	}
+	return 1;
 }
@@ -2,6 +2,7 @@
 #define TREE_MAP_H
 
 
+#include "allocator.h"
 #include <stddef.h>
 
 
@@ -9,16 +10,43 @@ typedef struct tree_node tree_node;
 
 typedef int (*tree_key_comparator_t)(const void *left, const void *right, void *user_data);
 
+/* returns 0 to stop a range visit */
+typedef int (*tree_map_visitor_t)(const void *key, void *value, void *user_data);
+
+/*
+ * B+-tree. Every node holds its keys contiguously and is sized to span a
+ * few cache lines. Values live only in the leaves, which are linked in key
+ * order. Values move when nodes split or merge, so a pointer returned by
+ * tree_map_find is valid until the next insertion or erasure.
+ */
 typedef struct tree_map
 {
 	size_t key_size;
 	size_t value_size;
+	size_t leaf_capacity;
+	size_t inner_capacity;
+	size_t height;
 	tree_node *root;
 	tree_key_comparator_t comparator;
 	void *user_data;
+	allocator allocator;
 }
 tree_map;
 
+/*
+ * Starts before an element; tree_map_iterator_next moves onto it and
+ * returns 0 once the elements are exhausted. Walks the linked leaves,
+ * so iteration neither allocates nor recurses.
+ */
+typedef struct tree_map_iterator
+{
+	const tree_map *map;
+	tree_node *leaf;
+	size_t index;
+	int started;
+}
+tree_map_iterator;
+
 
 void tree_map_create(
 	tree_map *map,
@@ -26,11 +54,38 @@ void tree_map_create(
 	size_t value_size,
 	tree_key_comparator_t comparator,
 	void *user_data);
+void tree_map_create_with_allocator(
+	tree_map *map,
+	size_t key_size,
+	size_t value_size,
+	tree_key_comparator_t comparator,
+	void *user_data,
+	const allocator *a);
 void tree_map_destroy(tree_map *map);
 int tree_map_insert(tree_map *map, const void *key, const void *value);
 void tree_map_erase(tree_map *map, const void *key);
 void *tree_map_find(tree_map *map, const void *key);
 void tree_map_clear(tree_map *map);
 
+tree_map_iterator tree_map_iterate(const tree_map *map);
+/* before the first element whose key is not less than key */
+tree_map_iterator tree_map_lower_bound(const tree_map *map, const void *key);
+/* before the first element whose key is greater than key */
+tree_map_iterator tree_map_upper_bound(const tree_map *map, const void *key);
+int tree_map_iterator_next(tree_map_iterator *iterator);
+const void *tree_map_iterator_key(const tree_map_iterator *iterator);
+void *tree_map_iterator_value(const tree_map_iterator *iterator);
+/*
+ * Calls visitor for every element with begin <= key < end in key order;
+ * end is exclusive. A null begin or end leaves that side unbounded. Returns
+ * 0 if the visitor stopped the visit, 1 otherwise.
+ */
+int tree_map_visit_range(
+	const tree_map *map,
+	const void *begin,
+	const void *end,
+	tree_map_visitor_t visitor,
+	void *user_data);
+
 
 #endif
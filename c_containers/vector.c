@@ -1,20 +1,137 @@
 #include "vector.h"
-#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 
 
+static char *vector_buffer(const vector *v)
+{
+	if (!v->elements)
+	{
+		return 0;
+	}
+	return ((char *)v->elements) - (v->front * v->element_size);
+}
+
+static size_t vector_grown_capacity(size_t capacity, size_t needed)
+{
+	size_t result = capacity * 2;
+	if (result < needed)
+	{
+		result = needed;
+	}
+	if (result < 4)
+	{
+		result = 4;
+	}
+	return result;
+}
+
+/* moves the elements into a buffer of capacity slots, front of them unused */
+static int vector_reallocate(vector *v, size_t capacity, size_t front)
+{
+	char *const old_buffer = vector_buffer(v);
+	char *buffer;
+
+	if (old_buffer &&
+		(old_buffer != v->small_buffer) &&
+		(front == v->front))
+	{
+		buffer = allocator_reallocate(
+			&v->allocator,
+			old_buffer,
+			v->capacity * v->element_size,
+			capacity * v->element_size);
+		if (!buffer)
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		buffer = allocator_allocate(&v->allocator, capacity * v->element_size);
+		if (!buffer)
+		{
+			return 0;
+		}
+		if (v->size)
+		{
+			memcpy(buffer + (front * v->element_size), v->elements, v->size * v->element_size);
+		}
+		if (old_buffer &&
+			(old_buffer != v->small_buffer))
+		{
+			allocator_deallocate(&v->allocator, old_buffer, v->capacity * v->element_size);
+		}
+	}
+
+	v->elements = buffer + (front * v->element_size);
+	v->capacity = capacity;
+	v->front = front;
+	return 1;
+}
+
+/* copies fill to the first element, then doubles the initialized prefix */
+static void vector_fill_range(char *p, size_t count, size_t element_size, const void *fill)
+{
+	const size_t total = count * element_size;
+	size_t filled;
+
+	if (!count)
+	{
+		return;
+	}
+	if (element_size == 1)
+	{
+		memset(p, *(const unsigned char *)fill, count);
+		return;
+	}
+
+	memmove(p, fill, element_size);
+	for (filled = element_size; filled < total; )
+	{
+		const size_t chunk = ((total - filled) < filled) ? (total - filled) : filled;
+		memcpy(p + filled, p, chunk);
+		filled += chunk;
+	}
+}
+
+
 void vector_create(vector *v, size_t element_size)
+{
+	const allocator heap = heap_allocator();
+	vector_create_with_allocator(v, element_size, &heap);
+}
+
+void vector_create_with_allocator(vector *v, size_t element_size, const allocator *a)
 {
 	v->elements = 0;
 	v->element_size = element_size;
 	v->size = 0;
 	v->capacity = 0;
+	v->front = 0;
+	v->small_buffer = 0;
+	v->allocator = *a;
+}
+
+void vector_create_with_buffer(vector *v, size_t element_size, void *buffer, size_t capacity)
+{
+	vector_create(v, element_size);
+	if (capacity)
+	{
+		v->elements = buffer;
+		v->capacity = capacity;
+		v->small_buffer = buffer;
+	}
 }
 
 void vector_destroy(vector *v)
 {
-	free(v->elements);
+	char *const buffer = vector_buffer(v);
+	if (buffer &&
+		(buffer != v->small_buffer))
+	{
+		allocator_deallocate(&v->allocator, buffer, v->capacity * v->element_size);
+	}
 }
 
 int vector_empty(const vector *v)
@@ -29,7 +146,7 @@ size_t vector_size(const vector *v)
 
 size_t vector_capacity(const vector *v)
 {
-	return v->capacity;
+	return v->capacity - v->front;
 }
 
 int vector_push_back(vector *v, const void *element)
@@ -59,20 +176,17 @@ void *vector_get(vector *v, size_t index)
 
 int vector_resize(vector *v, size_t size, const void *fill)
 {
-	char *p, *end;
-
-	if (!vector_reserve(v, size))
-	{
-		return 0;
-	}
-
-	p = v->elements;
-	end = p + size;
-	p += v->size;
-
-	for (; p < end; p += v->element_size)
+	if (size > v->size)
 	{
-		memmove(p, fill, v->element_size);
+		if (!vector_reserve(v, size))
+		{
+			return 0;
+		}
+		vector_fill_range(
+			((char *)v->elements) + (v->size * v->element_size),
+			size - v->size,
+			v->element_size,
+			fill);
 	}
 
 	v->size = size;
@@ -81,48 +195,67 @@ int vector_resize(vector *v, size_t size, const void *fill)
 
 int vector_reserve(vector *v, size_t capacity)
 {
-	size_t real_capacity;
-	void *reallocated;
-
-	if (capacity <= v->capacity)
+	if ((v->front + capacity) <= v->capacity)
 	{
 		return 1;
 	}
 
-	real_capacity = v->capacity * 2;
-	if (real_capacity < capacity)
+	/*
+	 * Used like a queue, a vector accumulates free slots in front. Once
+	 * they make up half of the buffer, sliding the elements back costs
+	 * less than the pops that created them.
+	 */
+	if ((capacity <= v->capacity) &&
+		(v->size <= (v->capacity / 2)))
 	{
-		real_capacity = capacity;
+		char *const buffer = vector_buffer(v);
+		memmove(buffer, v->elements, v->size * v->element_size);
+		v->elements = buffer;
+		v->front = 0;
+		return 1;
 	}
-	if (real_capacity < 4)
+
+	return vector_reallocate(
+		v,
+		vector_grown_capacity(v->capacity, v->front + capacity),
+		v->front);
+}
+
+int vector_reserve_front(vector *v, size_t count)
+{
+	size_t front;
+
+	if (count <= v->front)
 	{
-		real_capacity = 4;
+		return 1;
 	}
 
-	reallocated = realloc(v->elements, real_capacity * v->element_size);
-	if (!reallocated)
+	/* leave as many free slots in front as there are elements so that push_front is amortized O(1) */
+	front = (v->size < 4) ? 4 : v->size;
+	if (front < count)
 	{
-		return 0;
+		front = count;
 	}
-
-	v->elements = reallocated;
-	v->capacity = real_capacity;
-	return 1;
+	return vector_reallocate(
+		v,
+		front + (v->capacity - v->front),
+		front);
 }
 
 void vector_clear(vector *v)
 {
+	/* the free slots in front become back capacity again */
+	if (v->elements)
+	{
+		v->elements = vector_buffer(v);
+	}
+	v->front = 0;
 	v->size = 0;
 }
 
 void vector_fill(vector *v, const void *fill)
 {
-	char *p = v->elements;
-	char *end = p + (v->element_size * v->size);
-	for (; p != end; p += v->element_size)
-	{
-		memmove(p, fill, v->element_size);
-	}
+	vector_fill_range(v->elements, v->size, v->element_size, fill);
 }
 
 void vector_erase(vector *v, size_t position)
@@ -133,19 +266,32 @@ void vector_erase(vector *v, size_t position)
 void vector_erase_n(vector *v, size_t begin, size_t end)
 {
 	const size_t erased = (end - begin);
-	char *dest = ((char *)v->elements) + (begin * v->element_size);
-	const char *src = ((char *)v->elements) + (end * v->element_size);
+	char *const elements = v->elements;
 
 	assert(begin <= v->size);
 	assert(end <= v->size);
 	assert(begin <= end);
 	assert(erased <= v->size);
 
-	memmove(
-		dest,
-		src,
-		(v->size - end)
-		);
+	/* move whichever side of the gap is shorter */
+	if (begin < (v->size - end))
+	{
+		memmove(
+			elements + (erased * v->element_size),
+			elements,
+			begin * v->element_size
+			);
+		v->elements = elements + (erased * v->element_size);
+		v->front += erased;
+	}
+	else
+	{
+		memmove(
+			elements + (begin * v->element_size),
+			elements + (end * v->element_size),
+			(v->size - end) * v->element_size
+			);
+	}
 
 	v->size -= erased;
 }
@@ -157,22 +303,67 @@ int vector_insert(vector *v, size_t position, const void *element)
 
 int vector_insert_n(vector *v, size_t position, const void *elements, size_t count)
 {
-	const size_t new_size = (v->size + count);
 	char *position_ptr;
-	if (!vector_reserve(v, new_size))
+
+	assert(position <= v->size);
+
+	/*
+	 * Insertions at the front open room there on purpose. Elsewhere the
+	 * prefix is shifted only if it is shorter and the room already exists.
+	 */
+	if ((position < (v->size - position)) &&
+		((position == 0) || (count <= v->front)))
 	{
-		return 0;
+		char *old_elements;
+		if (!vector_reserve_front(v, count))
+		{
+			return 0;
+		}
+
+		old_elements = v->elements;
+		v->elements = old_elements - (count * v->element_size);
+		v->front -= count;
+		memmove(
+			v->elements,
+			old_elements,
+			position * v->element_size
+			);
+		position_ptr = ((char *)v->elements) + (position * v->element_size);
+	}
+	else
+	{
+		if (!vector_reserve(v, v->size + count))
+		{
+			return 0;
+		}
+
+		position_ptr = ((char *)v->elements) + (position * v->element_size);
+		memmove(
+			position_ptr + (count * v->element_size),
+			position_ptr,
+			(v->size - position) * v->element_size
+			);
 	}
 
-	position_ptr = ((char *)v->elements) + (position * v->element_size);
 	memmove(
-		position_ptr + (count * v->element_size),
 		position_ptr,
-		(v->size - position) * v->element_size
+		elements,
+		count * v->element_size
 		);
 
-	memmove(
-		position_ptr,
+	v->size += count;
+	return 1;
+}
+
+int vector_append_n(vector *v, const void *elements, size_t count)
+{
+	if (!vector_reserve(v, v->size + count))
+	{
+		return 0;
+	}
+
+	memcpy(
+		((char *)v->elements) + (v->size * v->element_size),
 		elements,
 		count * v->element_size
 		);
@@ -2,23 +2,37 @@
 #define VECTOR_H
 
 
+#include "allocator.h"
 #include <stddef.h>
 
 
+/*
+ * The elements need not start at the beginning of the buffer: after
+ * vector_push_front or vector_pop_front there may be unused slots in
+ * front of them, so both ends grow and shrink in amortized O(1) like a
+ * deque. A vector created with vector_create_with_buffer stores its
+ * elements in the caller's buffer until they no longer fit.
+ */
 typedef struct vector
 {
 	void *elements;
 	size_t element_size;
 	size_t size;
 	size_t capacity;
+	size_t front;
+	void *small_buffer;
+	allocator allocator;
 }
 vector;
 
 
 void vector_create(vector *v, size_t element_size);
+void vector_create_with_allocator(vector *v, size_t element_size, const allocator *a);
+void vector_create_with_buffer(vector *v, size_t element_size, void *buffer, size_t capacity);
 void vector_destroy(vector *v);
 int vector_empty(const vector *v);
 size_t vector_size(const vector *v);
+/* elements that fit from the current front on, excluding free slots in front */
 size_t vector_capacity(const vector *v);
 int vector_push_back(vector *v, const void *element);
 int vector_push_front(vector *v, const void *element);
@@ -27,12 +41,14 @@ void vector_pop_front(vector *v);
 void *vector_get(vector *v, size_t index);
 int vector_resize(vector *v, size_t size, const void *fill);
 int vector_reserve(vector *v, size_t capacity);
+int vector_reserve_front(vector *v, size_t count);
 void vector_clear(vector *v);
 void vector_fill(vector *v, const void *fill);
 void vector_erase(vector *v, size_t position);
 void vector_erase_n(vector *v, size_t begin, size_t end);
 int vector_insert(vector *v, size_t position, const void *element);
 int vector_insert_n(vector *v, size_t position, const void *elements, size_t count);
+int vector_append_n(vector *v, const void *elements, size_t count);
 void *vector_data(const vector *v);
 void *vector_front(const vector *v);
 void *vector_back(const vector *v);
@@ -0,0 +1,41 @@
+#include "allocation_counter.h"
+#include <cstdlib>
+#include <new>
+
+
+namespace
+{
+	size_t allocations = 0;
+}
+
+// replaces the global allocation functions of the whole benchmark program
+void *operator new(size_t size)
+{
+	++allocations;
+	if (void *memory = std::malloc(size ? size : 1))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	++allocations;
+	return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+extern "C" size_t allocation_count()
+{
+	return allocations;
+}
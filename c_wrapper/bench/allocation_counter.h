@@ -0,0 +1,21 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* number of calls to the global operator new so far */
+size_t allocation_count();
+
+
+#ifdef __cplusplus
+};
+#endif
+
+
+#endif
@@ -0,0 +1,143 @@
+#include "../map.h"
+#include "ordered_map.h"
+#include "allocation_counter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+/*
+ * Looks up configuration-style keys, too long for the small string
+ * optimization, in map_t and in the std::map engine it used to have,
+ * counting the heap allocations made per lookup along the way, and
+ * finally through interned handles.
+ */
+
+enum
+{
+	key_length = 40
+};
+
+static double seconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+static void print_row(const char *name, double elapsed, size_t allocations, size_t lookups)
+{
+	printf("%-28s %12.1f %16.2f\n", name, elapsed / (double)lookups * 1e9, (double)allocations / (double)lookups);
+}
+
+int main(int argc, char **argv)
+{
+	size_t key_count = 100000;
+	size_t lookups = 5000000;
+	char *storage;
+	const char **keys;
+	map_handle_t *handles;
+	map_t *map;
+	ordered_map_t *ordered;
+	size_t i, found = 0, allocations;
+	double start;
+
+	if (argc >= 2)
+	{
+		key_count = (size_t)atol(argv[1]);
+	}
+
+	storage = malloc(key_count * key_length);
+	keys = malloc(key_count * sizeof(*keys));
+	handles = malloc(key_count * sizeof(*handles));
+	if (!storage || !keys || !handles)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < key_count; ++i)
+	{
+		char *key = storage + (i * key_length);
+		sprintf(key, "service.section%u.setting%u", (unsigned)(i % 97), (unsigned)i);
+		keys[i] = key;
+	}
+
+	map = map_create();
+	ordered = ordered_map_create();
+	if (!map || !ordered)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	printf("%u keys of about %u bytes, %u lookups\n", (unsigned)key_count, (unsigned)key_length, (unsigned)lookups);
+	printf("%-28s %12s %16s\n", "", "ns/operation", "allocations/op");
+
+	allocations = allocation_count();
+	start = seconds();
+	for (i = 0; i < key_count; ++i)
+	{
+		ordered_map_insert(ordered, keys[i], keys[i]);
+	}
+	print_row("std::map insert", seconds() - start, allocation_count() - allocations, key_count);
+
+	allocations = allocation_count();
+	start = seconds();
+	for (i = 0; i < key_count; ++i)
+	{
+		map_insert(map, keys[i], keys[i]);
+	}
+	print_row("map_insert", seconds() - start, allocation_count() - allocations, key_count);
+
+	map_destroy(map);
+	map = map_create();
+	allocations = allocation_count();
+	start = seconds();
+	if (!map || !map_insert_n(map, keys, keys, key_count))
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	print_row("map_insert_n", seconds() - start, allocation_count() - allocations, key_count);
+
+	allocations = allocation_count();
+	start = seconds();
+	for (i = 0; i < lookups; ++i)
+	{
+		found += (ordered_map_find(ordered, keys[(i * 7919) % key_count]) != 0);
+	}
+	print_row("std::map find", seconds() - start, allocation_count() - allocations, lookups);
+
+	allocations = allocation_count();
+	start = seconds();
+	for (i = 0; i < lookups; ++i)
+	{
+		found += (map_find(map, keys[(i * 7919) % key_count]) != 0);
+	}
+	print_row("map_find", seconds() - start, allocation_count() - allocations, lookups);
+
+	for (i = 0; i < key_count; ++i)
+	{
+		handles[i] = map_intern(map, keys[i]);
+	}
+	allocations = allocation_count();
+	start = seconds();
+	for (i = 0; i < lookups; ++i)
+	{
+		found += (map_find_handle(map, handles[(i * 7919) % key_count]) != 0);
+	}
+	print_row("map_find_handle", seconds() - start, allocation_count() - allocations, lookups);
+
+	if (found != 3 * lookups)
+	{
+		fprintf(stderr, "Lost keys\n");
+		return 1;
+	}
+
+	ordered_map_destroy(ordered);
+	map_destroy(map);
+	free(handles);
+	free(keys);
+	free(storage);
+	return 0;
+}
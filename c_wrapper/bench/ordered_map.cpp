@@ -0,0 +1,35 @@
+#include "ordered_map.h"
+#include <map>
+#include <string>
+
+
+extern "C"
+{
+	struct ordered_map_t
+	{
+		std::map<std::string, std::string> instance;
+	};
+
+
+	ordered_map_t *ordered_map_create()
+	{
+		return new ordered_map_t;
+	}
+
+	int ordered_map_insert(ordered_map_t *map, const char *key, const char *value)
+	{
+		map->instance[key] = value;
+		return 1;
+	}
+
+	const char *ordered_map_find(ordered_map_t *map, const char *key)
+	{
+		const auto i = map->instance.find(key);
+		return (i == map->instance.end()) ? 0 : i->second.c_str();
+	}
+
+	void ordered_map_destroy(ordered_map_t *map)
+	{
+		delete map;
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef ORDERED_MAP_H
+#define ORDERED_MAP_H
+
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the std::map based engine map_t used to have, kept as a benchmark baseline */
+struct ordered_map_t;
+typedef struct ordered_map_t ordered_map_t;
+
+
+ordered_map_t *ordered_map_create();
+int ordered_map_insert(ordered_map_t *map, const char *key, const char *value);
+const char *ordered_map_find(ordered_map_t *map, const char *key);
+void ordered_map_destroy(ordered_map_t *map);
+
+
+#ifdef __cplusplus
+};
+#endif
+
+
+#endif
@@ -4,10 +4,26 @@
 
 int main(void)
 {
+	static const char *const keys[] = {"def", "ghi", "abc"};
+	static const char *const values[] = {"456", "789", "321"};
 	map_t *m = map_create();
+	map_handle_t handle;
 	map_insert(m, "abc", "123");
 	printf("%u\n", (unsigned)map_size(m));
 	printf("%s\n", map_find(m, "abc"));
+	map_insert_n(m, keys, values, 3);
+	printf("%u\n", (unsigned)map_size(m));
+	printf("%s %s\n", map_find(m, "abc"), map_find(m, "ghi"));
+	map_erase(m, "def");
+	printf("%u %s\n", (unsigned)map_size(m), map_find(m, "def") ? "found" : "erased");
+	handle = map_intern(m, "jkl");
+	printf("%s %u\n", map_find_handle(m, handle) ? "found" : "absent", (unsigned)map_size(m));
+	map_insert_handle(m, handle, "000");
+	map_insert(m, "mno", "111");
+	printf("%s %s\n", map_find_handle(m, handle), map_find(m, "jkl"));
+	printf("%s\n", map_find_handle(m, map_intern(m, "abc")));
+	map_erase_handle(m, handle);
+	printf("%u %s\n", (unsigned)map_size(m), map_find(m, "jkl") ? "found" : "erased");
 	map_destroy(m);
 	return 0;
 }
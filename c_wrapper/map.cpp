@@ -1,45 +1,253 @@
 #include "map.h"
-#include <map>
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <new>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 
+namespace
+{
+	// hashes std::string, std::string_view and const char * alike, so that
+	// lookups with a C string do not have to build a std::string first
+	struct string_hash
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::string_view key) const noexcept
+		{
+			return std::hash<std::string_view>()(key);
+		}
+	};
+
+	// A key once interned keeps its slot, present or not, so that handles
+	// stay valid. Slots of keys that were only inserted are released on
+	// erasure and reused through the free list.
+	struct slot
+	{
+		std::string value;
+		bool present = false;
+		bool pinned = false;
+		map_handle_t next_free = MAP_INVALID_HANDLE;
+	};
+
+	typedef std::unordered_map<std::string, map_handle_t, string_hash, std::equal_to<>> handle_table;
+}
+
 extern "C"
 {
+	// values live in a deque so that neither handles nor the pointers
+	// returned by map_find move when slots are added
 	struct map_t
 	{
-		std::map<std::string, std::string> instance;
+		handle_table handles;
+		std::deque<slot> slots;
+		map_handle_t first_free = MAP_INVALID_HANDLE;
+		size_t size = 0;
 	};
+}
+
+namespace
+{
+	void release(map_t &map, map_handle_t handle)
+	{
+		slot &s = map.slots[handle];
+		s.next_free = map.first_free;
+		map.first_free = handle;
+	}
+
+	map_handle_t allocate(map_t &map)
+	{
+		if (map.first_free == MAP_INVALID_HANDLE)
+		{
+			map.slots.emplace_back();
+			return map.slots.size() - 1;
+		}
+		const map_handle_t handle = map.first_free;
+		map.first_free = map.slots[handle].next_free;
+		map.slots[handle].next_free = MAP_INVALID_HANDLE;
+		return handle;
+	}
+
+	// pin is set by map_intern, whose handles must survive erasure
+	map_handle_t intern(map_t &map, const char *key, bool pin)
+	{
+		const std::string_view key_view(key);
+		const auto i = map.handles.find(key_view);
+		if (i != map.handles.end())
+		{
+			map.slots[i->second].pinned |= pin;
+			return i->second;
+		}
+		const map_handle_t handle = allocate(map);
+		try
+		{
+			map.handles.emplace(key_view, handle);
+		}
+		catch (...)
+		{
+			release(map, handle);
+			throw;
+		}
+		map.slots[handle].pinned = pin;
+		return handle;
+	}
+
+	map_handle_t lookup(const map_t &map, const char *key)
+	{
+		const auto i = map.handles.find(std::string_view(key));
+		return (i == map.handles.end()) ? MAP_INVALID_HANDLE : i->second;
+	}
+
+	void assign(map_t &map, map_handle_t handle, const char *value)
+	{
+		assert(handle < map.slots.size());
+		slot &s = map.slots[handle];
+		// reuses the capacity of the old value
+		s.value.assign(value);
+		if (!s.present)
+		{
+			s.present = true;
+			++map.size;
+		}
+	}
 
+	void erase(map_t &map, map_handle_t handle)
+	{
+		assert(handle < map.slots.size());
+		slot &s = map.slots[handle];
+		if (s.present)
+		{
+			s.present = false;
+			s.value.clear();
+			--map.size;
+		}
+	}
 
+	const char *find(const map_t &map, map_handle_t handle)
+	{
+		assert(handle < map.slots.size());
+		const slot &s = map.slots[handle];
+		return s.present ? s.value.c_str() : 0;
+	}
+}
+
+extern "C"
+{
 	map_t *map_create()
 	{
-		return new map_t;
+		return new (std::nothrow) map_t;
 	}
 
 	int map_insert(map_t *map, const char *key, const char *value)
 	{
-		map->instance[key] = value;
-		return 1;
+		try
+		{
+			assign(*map, intern(*map, key, false), value);
+			return 1;
+		}
+		catch (const std::bad_alloc &)
+		{
+			return 0;
+		}
+	}
+
+	int map_insert_n(map_t *map, const char *const *keys, const char *const *values, size_t count)
+	{
+		try
+		{
+			// rehash at most once for the whole batch
+			map->handles.reserve(map->handles.size() + count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				assign(*map, intern(*map, keys[i], false), values[i]);
+			}
+			return 1;
+		}
+		catch (const std::bad_alloc &)
+		{
+			return 0;
+		}
 	}
 
 	void map_erase(map_t *map, const char *key)
 	{
-		map->instance.erase(std::string(key));
+		const auto i = map->handles.find(std::string_view(key));
+		if (i == map->handles.end())
+		{
+			return;
+		}
+		const map_handle_t handle = i->second;
+		erase(*map, handle);
+		if (!map->slots[handle].pinned)
+		{
+			map->handles.erase(i);
+			release(*map, handle);
+		}
 	}
 
 	size_t map_size(map_t *map)
 	{
-		return map->instance.size();
+		return map->size;
 	}
 
 	const char *map_find(map_t *map, const char *key)
 	{
-		const auto i = map->instance.find(key);
-		return (i == map->instance.end()) ? 0 : i->second.c_str();
+		const map_handle_t handle = lookup(*map, key);
+		return (handle == MAP_INVALID_HANDLE) ? 0 : find(*map, handle);
 	}
 
 	void map_destroy(map_t *map)
 	{
 		delete map;
 	}
+
+	map_handle_t map_intern(map_t *map, const char *key)
+	{
+		try
+		{
+			return intern(*map, key, true);
+		}
+		catch (const std::bad_alloc &)
+		{
+			return MAP_INVALID_HANDLE;
+		}
+	}
+
+	int map_insert_handle(map_t *map, map_handle_t handle, const char *value)
+	{
+		if (handle == MAP_INVALID_HANDLE)
+		{
+			return 0;
+		}
+		try
+		{
+			assign(*map, handle, value);
+			return 1;
+		}
+		catch (const std::bad_alloc &)
+		{
+			return 0;
+		}
+	}
+
+	void map_erase_handle(map_t *map, map_handle_t handle)
+	{
+		if (handle == MAP_INVALID_HANDLE)
+		{
+			return;
+		}
+		erase(*map, handle);
+	}
+
+	const char *map_find_handle(map_t *map, map_handle_t handle)
+	{
+		if (handle == MAP_INVALID_HANDLE)
+		{
+			return 0;
+		}
+		return find(*map, handle);
+	}
 }
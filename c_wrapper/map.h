@@ -12,14 +12,40 @@ extern "C" {
 struct map_t;
 typedef struct map_t map_t;
 
+/* index of an interned key, valid for the lifetime of its map */
+typedef size_t map_handle_t;
 
+#define MAP_INVALID_HANDLE ((map_handle_t)-1)
+
+
+/*
+ * Unordered map from C string to C string. Both are copied on insertion.
+ * Lookups and erasures hash the given C string directly and allocate
+ * nothing. The functions that allocate return 0 when out of memory.
+ */
 map_t *map_create();
 int map_insert(map_t *map, const char *key, const char *value);
+/* inserts keys[i] -> values[i] for every i, making room for all of them up front */
+int map_insert_n(map_t *map, const char *const *keys, const char *const *values, size_t count);
 void map_erase(map_t *map, const char *key);
 size_t map_size(map_t *map);
 const char *map_find(map_t *map, const char *key);
 void map_destroy(map_t *map);
 
+/*
+ * Interning assigns a key a handle once, through which its value can then
+ * be inserted, found and erased by indexing an array, without hashing or
+ * comparing the key again. Interning does not insert a value. Handles of
+ * a map stay valid across insertions and erasures; erasing an interned key
+ * only marks its value absent, so its memory is kept until map_destroy.
+ * map_intern returns MAP_INVALID_HANDLE when out of memory, which the
+ * handle functions treat as a key without a value.
+ */
+map_handle_t map_intern(map_t *map, const char *key);
+int map_insert_handle(map_t *map, map_handle_t handle, const char *value);
+void map_erase_handle(map_t *map, map_handle_t handle);
+const char *map_find_handle(map_t *map, map_handle_t handle);
+
 
 #ifdef __cplusplus
 };
@@ -1,38 +1,580 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 static void print_help(FILE *out)
 {
 	fprintf(out,
 		"Syntax:\n"
-		"  finddiff first second [more files...]\n"
+		"  finddiff [options] first second [more files...]\n"
+		"\n"
+		"Prints the offset of the first byte that differs.\n"
+		"\n"
+		"Options:\n"
+		"  --jobs N  compare N ranges of the files concurrently\n"
+		"  --all     print every differing region as: start length\n"
+		"\n"
+		"--jobs and --all need regular files.\n"
 		);
 }
 
-typedef long file_position;
+typedef unsigned long long file_position;
 
-static file_position find_diff(FILE **files, size_t file_count)
+enum
 {
-	file_position diff;
-	for (diff = 0;; ++diff)
+	block_size = 1 << 20,
+	range_size = 16 * block_size,
+	max_jobs = 256,
+	/* --all: regions a worker holds back while earlier ranges are still running */
+	max_buffered_regions = 4096
+};
+
+/* offset of the first byte at which the two blocks differ, or length */
+static size_t compare_block(unsigned char const *left, unsigned char const *right, size_t length)
+{
+	size_t i = 0;
+
+	/* memcpy compiles to plain loads and keeps the word access portable */
+	for (; (i + sizeof(size_t[4])) <= length; i += sizeof(size_t[4]))
 	{
-		size_t f;
+		size_t l[4];
+		size_t r[4];
+		memcpy(l, left + i, sizeof(l));
+		memcpy(r, right + i, sizeof(r));
+		if ((l[0] ^ r[0]) | (l[1] ^ r[1]) | (l[2] ^ r[2]) | (l[3] ^ r[3]))
+		{
+			break;
+		}
+	}
+	for (; i < length; ++i)
+	{
+		if (left[i] != right[i])
+		{
+			break;
+		}
+	}
+	return i;
+}
+
+/*
+ * Returns the offset of the first byte that is not equal in all files,
+ * which is the length of the shortest file if one is a prefix of all
+ * others. Reads all files a large block at a time and compares whole
+ * machine words until the blocks disagree. Returns 0 and sets *error if
+ * reading failed or memory ran out.
+ */
+static file_position find_diff(FILE **files, size_t file_count, int *error)
+{
+	file_position diff = 0;
+	unsigned char **blocks;
+	size_t f;
+
+	*error = 0;
+	blocks = calloc(file_count, sizeof(*blocks));
+	if (!blocks)
+	{
+		*error = 1;
+		return 0;
+	}
+	for (f = 0; f < file_count; ++f)
+	{
+		blocks[f] = malloc(block_size);
+		if (!blocks[f])
+		{
+			*error = 1;
+			goto cleanup;
+		}
+		/* the blocks are large enough, stdio buffering would only copy */
+		setvbuf(files[f], 0, _IONBF, 0);
+	}
+
+	for (;;)
+	{
+		size_t equal = block_size;
+
+		for (f = 0; f < file_count; ++f)
+		{
+			size_t const length = fread(blocks[f], 1, equal, files[f]);
+			if ((length < equal) &&
+				ferror(files[f]))
+			{
+				*error = 1;
+				goto cleanup;
+			}
+			if (f > 0)
+			{
+				/* only the common prefix of all earlier blocks matters */
+				equal = compare_block(blocks[0], blocks[f], (length < equal) ? length : equal);
+			}
+			else
+			{
+				equal = length;
+			}
+		}
+
+		diff += equal;
+		if (equal < block_size)
+		{
+			break;
+		}
+	}
+
+cleanup:
+	for (f = 0; f < file_count; ++f)
+	{
+		free(blocks[f]);
+	}
+	free(blocks);
+	return diff;
+}
+
+typedef struct region
+{
+	file_position start;
+	file_position length;
+}
+region;
+
+/*
+ * State shared by the workers of --jobs and --all. The files are split
+ * into ranges of range_size bytes, which the workers take in increasing
+ * order. Everything below the mutex is guarded by it.
+ */
+typedef struct range_comparison
+{
+	int const *descriptors;
+	size_t file_count;
+	/* length of the shortest file, only this prefix is compared */
+	file_position length;
+	int list_all;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t emitted_changed;
+	/* start of the first range no worker has taken yet */
+	file_position next_range;
+	/* smallest differing offset found so far, length if none */
+	file_position first_diff;
+	/* --all: the regions of all ranges before this have been emitted */
+	file_position emitted;
+	/* --all: the last emitted region, printed once it can no longer grow */
+	region pending;
+	int error;
+}
+range_comparison;
+
+typedef struct region_list
+{
+	region *regions;
+	size_t size;
+	size_t capacity;
+}
+region_list;
+
+static int read_block(int descriptor, unsigned char *block, size_t length, file_position offset)
+{
+	while (length > 0)
+	{
+		ssize_t const got = pread(descriptor, block, length, (off_t)offset);
+		if (got <= 0)
+		{
+			/* the files are at least this long, so EOF is an error too */
+			return 0;
+		}
+		block += got;
+		length -= (size_t)got;
+		offset += (file_position)got;
+	}
+	return 1;
+}
 
-		int const value = fgetc(files[0]);
-		if (value == EOF)
+static int read_blocks(range_comparison *c, unsigned char **blocks, size_t length, file_position offset)
+{
+	size_t f;
+	for (f = 0; f < c->file_count; ++f)
+	{
+		if (!read_block(c->descriptors[f], blocks[f], length, offset))
 		{
-			return diff;
+			return 0;
 		}
+	}
+	return 1;
+}
 
+/* offset of the first byte in the blocks that is not equal in all files */
+static size_t find_block_diff(unsigned char **blocks, size_t file_count, size_t begin, size_t length)
+{
+	size_t equal = length - begin;
+	size_t f;
+	for (f = 1; f < file_count; ++f)
+	{
+		equal = compare_block(blocks[0] + begin, blocks[f] + begin, equal);
+	}
+	return begin + equal;
+}
+
+/* offset of the first byte from begin on that is equal in all files */
+static size_t find_block_equal(unsigned char **blocks, size_t file_count, size_t begin, size_t length)
+{
+	for (; begin < length; ++begin)
+	{
+		size_t f;
 		for (f = 1; f < file_count; ++f)
 		{
-			if (value != fgetc(files[f]))
+			if (blocks[0][begin] != blocks[f][begin])
+			{
+				break;
+			}
+		}
+		if (f == file_count)
+		{
+			break;
+		}
+	}
+	return begin;
+}
+
+static int region_list_add(region_list *list, file_position start, file_position length)
+{
+	if (list->size > 0)
+	{
+		region * const last = list->regions + list->size - 1;
+		if ((last->start + last->length) == start)
+		{
+			last->length += length;
+			return 1;
+		}
+	}
+	if (list->size == list->capacity)
+	{
+		size_t const capacity = (list->capacity ? (list->capacity * 2) : 64);
+		region * const regions = realloc(list->regions, sizeof(*regions) * capacity);
+		if (!regions)
+		{
+			return 0;
+		}
+		list->regions = regions;
+		list->capacity = capacity;
+	}
+	list->regions[list->size].start = start;
+	list->regions[list->size].length = length;
+	++(list->size);
+	return 1;
+}
+
+/* returns the offset of the first difference in [begin, end), or end */
+static int compare_range_first(
+	range_comparison *c,
+	unsigned char **blocks,
+	file_position begin,
+	file_position end,
+	file_position *diff)
+{
+	file_position position;
+	for (position = begin; position < end; position += block_size)
+	{
+		size_t const length = (size_t)(((end - position) < block_size) ? (end - position) : block_size);
+		size_t equal;
+		int stop;
+
+		/* a worker on an earlier range already found something smaller */
+		pthread_mutex_lock(&c->mutex);
+		stop = (c->first_diff <= position) || c->error;
+		pthread_mutex_unlock(&c->mutex);
+		if (stop)
+		{
+			break;
+		}
+
+		if (!read_blocks(c, blocks, length, position))
+		{
+			return 0;
+		}
+		equal = find_block_diff(blocks, c->file_count, 0, length);
+		if (equal < length)
+		{
+			*diff = position + equal;
+			return 1;
+		}
+	}
+	*diff = end;
+	return 1;
+}
+
+/* must be called with the mutex held and with regions in increasing order */
+static void emit_region(range_comparison *c, file_position start, file_position length)
+{
+	if ((c->pending.start + c->pending.length) == start)
+	{
+		c->pending.length += length;
+		return;
+	}
+	if (c->pending.length > 0)
+	{
+		fprintf(stdout, "%llu %llu\n", c->pending.start, c->pending.length);
+	}
+	c->pending.start = start;
+	c->pending.length = length;
+}
+
+/*
+ * Prints the regions collected for the range starting at begin if all
+ * earlier ranges are done. With wait it blocks until then, which bounds
+ * the memory a worker ahead of the others can use.
+ */
+static void flush_regions(range_comparison *c, file_position begin, region_list *regions, int wait)
+{
+	size_t i;
+	pthread_mutex_lock(&c->mutex);
+	if (!wait && (c->emitted != begin))
+	{
+		pthread_mutex_unlock(&c->mutex);
+		return;
+	}
+	while (c->emitted != begin)
+	{
+		pthread_cond_wait(&c->emitted_changed, &c->mutex);
+	}
+	for (i = 0; !c->error && (i < regions->size); ++i)
+	{
+		emit_region(c, regions->regions[i].start, regions->regions[i].length);
+	}
+	pthread_mutex_unlock(&c->mutex);
+	regions->size = 0;
+}
+
+static int compare_range_all(
+	range_comparison *c,
+	unsigned char **blocks,
+	file_position begin,
+	file_position end,
+	region_list *regions)
+{
+	file_position position;
+	for (position = begin; position < end; position += block_size)
+	{
+		size_t const length = (size_t)(((end - position) < block_size) ? (end - position) : block_size);
+		size_t i = 0;
+
+		if (!read_blocks(c, blocks, length, position))
+		{
+			return 0;
+		}
+		for (;;)
+		{
+			size_t differing_end;
+			i = find_block_diff(blocks, c->file_count, i, length);
+			if (i == length)
+			{
+				break;
+			}
+			differing_end = find_block_equal(blocks, c->file_count, i, length);
+			if (!region_list_add(regions, position + i, differing_end - i))
+			{
+				return 0;
+			}
+			if (regions->size == max_buffered_regions)
 			{
-				return diff;
+				flush_regions(c, begin, regions, 1);
 			}
+			i = differing_end;
+		}
+
+		/* the first unfinished range prints as it goes */
+		if (regions->size > 0)
+		{
+			flush_regions(c, begin, regions, 0);
+		}
+	}
+	return 1;
+}
+
+static void *compare_ranges(void *argument)
+{
+	range_comparison * const c = argument;
+	region_list regions = {0, 0, 0};
+	unsigned char **blocks;
+	size_t f;
+	int success = 1;
+
+	blocks = calloc(c->file_count, sizeof(*blocks));
+	success = (blocks != 0);
+	for (f = 0; success && (f < c->file_count); ++f)
+	{
+		blocks[f] = malloc(block_size);
+		success = (blocks[f] != 0);
+	}
+
+	for (;;)
+	{
+		file_position begin;
+		file_position end;
+		file_position diff;
+
+		pthread_mutex_lock(&c->mutex);
+		if (!success)
+		{
+			c->error = 1;
+		}
+		begin = c->next_range;
+		if ((begin >= c->length) ||
+			(begin >= c->first_diff) ||
+			c->error)
+		{
+			pthread_mutex_unlock(&c->mutex);
+			break;
+		}
+		c->next_range += range_size;
+		pthread_mutex_unlock(&c->mutex);
+
+		end = (((c->length - begin) < range_size) ? c->length : (begin + range_size));
+		if (c->list_all)
+		{
+			regions.size = 0;
+			success = compare_range_all(c, blocks, begin, end, &regions);
+			if (!success)
+			{
+				regions.size = 0;
+			}
+
+			/* print in file order, later ranges wait for their turn */
+			flush_regions(c, begin, &regions, 1);
+			pthread_mutex_lock(&c->mutex);
+			c->emitted = end;
+			pthread_cond_broadcast(&c->emitted_changed);
+			pthread_mutex_unlock(&c->mutex);
+		}
+		else
+		{
+			success = compare_range_first(c, blocks, begin, end, &diff);
+			if (success && (diff < end))
+			{
+				pthread_mutex_lock(&c->mutex);
+				if (diff < c->first_diff)
+				{
+					c->first_diff = diff;
+				}
+				pthread_mutex_unlock(&c->mutex);
+			}
+		}
+
+		if (!success)
+		{
+			pthread_mutex_lock(&c->mutex);
+			c->error = 1;
+			pthread_mutex_unlock(&c->mutex);
+		}
+	}
+
+	if (blocks)
+	{
+		for (f = 0; f < c->file_count; ++f)
+		{
+			free(blocks[f]);
 		}
 	}
+	free(blocks);
+	free(regions.regions);
+	return 0;
+}
+
+/*
+ * Like find_diff, but compares ranges of the files on several threads
+ * using positioned reads. With list_all every differing region is
+ * printed instead, in order: the worker on the first unfinished range
+ * prints as it goes, the others hold back at most max_buffered_regions
+ * until all ranges before theirs are done.
+ * Bytes past the end of the shortest file count as differing. Returns 0
+ * on failure.
+ */
+static int find_diff_ranges(FILE **files, size_t file_count, size_t jobs, int list_all, file_position *diff)
+{
+	range_comparison c;
+	pthread_t threads[max_jobs];
+	int *descriptors;
+	file_position longest = 0;
+	size_t started;
+	size_t f;
+	int success = 1;
+
+	descriptors = malloc(sizeof(*descriptors) * file_count);
+	if (!descriptors)
+	{
+		return 0;
+	}
+	c.descriptors = descriptors;
+	c.file_count = file_count;
+	c.list_all = list_all;
+	for (f = 0; f < file_count; ++f)
+	{
+		struct stat info;
+		descriptors[f] = fileno(files[f]);
+		if ((fstat(descriptors[f], &info) != 0) ||
+			!S_ISREG(info.st_mode))
+		{
+			free(descriptors);
+			return 0;
+		}
+		if ((f == 0) ||
+			((file_position)info.st_size < c.length))
+		{
+			c.length = (file_position)info.st_size;
+		}
+		if ((file_position)info.st_size > longest)
+		{
+			longest = (file_position)info.st_size;
+		}
+	}
+
+	pthread_mutex_init(&c.mutex, 0);
+	pthread_cond_init(&c.emitted_changed, 0);
+	c.next_range = 0;
+	c.first_diff = c.length;
+	c.emitted = 0;
+	c.pending.start = 0;
+	c.pending.length = 0;
+	c.error = 0;
+
+	for (started = 0; started < (jobs - 1); ++started)
+	{
+		if (pthread_create(threads + started, 0, compare_ranges, &c) != 0)
+		{
+			break;
+		}
+	}
+	compare_ranges(&c);
+	for (f = 0; f < started; ++f)
+	{
+		pthread_join(threads[f], 0);
+	}
+
+	if (c.error)
+	{
+		success = 0;
+	}
+	else if (list_all)
+	{
+		if (longest > c.length)
+		{
+			emit_region(&c, c.length, longest - c.length);
+		}
+		if (c.pending.length > 0)
+		{
+			fprintf(stdout, "%llu %llu\n", c.pending.start, c.pending.length);
+		}
+	}
+	*diff = c.first_diff;
+
+	pthread_cond_destroy(&c.emitted_changed);
+	pthread_mutex_destroy(&c.mutex);
+	free(descriptors);
+	return success;
 }
 
 static void close_files(FILE **files, size_t file_count)
@@ -48,10 +590,40 @@ static void close_files(FILE **files, size_t file_count)
 int main(int argc, char const * const *argv)
 {
 	FILE **files;
-	size_t file_count = (argc - 1);
+	size_t file_count;
+	size_t jobs = 1;
+	int list_all = 0;
+	int first_file = 1;
 	size_t i;
 	file_position diff;
+	int error;
 
+	for (; first_file < argc; ++first_file)
+	{
+		char const * const option = argv[first_file];
+		if (!strcmp(option, "--all"))
+		{
+			list_all = 1;
+		}
+		else if (!strcmp(option, "--jobs") &&
+			((first_file + 1) < argc))
+		{
+			long const value = atol(argv[++first_file]);
+			if ((value < 1) ||
+				(value > max_jobs))
+			{
+				fprintf(stderr, "--jobs must be between 1 and %d\n", max_jobs);
+				return 1;
+			}
+			jobs = (size_t)value;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	file_count = (size_t)(argc - first_file);
 	if (file_count < 2)
 	{
 		print_help(stderr);
@@ -67,7 +639,7 @@ int main(int argc, char const * const *argv)
 
 	for (i = 0; i < file_count; ++i)
 	{
-		char const * const fileName = argv[i + 1];
+		char const * const fileName = argv[first_file + (int)i];
 		files[i] = fopen(fileName, "rb");
 		if (!files[i])
 		{
@@ -78,8 +650,26 @@ int main(int argc, char const * const *argv)
 		}
 	}
 
-	diff = find_diff(files, file_count);
-	fprintf(stdout, "%u\n", (unsigned)diff);
+	if ((jobs > 1) ||
+		list_all)
+	{
+		error = !find_diff_ranges(files, file_count, jobs, list_all, &diff);
+	}
+	else
+	{
+		diff = find_diff(files, file_count, &error);
+	}
+	if (error)
+	{
+		fprintf(stderr, "Could not compare the files\n");
+		close_files(files, file_count);
+		free(files);
+		return 1;
+	}
+	if (!list_all)
+	{
+		fprintf(stdout, "%llu\n", diff);
+	}
 
 	close_files(files, file_count);
 	free(files);
@@ -1,11 +1,20 @@
+#define _GNU_SOURCE
+
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <assert.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
 
 static char xor_size_t(size_t value)
 {
@@ -42,17 +51,70 @@ static char xor_range(size_t const *begin, size_t size)
 	return result;
 }
 
+enum
+{
+	/* alignment O_DIRECT asks for on common file systems */
+	direct_alignment = 4096,
+	io_uring_depth = 8,
+	max_threads = 64
+};
+
+typedef struct test_options
+{
+	size_t buffer_size;
+	size_t threads;
+}
+test_options;
+
+/*
+ * The XOR of all bytes does not depend on the order in which the blocks
+ * are combined, so every strategy has to arrive at the same sum.
+ */
 typedef struct test_result
 {
 	int success;
+	int skipped;
 	char sum;
+	unsigned long long bytes;
 }
 test_result;
 
-static test_result test_fread(char const *file_name)
+static void *allocate_buffer(size_t size)
+{
+	void *buffer;
+	if (posix_memalign(&buffer, direct_alignment, size) != 0)
+	{
+		return 0;
+	}
+	return buffer;
+}
+
+static int open_file(char const *file_name, int flags, unsigned long long *size)
+{
+	struct stat file_info;
+	int const file = open(file_name, O_RDONLY | flags);
+
+	if (file < 0)
+	{
+		return file;
+	}
+
+	if (fstat(file, &file_info) != 0)
+	{
+		fprintf(stderr, "Could not determine file size\n");
+		close(file);
+		return -1;
+	}
+
+	*size = (unsigned long long)file_info.st_size;
+	return file;
+}
+
+static test_result test_fread(char const *file_name, test_options const *options)
 {
-	test_result result = {0, 0};
+	test_result result = {0, 0, 0, 0};
 	FILE * const file = fopen(file_name, "rb");
+	size_t *buffer;
 
 	if (!file)
 	{
@@ -60,26 +122,36 @@ static test_result test_fread(char const *file_name)
 		return result;
 	}
 
+	buffer = allocate_buffer(options->buffer_size);
+	if (!buffer)
+	{
+		fprintf(stderr, "Out of memory\n");
+		fclose(file);
+		return result;
+	}
+
 	for (;;)
 	{
-		size_t buffer[8192 / sizeof(size_t)];
-		size_t const r = fread((char *)&buffer, 1, sizeof(buffer), file);
+		size_t const r = fread((char *)buffer, 1, options->buffer_size, file);
 		if (r == 0)
 		{
 			break;
 		}
 		result.sum ^= xor_range(buffer, r);
+		result.bytes += r;
 	}
 
+	free(buffer);
 	fclose(file);
 	result.success = 1;
 	return result;
 }
 
-static test_result test_read(char const *file_name)
+static test_result test_read(char const *file_name, test_options const *options)
 {
-	test_result result = {0, 0};
-	int const file = open(file_name, 0);
+	test_result result = {0, 0, 0, 0};
+	int const file = open(file_name, O_RDONLY);
+	size_t *buffer;
 
 	if (file < 0)
 	{
@@ -87,28 +159,266 @@ static test_result test_read(char const *file_name)
 		return result;
 	}
 
+	buffer = allocate_buffer(options->buffer_size);
+	if (!buffer)
+	{
+		fprintf(stderr, "Out of memory\n");
+		close(file);
+		return result;
+	}
+
 	for (;;)
 	{
-		size_t buffer[8192 / sizeof(size_t)];
-		ssize_t const r = read(file, (char *)&buffer, sizeof(buffer));
+		ssize_t const r = read(file, (char *)buffer, options->buffer_size);
 		if (r <= 0)
 		{
 			break;
 		}
 		result.sum ^= xor_range(buffer, (size_t)r);
+		result.bytes += (unsigned long long)r;
 	}
 
+	free(buffer);
 	close(file);
 	result.success = 1;
 	return result;
 }
 
-static test_result test_mmap(char const *file_name)
+/* reads [begin, end) with pread, returns 0 on a read error */
+static int pread_range(int file, size_t *buffer, size_t buffer_size, unsigned long long begin, unsigned long long end, test_result *result)
+{
+	while (begin < end)
+	{
+		size_t const wanted = (((end - begin) < buffer_size) ? (size_t)(end - begin) : buffer_size);
+		ssize_t const r = pread(file, (char *)buffer, wanted, (off_t)begin);
+		if (r < 0)
+		{
+			return 0;
+		}
+		if (r == 0)
+		{
+			break;
+		}
+		result->sum ^= xor_range(buffer, (size_t)r);
+		result->bytes += (unsigned long long)r;
+		begin += (unsigned long long)r;
+	}
+	return 1;
+}
+
+static test_result test_pread(char const *file_name, test_options const *options)
+{
+	test_result result = {0, 0, 0, 0};
+	unsigned long long size;
+	int const file = open_file(file_name, 0, &size);
+	size_t *buffer;
+
+	if (file < 0)
+	{
+		fprintf(stderr, "Could not open file\n");
+		return result;
+	}
+
+	/* lets the kernel read ahead more aggressively */
+	posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	buffer = allocate_buffer(options->buffer_size);
+	if (!buffer)
+	{
+		fprintf(stderr, "Out of memory\n");
+		close(file);
+		return result;
+	}
+
+	result.success = pread_range(file, buffer, options->buffer_size, 0, size, &result);
+	free(buffer);
+	close(file);
+	return result;
+}
+
+static test_result test_direct(char const *file_name, test_options const *options)
+{
+	test_result result = {0, 0, 0, 0};
+	int const file = open(file_name, O_RDONLY | O_DIRECT);
+	size_t const buffer_size = ((options->buffer_size + direct_alignment - 1) / direct_alignment) * direct_alignment;
+	size_t *buffer;
+
+	if (file < 0)
+	{
+		/* tmpfs and some other file systems do not support O_DIRECT */
+		result.skipped = (errno == EINVAL);
+		if (!result.skipped)
+		{
+			fprintf(stderr, "Could not open file\n");
+		}
+		return result;
+	}
+
+	buffer = allocate_buffer(buffer_size);
+	if (!buffer)
+	{
+		fprintf(stderr, "Out of memory\n");
+		close(file);
+		return result;
+	}
+
+	for (;;)
+	{
+		ssize_t const r = read(file, (char *)buffer, buffer_size);
+		if (r < 0)
+		{
+			result.skipped = (errno == EINVAL);
+			break;
+		}
+		if (r == 0)
+		{
+			result.success = 1;
+			break;
+		}
+		result.sum ^= xor_range(buffer, (size_t)r);
+		result.bytes += (unsigned long long)r;
+	}
+
+	free(buffer);
+	close(file);
+	return result;
+}
+
+#ifdef HAVE_LIBURING
+/* a read in flight and the part of the file it still has to deliver */
+typedef struct io_uring_slot
+{
+	char *buffer;
+	unsigned long long offset;
+	size_t length;
+}
+io_uring_slot;
+
+static void prepare_slot(struct io_uring *ring, int file, io_uring_slot *slot)
 {
-	test_result result = {0, 0};
-	int const file = open(file_name, 0);
+	struct io_uring_sqe * const sqe = io_uring_get_sqe(ring);
+	io_uring_prep_read(sqe, file, slot->buffer, (unsigned)slot->length, slot->offset);
+	io_uring_sqe_set_data(sqe, slot);
+}
+
+static test_result test_io_uring(char const *file_name, test_options const *options)
+{
+	test_result result = {0, 0, 0, 0};
+	unsigned long long size;
+	int const file = open_file(file_name, 0, &size);
+	struct io_uring ring;
+	io_uring_slot slots[io_uring_depth];
+	char *buffers;
+	unsigned long long next = 0;
+	size_t in_flight = 0;
+	size_t i;
+
+	if (file < 0)
+	{
+		fprintf(stderr, "Could not open file\n");
+		return result;
+	}
+
+	if (io_uring_queue_init(io_uring_depth, &ring, 0) < 0)
+	{
+		close(file);
+		result.skipped = 1;
+		return result;
+	}
+
+	buffers = allocate_buffer(options->buffer_size * io_uring_depth);
+	if (!buffers)
+	{
+		fprintf(stderr, "Out of memory\n");
+		io_uring_queue_exit(&ring);
+		close(file);
+		return result;
+	}
+
+	/* keeps up to io_uring_depth reads in flight, each in its own buffer */
+	result.success = 1;
+	for (i = 0; (i < io_uring_depth) && (next < size); ++i)
+	{
+		slots[i].buffer = buffers + (i * options->buffer_size);
+		slots[i].offset = next;
+		slots[i].length = (((size - next) < options->buffer_size) ? (size_t)(size - next) : options->buffer_size);
+		next += slots[i].length;
+		prepare_slot(&ring, file, slots + i);
+		++in_flight;
+	}
+	io_uring_submit(&ring);
+
+	while (in_flight > 0)
+	{
+		struct io_uring_cqe *cqe;
+		io_uring_slot *slot;
+		int got;
+		if (io_uring_wait_cqe(&ring, &cqe) < 0)
+		{
+			result.success = 0;
+			break;
+		}
+		slot = io_uring_cqe_get_data(cqe);
+		got = cqe->res;
+		io_uring_cqe_seen(&ring, cqe);
+		--in_flight;
+
+		if (got < 0)
+		{
+			result.success = 0;
+		}
+		else if (got == 0)
+		{
+			/* the file got shorter, like pread_range this stops at its end */
+			slot->length = 0;
+			next = size;
+		}
+		else
+		{
+			result.sum ^= xor_range((size_t const *)slot->buffer, (size_t)got);
+			result.bytes += (unsigned long long)got;
+			/* a short read asks again for the rest of its block, otherwise the slot takes the next block */
+			slot->offset += (unsigned long long)got;
+			slot->length -= (size_t)got;
+			if ((slot->length == 0) &&
+				(next < size))
+			{
+				slot->offset = next;
+				slot->length = (((size - next) < options->buffer_size) ? (size_t)(size - next) : options->buffer_size);
+				next += slot->length;
+			}
+		}
+
+		if (result.success &&
+			(slot->length > 0))
+		{
+			prepare_slot(&ring, file, slot);
+			io_uring_submit(&ring);
+			++in_flight;
+		}
+	}
+
+	free(buffers);
+	io_uring_queue_exit(&ring);
+	close(file);
+	return result;
+}
+#else
+static test_result test_io_uring(char const *file_name, test_options const *options)
+{
+	test_result result = {0, 1, 0, 0};
+	(void)file_name;
+	(void)options;
+	return result;
+}
+#endif
+
+static test_result map_and_xor(char const *file_name, int flags, int advice)
+{
+	test_result result = {0, 0, 0, 0};
+	unsigned long long size;
+	int const file = open_file(file_name, 0, &size);
 	void *content;
-	struct stat file_info;
 
 	if (file < 0)
 	{
@@ -116,79 +426,362 @@ static test_result test_mmap(char const *file_name)
 		return result;
 	}
 
-	if (fstat(file, &file_info) != 0)
+	if (size > (size_t)-1)
 	{
-		fprintf(stderr, "Could not determine file size\n");
+		fprintf(stderr, "The file is too large for the address space\n");
 		close(file);
 		return result;
 	}
 
-	if (file_info.st_size > 0x7fffffff)
+	if (size == 0)
 	{
-		fprintf(stderr, "The file is too large\n");
 		close(file);
+		result.success = 1;
 		return result;
 	}
 
-	content = mmap(0, (size_t)file_info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
-	if (!content)
+	content = mmap(0, (size_t)size, PROT_READ, MAP_PRIVATE | flags, file, 0);
+	if (content == MAP_FAILED)
 	{
 		fprintf(stderr, "Could not map file into memory\n");
 		close(file);
 		return result;
 	}
 
-	if (madvise(content, (size_t)file_info.st_size, MADV_SEQUENTIAL) != 0)
+	if (madvise(content, (size_t)size, advice) != 0)
 	{
 		fprintf(stderr, "Could not set mmap advise\n");
 	}
 
-	result.sum = xor_range(content, (size_t)file_info.st_size);
+	result.sum = xor_range(content, (size_t)size);
+	result.bytes = size;
 
-	munmap(content, (size_t)file_info.st_size);
+	munmap(content, (size_t)size);
 	close(file);
 	result.success = 1;
 	return result;
 }
 
+static test_result test_mmap(char const *file_name, test_options const *options)
+{
+	(void)options;
+	return map_and_xor(file_name, 0, MADV_SEQUENTIAL);
+}
+
+static test_result test_mmap_populate(char const *file_name, test_options const *options)
+{
+#ifdef MAP_POPULATE
+	(void)options;
+	return map_and_xor(file_name, MAP_POPULATE, MADV_SEQUENTIAL);
+#else
+	test_result result = {0, 1, 0, 0};
+	(void)file_name;
+	(void)options;
+	return result;
+#endif
+}
+
+/*
+ * Asks for transparent huge pages. The kernel only backs file mappings
+ * with them where the file system supports it, elsewhere this behaves
+ * like the plain mapping.
+ */
+static test_result test_mmap_huge(char const *file_name, test_options const *options)
+{
+#ifdef MADV_HUGEPAGE
+	(void)options;
+	return map_and_xor(file_name, 0, MADV_HUGEPAGE);
+#else
+	test_result result = {0, 1, 0, 0};
+	(void)file_name;
+	(void)options;
+	return result;
+#endif
+}
+
+typedef struct chunk_reader
+{
+	char const *file_name;
+	size_t buffer_size;
+	unsigned long long begin;
+	unsigned long long end;
+	test_result result;
+}
+chunk_reader;
+
+static void *read_chunk(void *argument)
+{
+	chunk_reader * const reader = argument;
+	int const file = open(reader->file_name, O_RDONLY);
+	size_t *buffer;
+
+	if (file < 0)
+	{
+		return 0;
+	}
+
+	buffer = allocate_buffer(reader->buffer_size);
+	if (buffer)
+	{
+		posix_fadvise(file, (off_t)reader->begin, (off_t)(reader->end - reader->begin), POSIX_FADV_SEQUENTIAL);
+		reader->result.success = pread_range(file, buffer, reader->buffer_size, reader->begin, reader->end, &reader->result);
+		free(buffer);
+	}
+	close(file);
+	return 0;
+}
+
+/* splits the file into one contiguous chunk per thread */
+static test_result test_threads(char const *file_name, test_options const *options)
+{
+	test_result result = {0, 0, 0, 0};
+	chunk_reader readers[max_threads];
+	pthread_t threads[max_threads];
+	size_t const thread_count = ((options->threads < max_threads) ? options->threads : max_threads);
+	unsigned long long size;
+	unsigned long long chunk;
+	int const file = open_file(file_name, 0, &size);
+	size_t started;
+	size_t i;
+
+	if (file < 0)
+	{
+		fprintf(stderr, "Could not open file\n");
+		return result;
+	}
+	close(file);
+
+	chunk = (size + thread_count - 1) / thread_count;
+	for (i = 0; i < thread_count; ++i)
+	{
+		test_result const empty = {0, 0, 0, 0};
+		readers[i].file_name = file_name;
+		readers[i].buffer_size = options->buffer_size;
+		readers[i].begin = ((i * chunk) < size) ? (i * chunk) : size;
+		readers[i].end = (((i + 1) * chunk) < size) ? ((i + 1) * chunk) : size;
+		readers[i].result = empty;
+	}
+
+	for (started = 0; started < thread_count; ++started)
+	{
+		if (pthread_create(threads + started, 0, read_chunk, readers + started) != 0)
+		{
+			break;
+		}
+	}
+
+	result.success = (started == thread_count);
+	for (i = 0; i < started; ++i)
+	{
+		pthread_join(threads[i], 0);
+		result.success = (result.success && readers[i].result.success);
+		result.sum ^= readers[i].result.sum;
+		result.bytes += readers[i].result.bytes;
+	}
+	return result;
+}
+
 typedef struct test_scenario
 {
 	char const *name;
-	test_result (*run)(char const *);
+	test_result (*run)(char const *, test_options const *);
+	int uses_buffer;
 }
 test_scenario;
 
 static test_scenario const scenarios[] =
 {
-	{"fread", test_fread},
-	{"read", test_read},
-	{"mmap", test_mmap}
+	{"fread", test_fread, 1},
+	{"read", test_read, 1},
+	{"pread", test_pread, 1},
+	{"direct", test_direct, 1},
+	{"io_uring", test_io_uring, 1},
+	{"threads", test_threads, 1},
+	{"mmap", test_mmap, 0},
+	{"mmap_populate", test_mmap_populate, 0},
+	{"mmap_huge", test_mmap_huge, 0}
 };
 
+static size_t const buffer_sizes[] =
+{
+	4096,
+	64 * 1024,
+	1024 * 1024,
+	16 * 1024 * 1024
+};
+
+static double seconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+/*
+ * Evicts the file from the page cache. Works without privileges for
+ * clean pages on most file systems, but not on tmpfs.
+ */
+static void drop_cache(char const *file_name)
+{
+	int const file = open(file_name, O_RDONLY);
+	if (file < 0)
+	{
+		return;
+	}
+	fdatasync(file);
+	posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+	close(file);
+}
+
+/* prints GB/s into text, or why there is no number */
+static int format_rate(char *text, size_t text_size, test_result const *result, double elapsed, test_result const *reference)
+{
+	if (result->skipped)
+	{
+		snprintf(text, text_size, "skipped");
+		return 1;
+	}
+	if (!result->success ||
+		(result->sum != reference->sum) ||
+		(result->bytes != reference->bytes))
+	{
+		snprintf(text, text_size, "FAILED");
+		return 0;
+	}
+	snprintf(text, text_size, "%.2f", ((double)result->bytes / elapsed) / 1e9);
+	return 1;
+}
+
+static int run_suite(char const *file_name, size_t threads)
+{
+	test_options options;
+	test_result reference;
+	int success = 1;
+	size_t i;
+
+	/* plain reads are the reference for the checksum and the size */
+	options.buffer_size = 1024 * 1024;
+	options.threads = threads;
+	reference = test_read(file_name, &options);
+	if (!reference.success)
+	{
+		return 0;
+	}
+
+	printf("%llu bytes, GB/s, %u threads for the threads scenario\n", reference.bytes, (unsigned)threads);
+	printf("%-14s %10s %10s %10s\n", "scenario", "buffer", "cold", "warm");
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i)
+	{
+		size_t const buffer_count = (scenarios[i].uses_buffer ? (sizeof(buffer_sizes) / sizeof(buffer_sizes[0])) : 1);
+		size_t b;
+		for (b = 0; b < buffer_count; ++b)
+		{
+			char buffer_text[32];
+			char cold_text[32];
+			char warm_text[32];
+			test_result cold;
+			test_result warm;
+			double start;
+			double cold_elapsed;
+
+			options.buffer_size = buffer_sizes[b];
+
+			drop_cache(file_name);
+			start = seconds();
+			cold = scenarios[i].run(file_name, &options);
+			cold_elapsed = seconds() - start;
+
+			start = seconds();
+			warm = scenarios[i].run(file_name, &options);
+
+			success &= format_rate(warm_text, sizeof(warm_text), &warm, seconds() - start, &reference);
+			success &= format_rate(cold_text, sizeof(cold_text), &cold, cold_elapsed, &reference);
+			if (scenarios[i].uses_buffer)
+			{
+				snprintf(buffer_text, sizeof(buffer_text), "%u", (unsigned)options.buffer_size);
+			}
+			else
+			{
+				snprintf(buffer_text, sizeof(buffer_text), "-");
+			}
+			printf("%-14s %10s %10s %10s\n", scenarios[i].name, buffer_text, cold_text, warm_text);
+			fflush(stdout);
+		}
+	}
+	return success;
+}
+
+static void print_help(FILE *out)
+{
+	size_t i;
+	fprintf(out,
+		"Syntax:\n"
+		"  mmaptest scenario file [buffer_size [threads]]\n"
+		"  mmaptest suite file [threads]\n"
+		"\n"
+		"Scenarios:\n");
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i)
+	{
+		fprintf(out, "  %s\n", scenarios[i].name);
+	}
+}
+
 int main(int argc, char **argv)
 {
 	char const *scenario, *file_name;
+	test_options options;
 	size_t i;
 
 	if (argc < 3)
 	{
-		fprintf(stderr, "Missing arguments\n");
+		print_help(stderr);
 		return 1;
 	}
 
 	scenario = argv[1];
 	file_name = argv[2];
 
+	if (!strcmp(scenario, "suite"))
+	{
+		long const threads = ((argc >= 4) ? atol(argv[3]) : 4);
+		if ((threads < 1) ||
+			(threads > max_threads))
+		{
+			fprintf(stderr, "The thread count must be between 1 and %d\n", max_threads);
+			return 1;
+		}
+		if (run_suite(file_name, (size_t)threads))
+		{
+			return 0;
+		}
+		fprintf(stderr, "Test failed\n");
+		return 1;
+	}
+
+	options.buffer_size = ((argc >= 4) ? (size_t)atol(argv[3]) : 8192);
+	options.threads = ((argc >= 5) ? (size_t)atol(argv[4]) : 4);
+	if ((options.buffer_size == 0) ||
+		(options.threads == 0))
+	{
+		fprintf(stderr, "Buffer size and thread count must be positive\n");
+		return 1;
+	}
+
 	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i)
 	{
 		if (!strcmp(scenario, scenarios[i].name))
 		{
-			test_result const result = scenarios[i].run(file_name);
+			test_result const result = scenarios[i].run(file_name, &options);
 			if (result.success)
 			{
 				printf("%u\n", (unsigned)(unsigned char)result.sum);
 				return 0;
 			}
+			if (result.skipped)
+			{
+				fprintf(stderr, "Not supported here\n");
+				return 1;
+			}
 
 			fprintf(stderr, "Test failed\n");
 			return 1;
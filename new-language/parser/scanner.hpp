@@ -3,7 +3,10 @@
 
 #include <silicium/source.hpp>
 #include <silicium/sink.hpp>
-#include <unordered_map>
+#include <boost/utility/string_ref.hpp>
+#include <algorithm>
+#include <array>
+#include <cassert>
 
 namespace nl
 {
@@ -76,23 +79,87 @@ namespace nl
 		character_position begin;
 	};
 
+	// One entry per code unit. The low four bits hold the token_type of a
+	// single-character token plus one (zero for none), the others say in
+	// which kind of token the character may occur.
+	enum character_class : unsigned char
+	{
+		single_char_token_mask = 0x0f,
+		decimal_digit_class = 0x10,
+		identifier_head_class = 0x20,
+		identifier_middle_class = 0x40
+	};
+
+	static_assert((static_cast<unsigned>(token_type::newline) + 1) <= single_char_token_mask,
+		"the single-character token types have to fit into single_char_token_mask");
+
+	typedef std::array<unsigned char, 256> character_table;
+
+	inline character_table make_character_table()
+	{
+		character_table table;
+		table.fill(0);
+		for (char c = '0'; c <= '9'; ++c)
+		{
+			table[static_cast<unsigned char>(c)] = decimal_digit_class | identifier_middle_class;
+		}
+		for (char c = 'a'; c <= 'z'; ++c)
+		{
+			table[static_cast<unsigned char>(c)] = identifier_head_class | identifier_middle_class;
+			table[static_cast<unsigned char>(c - 'a' + 'A')] = identifier_head_class | identifier_middle_class;
+		}
+		table['_'] = table['-'] = identifier_head_class | identifier_middle_class;
+
+		std::pair<char, token_type> const single_char_tokens[] =
+		{
+			{'.', token_type::dot},
+			{',', token_type::comma},
+			{'(', token_type::left_parenthesis},
+			{')', token_type::right_parenthesis},
+			{'=', token_type::assignment},
+			{' ', token_type::space},
+			{'\t', token_type::tab},
+			{'\n', token_type::newline}
+		};
+		for (auto const &single : single_char_tokens)
+		{
+			table[static_cast<unsigned char>(single.first)] = static_cast<unsigned char>(static_cast<unsigned char>(single.second) + 1);
+		}
+		return table;
+	}
+
+	// Built once at start-up, so the lookup in classify does not have to
+	// check a function-local static guard for every character.
+	static character_table const character_classes = make_character_table();
+
+	inline unsigned char classify(char c)
+	{
+		return character_classes[static_cast<unsigned char>(c)];
+	}
+
+	inline boost::optional<token_type> find_single_char_token(char c)
+	{
+		unsigned const found = classify(c) & single_char_token_mask;
+		if (found == 0)
+		{
+			return boost::none;
+		}
+		return static_cast<token_type>(found - 1);
+	}
+
 	inline bool is_decimal_digit(char c)
 	{
-		return (c >= '0') && (c <= '9');
+		return (classify(c) & decimal_digit_class) != 0;
 	}
 
 	inline bool is_identifier_head(char c)
 	{
-		return
-			(c >= 'a' && c <= 'z') ||
-			(c >= 'A' && c <= 'Z') ||
-			(c == '_') ||
-			(c == '-');
+		return (classify(c) & identifier_head_class) != 0;
 	}
 
 	inline bool is_identifier_middle(char c)
 	{
-		return is_identifier_head(c) || is_decimal_digit(c);
+		return (classify(c) & identifier_middle_class) != 0;
 	}
 
 	template <class Element>
@@ -124,17 +191,6 @@ namespace nl
 		{
 			return token{token_type::end_of_file, "", character_position{}};
 		}
-		static std::unordered_map<char, nl::token_type> const tokens =
-		{
-			{'.', nl::token_type::dot},
-			{',', nl::token_type::comma},
-			{'(', nl::token_type::left_parenthesis},
-			{')', nl::token_type::right_parenthesis},
-			{'=', nl::token_type::assignment},
-			{' ', nl::token_type::space},
-			{'\t', nl::token_type::tab},
-			{'\n', nl::token_type::newline}
-		};
 		if (first->code_unit == '"')
 		{
 			std::string content;
@@ -174,10 +230,10 @@ namespace nl
 			}
 		}
 		{
-			auto const single_char_found = tokens.find(first->code_unit);
-			if (single_char_found != end(tokens))
+			auto const single_char_found = find_single_char_token(first->code_unit);
+			if (single_char_found)
 			{
-				return token{single_char_found->second, std::string(1, first->code_unit), first->where};
+				return token{*single_char_found, std::string(1, first->code_unit), first->where};
 			}
 		}
 		if (is_identifier_head(first->code_unit))
@@ -224,6 +280,164 @@ namespace nl
 		}
 		return boost::none;
 	}
+
+	// A token of a buffer_scanner. content points into the scanned buffer;
+	// for strings it is the text between the quotes with the escapes still
+	// in it (see unescape_string).
+	struct token_view
+	{
+		token_type type;
+		boost::string_ref content;
+	};
+
+	inline std::string unescape_string(boost::string_ref escaped)
+	{
+		std::string content;
+		content.reserve(escaped.size());
+		for (auto i = escaped.begin(); i != escaped.end(); ++i)
+		{
+			if (*i == '\\')
+			{
+				++i;
+			}
+			content.push_back(*i);
+		}
+		return content;
+	}
+
+	// Scans a contiguous buffer that outlives the tokens, without copying or
+	// allocating. Accepts the same language as scan_token. Line and column
+	// are only computed when asked for with position_of.
+	struct buffer_scanner
+	{
+		buffer_scanner(char const *begin, char const *end)
+			: begin_(begin)
+			, end_(end)
+			, next_(begin)
+			, located_(begin)
+		{
+		}
+
+		explicit buffer_scanner(boost::string_ref source)
+			: begin_(source.data())
+			, end_(source.data() + source.size())
+			, next_(begin_)
+			, located_(begin_)
+		{
+		}
+
+		// none on invalid input, then error_position() tells where
+		boost::optional<token_view> scan()
+		{
+			char const * const first = next_;
+			if (first == end_)
+			{
+				return token_view{token_type::end_of_file, boost::string_ref(first, 0)};
+			}
+			unsigned char const class_ = classify(*first);
+			if (class_ & single_char_token_mask)
+			{
+				++next_;
+				return make_view(static_cast<token_type>((class_ & single_char_token_mask) - 1), first);
+			}
+			if (class_ & identifier_head_class)
+			{
+				next_ = std::find_if(next_ + 1, end_, [](char c) { return !is_identifier_middle(c); });
+				boost::string_ref const content(first, static_cast<std::size_t>(next_ - first));
+				return token_view{(content == "return") ? token_type::return_ : token_type::identifier, content};
+			}
+			if (class_ & decimal_digit_class)
+			{
+				next_ = std::find_if(next_ + 1, end_, [](char c) { return !is_decimal_digit(c); });
+				return make_view(token_type::integer, first);
+			}
+			if (*first == '"')
+			{
+				return scan_string();
+			}
+			return boost::none;
+		}
+
+		// The offending character after a failed scan, otherwise the end of
+		// the last token.
+		char const *error_position() const
+		{
+			return next_;
+		}
+
+		// Counts lines from the last position asked for, so asking for the
+		// positions of all tokens in order costs one pass over the buffer.
+		character_position position_of(char const *where)
+		{
+			assert(where >= begin_ && where <= end_);
+			if (where < located_)
+			{
+				located_ = begin_;
+				location_ = character_position();
+			}
+			for (; located_ != where; ++located_)
+			{
+				if (*located_ == '\n')
+				{
+					++location_.line;
+					location_.column = 0;
+				}
+				else
+				{
+					++location_.column;
+				}
+			}
+			return location_;
+		}
+
+		// converts for consumers of the token stream of scan_token
+		token make_token(token_view const &scanned)
+		{
+			char const * const where = (scanned.type == token_type::string) ? (scanned.content.data() - 1) : scanned.content.data();
+			std::string content = (scanned.type == token_type::string)
+				? unescape_string(scanned.content)
+				: std::string(scanned.content.begin(), scanned.content.end());
+			return token{scanned.type, std::move(content), (scanned.type == token_type::end_of_file) ? character_position() : position_of(where)};
+		}
+
+	private:
+
+		char const *begin_;
+		char const *end_;
+		char const *next_;
+		char const *located_;
+		character_position location_;
+
+		token_view make_view(token_type type, char const *first) const
+		{
+			return token_view{type, boost::string_ref(first, static_cast<std::size_t>(next_ - first))};
+		}
+
+		boost::optional<token_view> scan_string()
+		{
+			char const * const content = next_ + 1;
+			for (char const *i = content; i != end_; ++i)
+			{
+				switch (*i)
+				{
+				case '"':
+					next_ = i + 1;
+					return token_view{token_type::string, boost::string_ref(content, static_cast<std::size_t>(i - content))};
+
+				case '\\':
+					++i;
+					if ((i == end_) || ((*i != '\\') && (*i != '"')))
+					{
+						next_ = i;
+						return boost::none;
+					}
+					break;
+				}
+			}
+			next_ = end_;
+			return boost::none;
+		}
+	};
 }
 
 #endif
@@ -151,6 +151,77 @@ BOOST_AUTO_TEST_CASE(scan_token_string)
 	BOOST_CHECK_EQUAL("", eof->content);
 }
 
+BOOST_AUTO_TEST_CASE(buffer_scanner_sequence)
+{
+	std::string const input = ".,()= \t\n\"string\"identifier 123 return";
+	auto const tokens =
+	{
+		nl::token_type::dot,
+		nl::token_type::comma,
+		nl::token_type::left_parenthesis,
+		nl::token_type::right_parenthesis,
+		nl::token_type::assignment,
+		nl::token_type::space,
+		nl::token_type::tab,
+		nl::token_type::newline,
+		nl::token_type::string,
+		nl::token_type::identifier,
+		nl::token_type::space,
+		nl::token_type::integer,
+		nl::token_type::space,
+		nl::token_type::return_,
+		nl::token_type::end_of_file
+	};
+	nl::buffer_scanner scanner(input);
+	for (nl::token_type const expected : tokens)
+	{
+		boost::optional<nl::token_view> const scanned = scanner.scan();
+		BOOST_REQUIRE(scanned);
+		BOOST_CHECK_EQUAL(static_cast<int>(expected), static_cast<int>(scanned->type));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(buffer_scanner_string)
+{
+	std::string const input = "\"abc123\\\"\\\\\"";
+	nl::buffer_scanner scanner(input);
+	boost::optional<nl::token_view> scanned = scanner.scan();
+	BOOST_REQUIRE(scanned);
+	BOOST_CHECK(nl::token_type::string == scanned->type);
+	BOOST_CHECK(input.data() + 1 == scanned->content.data());
+	BOOST_CHECK_EQUAL("abc123\"\\", nl::unescape_string(scanned->content));
+
+	boost::optional<nl::token_view> eof = scanner.scan();
+	BOOST_REQUIRE(eof);
+	BOOST_CHECK(nl::token_type::end_of_file == eof->type);
+}
+
+BOOST_AUTO_TEST_CASE(buffer_scanner_position)
+{
+	std::string const input = "a\n\tbc \"x\\q\"";
+	nl::buffer_scanner scanner(input);
+	std::vector<nl::character_position> positions;
+	for (;;)
+	{
+		boost::optional<nl::token_view> const scanned = scanner.scan();
+		if (!scanned)
+		{
+			break;
+		}
+		positions.push_back(scanner.make_token(*scanned).begin);
+	}
+	std::vector<nl::character_position> const expected_positions
+	{
+		nl::character_position{0, 0},
+		nl::character_position{0, 1},
+		nl::character_position{1, 0},
+		nl::character_position{1, 1},
+		nl::character_position{1, 3}
+	};
+	BOOST_CHECK(expected_positions == positions);
+	BOOST_CHECK(nl::character_position(1, 7) == scanner.position_of(scanner.error_position()));
+}
+
 template <class TokenizerHandler>
 void with_tokenizer(std::string const &code, TokenizerHandler const &handle)
 {
@@ -0,0 +1,200 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "../concurrent_signal.h"
+#include "../signal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+/*
+ * Latency of one emission of a signal with a few cheap callbacks, taken
+ * by several emitter threads while another thread keeps connecting and
+ * disconnecting. The concurrent_signal is compared with the plain signal
+ * behind a mutex, which is what sharing a signal between threads took
+ * before.
+ */
+
+enum
+{
+	callback_count = 8,
+	max_emitters = 8,
+	calls_per_emitter = 200000
+};
+
+typedef struct locked_signal
+{
+	pthread_mutex_t mutex;
+	signal instance;
+}
+locked_signal;
+
+typedef struct emitter
+{
+	void *shared;
+	int concurrent;
+	double *latencies;
+}
+emitter;
+
+static int volatile churning;
+
+static double seconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+static void count_callback(void *user_data, void *arguments)
+{
+	unsigned long * const counter = user_data;
+	(void)arguments;
+	++(*counter);
+}
+
+static void *emit(void *argument)
+{
+	emitter * const e = argument;
+	unsigned long counter = 0;
+	int i;
+	for (i = 0; i < calls_per_emitter; ++i)
+	{
+		double const start = seconds();
+		if (e->concurrent)
+		{
+			concurrent_signal_call(e->shared, &counter);
+		}
+		else
+		{
+			locked_signal * const l = e->shared;
+			pthread_mutex_lock(&l->mutex);
+			signal_call(&l->instance, &counter);
+			pthread_mutex_unlock(&l->mutex);
+		}
+		e->latencies[i] = seconds() - start;
+	}
+	return 0;
+}
+
+static void *churn_concurrent(void *argument)
+{
+	static unsigned long counter;
+	concurrent_signal * const s = argument;
+	while (churning)
+	{
+		concurrent_signal_disconnect(s, concurrent_signal_connect(s, count_callback, &counter, 1));
+	}
+	return 0;
+}
+
+static void *churn_locked(void *argument)
+{
+	static unsigned long counter;
+	locked_signal * const l = argument;
+	while (churning)
+	{
+		connection *c;
+		pthread_mutex_lock(&l->mutex);
+		c = signal_connect(&l->instance, count_callback, &counter, 1);
+		pthread_mutex_unlock(&l->mutex);
+		pthread_mutex_lock(&l->mutex);
+		signal_disconnect(&l->instance, c);
+		pthread_mutex_unlock(&l->mutex);
+	}
+	return 0;
+}
+
+static int compare_double(void const *left, void const *right)
+{
+	double const l = *(double const *)left;
+	double const r = *(double const *)right;
+	return (l < r) ? -1 : (l > r);
+}
+
+static void run(void *shared, int concurrent, int emitters, int churn, double *latencies)
+{
+	pthread_t threads[max_emitters];
+	pthread_t churner;
+	emitter states[max_emitters];
+	size_t const total = (size_t)emitters * calls_per_emitter;
+	int i;
+
+	churning = 1;
+	if (churn)
+	{
+		pthread_create(&churner, 0, concurrent ? churn_concurrent : churn_locked, shared);
+	}
+	for (i = 0; i < emitters; ++i)
+	{
+		states[i].shared = shared;
+		states[i].concurrent = concurrent;
+		states[i].latencies = latencies + ((size_t)i * calls_per_emitter);
+		pthread_create(threads + i, 0, emit, states + i);
+	}
+	for (i = 0; i < emitters; ++i)
+	{
+		pthread_join(threads[i], 0);
+	}
+	churning = 0;
+	if (churn)
+	{
+		pthread_join(churner, 0);
+	}
+
+	qsort(latencies, total, sizeof(*latencies), compare_double);
+	printf("%-18s %8d %6s %10.0f %10.0f %10.0f\n",
+		concurrent ? "concurrent_signal" : "mutex+signal",
+		emitters,
+		churn ? "yes" : "no",
+		latencies[total / 2] * 1e9,
+		latencies[(total * 99) / 100] * 1e9,
+		latencies[total - 1] * 1e9);
+}
+
+int main(void)
+{
+	static int const emitter_counts[] = {1, 2, 4, 8};
+	static unsigned long counters[callback_count];
+	double * const latencies = malloc(sizeof(double) * max_emitters * calls_per_emitter);
+	concurrent_signal concurrent;
+	locked_signal locked;
+	size_t i, j;
+	int churn;
+
+	if (!latencies ||
+			!concurrent_signal_create(&concurrent))
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	pthread_mutex_init(&locked.mutex, 0);
+	signal_create(&locked.instance);
+	for (i = 0; i < callback_count; ++i)
+	{
+		if (!concurrent_signal_connect(&concurrent, count_callback, counters + i, 1) ||
+				!signal_connect(&locked.instance, count_callback, counters + i, 1))
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+	}
+
+	printf("%d callbacks, nanoseconds per call\n", callback_count);
+	printf("%-18s %8s %6s %10s %10s %10s\n", "", "emitters", "churn", "median", "p99", "max");
+	for (churn = 0; churn < 2; ++churn)
+	{
+		for (j = 0; j < sizeof(emitter_counts) / sizeof(emitter_counts[0]); ++j)
+		{
+			run(&concurrent, 1, emitter_counts[j], churn, latencies);
+			run(&locked, 0, emitter_counts[j], churn, latencies);
+		}
+	}
+
+	signal_destroy(&locked.instance);
+	pthread_mutex_destroy(&locked.mutex);
+	concurrent_signal_destroy(&concurrent);
+	free(latencies);
+	return 0;
+}
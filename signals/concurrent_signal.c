@@ -0,0 +1,287 @@
+#include "concurrent_signal.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef struct concurrent_signal_entry
+{
+	slot callback;
+	void *user_data;
+	concurrent_signal_connection id;
+}
+concurrent_signal_entry;
+
+struct concurrent_signal_snapshot
+{
+	size_t refs;
+	size_t count;
+	unsigned long retired_epoch;
+	concurrent_signal_snapshot *next_retired;
+	concurrent_signal_entry *entries;
+};
+
+
+/* the atomics are GCC builtins because the project is compiled as C89 */
+static size_t atomic_load_size(size_t const *value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static void atomic_add_size(size_t *value, size_t amount)
+{
+	__atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+}
+
+static size_t atomic_sub_size(size_t *value, size_t amount)
+{
+	return __atomic_sub_fetch(value, amount, __ATOMIC_SEQ_CST);
+}
+
+static unsigned long atomic_load_epoch(unsigned long const *value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static concurrent_signal_snapshot *atomic_load_snapshot(concurrent_signal_snapshot * const *value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static void snapshot_free(concurrent_signal_snapshot *snapshot)
+{
+	free(snapshot);
+}
+
+/* an unpublished snapshot with room for count entries and the signal's reference */
+static concurrent_signal_snapshot *snapshot_allocate(size_t count)
+{
+	concurrent_signal_snapshot * const snapshot = malloc(sizeof(*snapshot) + (count * sizeof(concurrent_signal_entry)));
+	if (snapshot)
+	{
+		snapshot->refs = 1;
+		snapshot->count = count;
+		snapshot->retired_epoch = 0;
+		snapshot->next_retired = 0;
+		snapshot->entries = (concurrent_signal_entry *)(snapshot + 1);
+	}
+	return snapshot;
+}
+
+static void snapshot_release(concurrent_signal_snapshot *snapshot)
+{
+	if (atomic_sub_size(&snapshot->refs, 1) == 0)
+	{
+		snapshot_free(snapshot);
+	}
+}
+
+/*
+ * A caller counts itself in active[epoch % 2] while it takes its
+ * reference, and checks that the epoch did not move in the meantime.
+ */
+static concurrent_signal_snapshot *concurrent_signal_acquire(concurrent_signal *s)
+{
+	concurrent_signal_snapshot *snapshot;
+	unsigned long epoch;
+
+	for (;;)
+	{
+		epoch = atomic_load_epoch(&s->epoch);
+		atomic_add_size(s->active + (epoch % 2), 1);
+		if (atomic_load_epoch(&s->epoch) == epoch)
+		{
+			break;
+		}
+		atomic_sub_size(s->active + (epoch % 2), 1);
+	}
+
+	snapshot = atomic_load_snapshot(&s->current);
+	if (snapshot)
+	{
+		atomic_add_size(&snapshot->refs, 1);
+	}
+	atomic_sub_size(s->active + (epoch % 2), 1);
+	return snapshot;
+}
+
+/*
+ * Called with the writer mutex held. The epoch can advance once nobody is
+ * counted under the parity it moves to, which is the one of the epoch
+ * before the current. Snapshots retired two epochs ago then cannot be
+ * picked up anymore, so the signal drops its reference to them.
+ */
+static void concurrent_signal_reclaim(concurrent_signal *s)
+{
+	concurrent_signal_snapshot **link;
+	unsigned long const epoch = s->epoch;
+
+	if (atomic_load_size(s->active + ((epoch + 1) % 2)) == 0)
+	{
+		__atomic_store_n(&s->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+	}
+
+	link = &s->retired;
+	while (*link)
+	{
+		concurrent_signal_snapshot * const snapshot = *link;
+		if ((snapshot->retired_epoch + 2) <= s->epoch)
+		{
+			*link = snapshot->next_retired;
+			snapshot_release(snapshot);
+		}
+		else
+		{
+			link = &snapshot->next_retired;
+		}
+	}
+}
+
+/* called with the writer mutex held */
+static void concurrent_signal_publish(concurrent_signal *s, concurrent_signal_snapshot *snapshot)
+{
+	concurrent_signal_snapshot * const old = s->current;
+	__atomic_store_n(&s->current, snapshot, __ATOMIC_SEQ_CST);
+	if (old)
+	{
+		old->retired_epoch = s->epoch;
+		old->next_retired = s->retired;
+		s->retired = old;
+	}
+	concurrent_signal_reclaim(s);
+}
+
+
+int concurrent_signal_create(concurrent_signal *s)
+{
+	assert(s);
+	s->current = 0;
+	s->epoch = 0;
+	s->active[0] = s->active[1] = 0;
+	s->retired = 0;
+	s->next_id = 1;
+	return pthread_mutex_init(&s->writer, 0) == 0;
+}
+
+void concurrent_signal_destroy(concurrent_signal *s)
+{
+	assert(s);
+
+	/* nobody may call anymore, so every snapshot is down to the signal's reference */
+	while (s->retired)
+	{
+		concurrent_signal_snapshot * const snapshot = s->retired;
+		s->retired = snapshot->next_retired;
+		assert(snapshot->refs == 1);
+		snapshot_free(snapshot);
+	}
+	if (s->current)
+	{
+		assert(s->current->refs == 1);
+		snapshot_free(s->current);
+	}
+	pthread_mutex_destroy(&s->writer);
+}
+
+concurrent_signal_connection concurrent_signal_connect(concurrent_signal *s, slot callback, void *user_data, int at_end)
+{
+	concurrent_signal_snapshot *snapshot;
+	concurrent_signal_entry *entry;
+	concurrent_signal_connection id;
+	size_t count;
+	assert(s);
+	assert(callback);
+
+	pthread_mutex_lock(&s->writer);
+
+	count = s->current ? s->current->count : 0;
+	snapshot = snapshot_allocate(count + 1);
+	if (!snapshot)
+	{
+		pthread_mutex_unlock(&s->writer);
+		return 0;
+	}
+
+	if (count)
+	{
+		memcpy(snapshot->entries + (at_end ? 0 : 1), s->current->entries, count * sizeof(*entry));
+	}
+	entry = snapshot->entries + (at_end ? count : 0);
+	entry->callback = callback;
+	entry->user_data = user_data;
+	entry->id = id = s->next_id++;
+
+	concurrent_signal_publish(s, snapshot);
+	pthread_mutex_unlock(&s->writer);
+	return id;
+}
+
+int concurrent_signal_disconnect(concurrent_signal *s, concurrent_signal_connection c)
+{
+	concurrent_signal_snapshot *snapshot = 0;
+	size_t i, count;
+	assert(s);
+
+	pthread_mutex_lock(&s->writer);
+
+	count = s->current ? s->current->count : 0;
+	for (i = 0; i < count; ++i)
+	{
+		if (s->current->entries[i].id == c)
+		{
+			break;
+		}
+	}
+	if (i == count)
+	{
+		pthread_mutex_unlock(&s->writer);
+		return 0;
+	}
+
+	/* an empty signal keeps no snapshot, so that calling it touches nothing */
+	if (count > 1)
+	{
+		snapshot = snapshot_allocate(count - 1);
+		if (!snapshot)
+		{
+			pthread_mutex_unlock(&s->writer);
+			return 0;
+		}
+		memcpy(snapshot->entries, s->current->entries, i * sizeof(*snapshot->entries));
+		memcpy(snapshot->entries + i, s->current->entries + i + 1, (count - i - 1) * sizeof(*snapshot->entries));
+	}
+
+	concurrent_signal_publish(s, snapshot);
+	pthread_mutex_unlock(&s->writer);
+	return 1;
+}
+
+void concurrent_signal_call(concurrent_signal *s, void *arguments)
+{
+	concurrent_signal_snapshot *snapshot;
+	size_t i;
+	assert(s);
+
+	snapshot = concurrent_signal_acquire(s);
+	if (!snapshot)
+	{
+		return;
+	}
+
+	/* callbacks may connect and disconnect, which only affects later calls */
+	for (i = 0; i < snapshot->count; ++i)
+	{
+		snapshot->entries[i].callback(snapshot->entries[i].user_data, arguments);
+	}
+
+	snapshot_release(snapshot);
+}
+
+size_t concurrent_signal_size(concurrent_signal *s)
+{
+	size_t result;
+	pthread_mutex_lock(&s->writer);
+	result = s->current ? s->current->count : 0;
+	pthread_mutex_unlock(&s->writer);
+	return result;
+}
@@ -0,0 +1,47 @@
+#ifndef SIGNALS_CONCURRENT_SIGNAL_H
+#define SIGNALS_CONCURRENT_SIGNAL_H
+
+
+#include "types.h"
+#include <pthread.h>
+#include <stddef.h>
+
+
+typedef struct concurrent_signal_snapshot concurrent_signal_snapshot;
+
+/* identifies a connection of a concurrent_signal, 0 is never used */
+typedef unsigned long concurrent_signal_connection;
+
+/*
+ * Signal that may be called, connected to and disconnected from by many
+ * threads at once. The callbacks are kept in an immutable snapshot:
+ * signal_call takes a reference to the current one without locking and
+ * sweeps it. Connecting and disconnecting copy the snapshot under a mutex
+ * and publish the copy. A replaced snapshot is retired and freed once two
+ * epoch advances guarantee that no caller can still be about to take a
+ * reference to it and its last reference is gone.
+ *
+ * Consequently a call that started before a disconnect returned may still
+ * run the disconnected callback once, and the user data of a callback
+ * must stay valid until all such calls are over.
+ */
+typedef struct concurrent_signal
+{
+	concurrent_signal_snapshot *current;
+	unsigned long epoch;
+	size_t active[2];
+	pthread_mutex_t writer;
+	concurrent_signal_snapshot *retired;
+	concurrent_signal_connection next_id;
+}
+concurrent_signal;
+
+int concurrent_signal_create(concurrent_signal *s);
+void concurrent_signal_destroy(concurrent_signal *s);
+concurrent_signal_connection concurrent_signal_connect(concurrent_signal *s, slot callback, void *user_data, int at_end);
+int concurrent_signal_disconnect(concurrent_signal *s, concurrent_signal_connection c);
+void concurrent_signal_call(concurrent_signal *s, void *arguments);
+size_t concurrent_signal_size(concurrent_signal *s);
+
+
+#endif
@@ -1,54 +1,16 @@
 #include "connection.h"
+#include "connection_pool.h"
 #include "signal.h"
 #include <assert.h>
-#include <stdlib.h>
 
 
-void connection_remove(connection *c)
-{
-	signal *s;
-	assert(c);
-
-	s = c->parent;
-	if (s)
-	{
-		if (c->previous)
-		{
-			c->previous->next = c->next;
-		}
-		else
-		{
-			s->first = c->next;
-		}
-
-		if (c->next)
-		{
-			c->next->previous = c->previous;
-		}
-		else
-		{
-			s->last = c->previous;
-		}
-	}
-
-	connection_destroy(c);
-	free(c);
-}
-
-void connection_remove_if_disconnected(connection *c)
+void connection_release(connection *c)
 {
 	assert(c);
 	assert(!c->external_refs);
+	assert(!c->is_connected);
 
-	if (!c->is_connected)
-	{
-		connection_remove(c);
-	}
-}
-
-void connection_destroy(connection *c)
-{
-	assert(c);
+	connection_pool_deallocate(c->pool, c);
 }
 
 void connection_grab(connection *c)
@@ -63,9 +25,10 @@ void connection_drop(connection *c)
 	assert(c->external_refs > 0);
 
 	--(c->external_refs);
-	if (c->external_refs == 0)
+	if ((c->external_refs == 0) &&
+			!c->is_connected)
 	{
-		connection_remove_if_disconnected(c);
+		connection_release(c);
 	}
 }
 
@@ -6,19 +6,22 @@
 #include <stddef.h>
 
 
+/*
+ * Handle to one entry of a signal. The callback itself lives in the
+ * signal's entry array; the handle only knows where. Handles come from
+ * the connection_pool of their signal.
+ */
 struct connection
 {
-	slot callback;
-	void *user_data;
-	connection *previous, *next;
-	size_t external_refs;
 	signal *parent;
+	connection_pool *pool;
+	size_t index;
+	size_t external_refs;
 	int is_connected;
+	connection *next_free;
 };
 
-void connection_remove(connection *c);
-void connection_remove_if_disconnected(connection *c);
-void connection_destroy(connection *c);
+void connection_release(connection *c);
 void connection_grab(connection *c);
 void connection_drop(connection *c);
 int connection_is_connected(connection const *c);
@@ -0,0 +1,105 @@
+#include "connection_pool.h"
+#include "connection.h"
+#include <assert.h>
+#include <stdlib.h>
+
+
+enum
+{
+	chunk_size = 64
+};
+
+struct connection_pool_chunk
+{
+	connection_pool_chunk *next;
+	connection handles[chunk_size];
+};
+
+
+static void connection_pool_free(connection_pool *p)
+{
+	connection_pool_chunk *chunk = p->chunks;
+	while (chunk)
+	{
+		connection_pool_chunk * const next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	free(p);
+}
+
+
+connection_pool *connection_pool_create(void)
+{
+	connection_pool * const p = malloc(sizeof(*p));
+	if (p)
+	{
+		p->chunks = 0;
+		p->free = 0;
+		p->live = 0;
+		p->orphaned = 0;
+	}
+	return p;
+}
+
+void connection_pool_orphan(connection_pool *p)
+{
+	assert(p);
+	assert(!p->orphaned);
+
+	if (p->live)
+	{
+		p->orphaned = 1;
+	}
+	else
+	{
+		connection_pool_free(p);
+	}
+}
+
+connection *connection_pool_allocate(connection_pool *p)
+{
+	connection *result;
+	assert(p);
+	assert(!p->orphaned);
+
+	if (!p->free)
+	{
+		size_t i;
+		connection_pool_chunk * const chunk = malloc(sizeof(*chunk));
+		if (!chunk)
+		{
+			return 0;
+		}
+		chunk->next = p->chunks;
+		p->chunks = chunk;
+		for (i = chunk_size; i > 0; --i)
+		{
+			chunk->handles[i - 1].next_free = p->free;
+			p->free = chunk->handles + (i - 1);
+		}
+	}
+
+	result = p->free;
+	p->free = result->next_free;
+	result->pool = p;
+	++(p->live);
+	return result;
+}
+
+void connection_pool_deallocate(connection_pool *p, connection *c)
+{
+	assert(p);
+	assert(c);
+	assert(p->live > 0);
+
+	c->next_free = p->free;
+	p->free = c;
+	--(p->live);
+
+	if (p->orphaned &&
+			!p->live)
+	{
+		connection_pool_free(p);
+	}
+}
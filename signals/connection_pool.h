@@ -0,0 +1,30 @@
+#ifndef SIGNALS_CONNECTION_POOL_H
+#define SIGNALS_CONNECTION_POOL_H
+
+
+#include "types.h"
+#include <stddef.h>
+
+
+typedef struct connection_pool_chunk connection_pool_chunk;
+
+/*
+ * Hands out connection handles from chunks of many handles each, reusing
+ * released ones. A signal that is destroyed while handles are still
+ * grabbed orphans its pool, which then frees itself with the last handle.
+ */
+struct connection_pool
+{
+	connection_pool_chunk *chunks;
+	connection *free;
+	size_t live;
+	int orphaned;
+};
+
+connection_pool *connection_pool_create(void);
+void connection_pool_orphan(connection_pool *p);
+connection *connection_pool_allocate(connection_pool *p);
+void connection_pool_deallocate(connection_pool *p, connection *c);
+
+
+#endif
@@ -1,5 +1,6 @@
 #include "connection.h"
 #include "signal.h"
+#include "concurrent_signal.h"
 #include <stdio.h>
 #include <assert.h>
 
@@ -205,6 +206,289 @@ static void test_connection_drop_after_destroy(void)
 	connection_drop(c);
 }
 
+typedef struct order_recorder
+{
+	int values[16];
+	size_t count;
+}
+order_recorder;
+
+typedef struct order_entry
+{
+	order_recorder *recorder;
+	int value;
+}
+order_entry;
+
+static void test_signal_record_callback(void *user_data, void *arguments)
+{
+	order_entry * const entry = user_data;
+	assert(!arguments);
+	entry->recorder->values[entry->recorder->count++] = entry->value;
+}
+
+static void test_signal_call_order(void)
+{
+	static int const expected[] = {3, 1, 0, 2, 4};
+	order_recorder recorder;
+	order_entry entries[5];
+	connection *middle;
+	signal s;
+	size_t i;
+
+	signal_create(&s);
+	recorder.count = 0;
+
+	for (i = 0; i < 5; ++i)
+	{
+		connection *c;
+		entries[i].recorder = &recorder;
+		entries[i].value = (int)i;
+		c = signal_connect(&s, test_signal_record_callback, entries + i, (i % 2) == 0);
+		assert(c);
+	}
+
+	signal_call(&s, 0);
+	assert(recorder.count == 5);
+	for (i = 0; i < 5; ++i)
+	{
+		assert(recorder.values[i] == expected[i]);
+	}
+
+	/* compaction keeps the order of the remaining entries */
+	middle = s.entries[s.begin + 2].handle;
+	connection_disconnect(middle);
+	recorder.count = 0;
+	signal_call(&s, 0);
+	assert(recorder.count == 4);
+	assert(recorder.values[1] == 1);
+	assert(recorder.values[2] == 2);
+
+	signal_destroy(&s);
+}
+
+typedef struct mass_disconnect
+{
+	connection **connections;
+	size_t count;
+	int called;
+}
+mass_disconnect;
+
+static void test_signal_mass_disconnect_callback(void *user_data, void *arguments)
+{
+	mass_disconnect * const m = user_data;
+	size_t i;
+	(void)arguments;
+
+	++(m->called);
+	/* the first callback to run disconnects every odd connection, all of which come later */
+	if (m->called == 1)
+	{
+		for (i = 1; i < m->count; i += 2)
+		{
+			connection_disconnect(m->connections[i]);
+		}
+	}
+}
+
+static void test_signal_many_connections(void)
+{
+	enum
+	{
+		connection_count = 10000
+	};
+	static connection *connections[connection_count];
+	mass_disconnect m;
+	signal s;
+	size_t i;
+
+	signal_create(&s);
+	m.connections = connections;
+	m.count = connection_count;
+	m.called = 0;
+
+	for (i = 0; i < (size_t)connection_count; ++i)
+	{
+		connections[i] = signal_connect(&s, test_signal_mass_disconnect_callback, &m, (int)(i % 2));
+		assert(connections[i]);
+	}
+
+	signal_call(&s, 0);
+	assert(m.called == (connection_count / 2));
+	assert(s.tombstones == 0);
+	assert((s.end - s.begin) == (connection_count / 2));
+
+	m.called = 0;
+	signal_call(&s, 0);
+	assert(m.called == (connection_count / 2));
+
+	signal_destroy(&s);
+}
+
+static void test_signal_count_callback(void *user_data, void *arguments)
+{
+	int * const calls = user_data;
+	(void)arguments;
+	++(*calls);
+}
+
+static void test_signal_connect_on_call_callback(void *user_data, void *arguments)
+{
+	signal * const s = user_data;
+	int * const calls = arguments;
+	++(*calls);
+	if (*calls == 1)
+	{
+		/* forces the entry array to move in both directions */
+		size_t i;
+		connection *last;
+		for (i = 0; i < 100; ++i)
+		{
+			connection * const c = signal_connect(s, test_signal_count_callback, calls, 0);
+			assert(c);
+		}
+		last = signal_connect(s, test_signal_count_callback, calls, 1);
+		assert(last);
+	}
+}
+
+static void test_signal_connect_on_call(void)
+{
+	signal s;
+	int calls = 0;
+
+	signal_create(&s);
+	{
+		connection * const c = signal_connect(&s, test_signal_connect_on_call_callback, &s, 1);
+		assert(c);
+	}
+
+	/* the entry connected at the end runs in the same call, the ones in front do not */
+	signal_call(&s, &calls);
+	assert(calls == 1 + 1);
+
+	calls = 0;
+	signal_call(&s, &calls);
+	assert(calls == 1 + 101);
+
+	signal_destroy(&s);
+}
+
+enum
+{
+	stress_emitters = 3,
+	stress_connectors = 2,
+	stress_calls = 20000,
+	stress_cycles = 2000,
+	stress_magic = 0x5ca1ab1e
+};
+
+typedef struct stress_state
+{
+	concurrent_signal signal;
+	unsigned long permanent_calls;
+	unsigned long temporary_calls;
+}
+stress_state;
+
+/* the user data of the connections a connector thread keeps making */
+typedef struct stress_connector
+{
+	stress_state *state;
+	long magic;
+}
+stress_connector;
+
+static void test_concurrent_signal_permanent(void *user_data, void *arguments)
+{
+	stress_state * const state = user_data;
+	assert(arguments == state);
+	__atomic_add_fetch(&state->permanent_calls, 1, __ATOMIC_RELAXED);
+}
+
+static void test_concurrent_signal_temporary(void *user_data, void *arguments)
+{
+	stress_connector const * const connector = user_data;
+	assert(connector->magic == stress_magic);
+	assert(arguments == connector->state);
+	__atomic_add_fetch(&connector->state->temporary_calls, 1, __ATOMIC_RELAXED);
+}
+
+static void *test_concurrent_signal_emitter(void *argument)
+{
+	stress_state * const state = argument;
+	int i;
+	for (i = 0; i < stress_calls; ++i)
+	{
+		concurrent_signal_call(&state->signal, state);
+	}
+	return 0;
+}
+
+static void *test_concurrent_signal_connector(void *argument)
+{
+	stress_connector * const connector = argument;
+	int i;
+	for (i = 0; i < stress_cycles; ++i)
+	{
+		concurrent_signal_connection const c = concurrent_signal_connect(&connector->state->signal, test_concurrent_signal_temporary, connector, i % 2);
+		int disconnected;
+		assert(c);
+		disconnected = concurrent_signal_disconnect(&connector->state->signal, c);
+		assert(disconnected);
+		disconnected = concurrent_signal_disconnect(&connector->state->signal, c);
+		assert(!disconnected);
+	}
+	return 0;
+}
+
+static void test_concurrent_signal_stress(void)
+{
+	static stress_state state;
+	stress_connector connector_states[stress_connectors];
+	pthread_t emitters[stress_emitters];
+	pthread_t connectors[stress_connectors];
+	concurrent_signal_connection permanent;
+	int i;
+	int result;
+
+	result = concurrent_signal_create(&state.signal);
+	assert(result);
+	state.permanent_calls = 0;
+	state.temporary_calls = 0;
+	permanent = concurrent_signal_connect(&state.signal, test_concurrent_signal_permanent, &state, 1);
+	assert(permanent);
+
+	for (i = 0; i < stress_emitters; ++i)
+	{
+		result = pthread_create(emitters + i, 0, test_concurrent_signal_emitter, &state);
+		assert(result == 0);
+	}
+	for (i = 0; i < stress_connectors; ++i)
+	{
+		connector_states[i].state = &state;
+		connector_states[i].magic = stress_magic;
+		result = pthread_create(connectors + i, 0, test_concurrent_signal_connector, connector_states + i);
+		assert(result == 0);
+	}
+	for (i = 0; i < stress_connectors; ++i)
+	{
+		result = pthread_join(connectors[i], 0);
+		assert(result == 0);
+	}
+	for (i = 0; i < stress_emitters; ++i)
+	{
+		result = pthread_join(emitters[i], 0);
+		assert(result == 0);
+	}
+
+	/* every call saw the permanent connection, whatever else was connected at the time */
+	assert(state.permanent_calls == (unsigned long)stress_emitters * stress_calls);
+	assert(concurrent_signal_size(&state.signal) == 1);
+	concurrent_signal_destroy(&state.signal);
+}
+
 int main(void)
 {
 	test_signal_call();
@@ -215,6 +499,10 @@ int main(void)
 	test_connection_disconnect_on_call();
 	test_connection_disconnect_grabbed_on_call();
 	test_connection_drop_after_destroy();
+	test_signal_call_order();
+	test_signal_many_connections();
+	test_signal_connect_on_call();
+	test_concurrent_signal_stress();
 
 	printf("Tests finished\n");
 	return 0;
@@ -1,128 +1,255 @@
 #include "signal.h"
 #include "connection.h"
+#include "connection_pool.h"
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 
+static size_t signal_max(size_t a, size_t b)
+{
+	return (a < b) ? b : a;
+}
+
+/* makes sure that there is room for one more entry in front of begin or behind end */
+static int signal_make_room(signal *s, int at_end)
+{
+	size_t const size = s->end - s->begin;
+	size_t new_begin, new_capacity;
+	signal_entry *entries;
+
+	if (at_end ? (s->end < s->capacity) : (s->begin > 0))
+	{
+		return 1;
+	}
+
+	/* grow the side that ran out by the current size, keep the other one */
+	new_begin = at_end ? s->begin : signal_max(size, 4);
+	new_capacity = new_begin + size + (at_end ? signal_max(size, 4) : (s->capacity - s->end));
+
+	if (new_begin == s->begin)
+	{
+		entries = realloc(s->entries, new_capacity * sizeof(*entries));
+		if (!entries)
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		size_t i;
+		size_t const shift = new_begin - s->begin;
+
+		entries = malloc(new_capacity * sizeof(*entries));
+		if (!entries)
+		{
+			return 0;
+		}
+		if (size)
+		{
+			memcpy(entries + new_begin, s->entries + s->begin, size * sizeof(*entries));
+		}
+		free(s->entries);
+
+		for (i = new_begin; i < (new_begin + size); ++i)
+		{
+			if (entries[i].handle)
+			{
+				entries[i].handle->index = i;
+			}
+		}
+		/* lets a running signal_call follow its position */
+		s->shifted += shift;
+	}
+
+	s->entries = entries;
+	s->end = new_begin + size;
+	s->begin = new_begin;
+	s->capacity = new_capacity;
+	return 1;
+}
+
+/* removes the tombstones, must not happen while the entries are being swept */
+static void signal_compact(signal *s)
+{
+	size_t read, write;
+	assert(!s->call_depth);
+
+	write = s->begin;
+	for (read = s->begin; read < s->end; ++read)
+	{
+		if (s->entries[read].callback)
+		{
+			if (read != write)
+			{
+				s->entries[write] = s->entries[read];
+				s->entries[write].handle->index = write;
+			}
+			++write;
+		}
+	}
+	s->end = write;
+	s->tombstones = 0;
+}
+
+
 void signal_create(signal *s)
 {
 	assert(s);
-	s->first = s->last = 0;
+	s->entries = 0;
+	s->begin = s->end = s->capacity = 0;
+	s->tombstones = 0;
 	s->call_depth = 0;
+	s->shifted = 0;
+	s->pool = 0;
 }
 
 void signal_destroy(signal *s)
 {
-	connection *c;
+	size_t i;
 	assert(s);
 	assert(!s->call_depth);
 
-	c = s->first;
-	while (c)
+	for (i = s->begin; i < s->end; ++i)
 	{
-		connection * const copy = c;
-		c = c->next;
+		connection * const c = s->entries[i].handle;
+		if (!c)
+		{
+			continue;
+		}
 
-		if (copy->external_refs)
+		c->is_connected = 0;
+		if (c->external_refs)
 		{
-			copy->parent = 0;
+			c->parent = 0;
 		}
 		else
 		{
-			connection_destroy(copy);
-			free(copy);
+			connection_release(c);
 		}
 	}
+	free(s->entries);
+
+	if (s->pool)
+	{
+		connection_pool_orphan(s->pool);
+	}
 }
 
 connection *signal_connect(signal *s, slot callback, void *user_data, int at_end)
 {
 	connection *result;
+	signal_entry *entry;
 	assert(s);
 	assert(callback);
 
-	result = malloc(sizeof(*result));
-	if (result)
+	if (!s->pool)
 	{
-		result->callback = callback;
-		result->user_data = user_data;
-		result->external_refs = 0;
-		result->parent = s;
-		result->is_connected = 1;
-
-		if (at_end)
+		s->pool = connection_pool_create();
+		if (!s->pool)
 		{
-			result->previous = s->last;
-			result->next = 0;
-			if (s->last)
-			{
-				s->last->next = result;
-			}
-			else
-			{
-				s->first = result;
-			}
-			s->last = result;
-		}
-		else
-		{
-			result->previous = 0;
-			result->next = s->first;
-			if (s->first)
-			{
-				s->first->previous = result;
-			}
-			else
-			{
-				s->last = result;
-			}
-			s->first = result;
+			return 0;
 		}
 	}
+
+	if (s->tombstones &&
+			!s->call_depth &&
+			(at_end ? (s->end == s->capacity) : (s->begin == 0)))
+	{
+		signal_compact(s);
+	}
+
+	result = connection_pool_allocate(s->pool);
+	if (!result)
+	{
+		return 0;
+	}
+	if (!signal_make_room(s, at_end))
+	{
+		connection_pool_deallocate(s->pool, result);
+		return 0;
+	}
+
+	result->parent = s;
+	result->external_refs = 0;
+	result->is_connected = 1;
+
+	if (at_end)
+	{
+		result->index = s->end++;
+	}
+	else
+	{
+		result->index = --(s->begin);
+	}
+
+	entry = s->entries + result->index;
+	entry->callback = callback;
+	entry->user_data = user_data;
+	entry->handle = result;
 	return result;
 }
 
 void signal_disconnect(signal *s, connection *c)
 {
+	signal_entry *entry;
 	assert(s);
 	assert(c);
+	assert(c->parent == s);
+	assert(c->is_connected);
+
+	entry = s->entries + c->index;
+	assert(entry->handle == c);
+	entry->callback = 0;
+	entry->user_data = 0;
+	entry->handle = 0;
+	++(s->tombstones);
 
 	c->is_connected = 0;
+	if (!c->external_refs)
+	{
+		connection_release(c);
+	}
 
 	if (!s->call_depth &&
-			!c->external_refs)
+			((s->tombstones * 2) > (s->end - s->begin)))
 	{
-		connection_remove(c);
+		signal_compact(s);
 	}
 }
 
 void signal_call(signal *s, void *arguments)
 {
-	connection *c;
+	size_t i;
+	size_t shifted;
 	assert(s);
 
 	++(s->call_depth);
 
-	for (c = s->first; c; )
+	/*
+	 * Callbacks may connect and disconnect. Entries connected at the end
+	 * are called in this sweep, entries connected in front are not. The
+	 * array may move, so it is indexed again after each callback.
+	 */
+	shifted = s->shifted;
+	for (i = s->begin; i < s->end; )
 	{
-		connection *next;
-
-		if (c->is_connected)
-		{
-			c->callback(c->user_data, arguments);
-		}
-
-		next = c->next;
-
-		if (!c->is_connected &&
-				!c->external_refs &&
-				(s->call_depth == 1))
+		signal_entry const * const entry = s->entries + i;
+		if (entry->callback)
 		{
-			connection_remove(c);
+			entry->callback(entry->user_data, arguments);
 		}
 
-		c = next;
+		++i;
+		i += s->shifted - shifted;
+		shifted = s->shifted;
 	}
 
 	--(s->call_depth);
+
+	if (!s->call_depth &&
+			s->tombstones)
+	{
+		signal_compact(s);
+	}
 }
@@ -6,10 +6,29 @@
 #include <stddef.h>
 
 
+/* a disconnected entry keeps its place without a callback until compaction */
+struct signal_entry
+{
+	slot callback;
+	void *user_data;
+	connection *handle;
+};
+
+/*
+ * The connected callbacks are entries[begin] to entries[end - 1], in call
+ * order, with free room on both sides so that connecting at either end is
+ * amortized O(1). Disconnecting leaves a tombstone. Tombstones are
+ * compacted away after the outermost signal_call, or once they make up
+ * half of the entries, so emission is a sweep over one array.
+ */
 struct signal
 {
-	connection *first, *last;
+	signal_entry *entries;
+	size_t begin, end, capacity;
+	size_t tombstones;
 	size_t call_depth;
+	size_t shifted;
+	connection_pool *pool;
 };
 
 void signal_create(signal *s);
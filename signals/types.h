@@ -3,7 +3,9 @@
 
 
 typedef struct signal signal;
+typedef struct signal_entry signal_entry;
 typedef struct connection connection;
+typedef struct connection_pool connection_pool;
 typedef void (*slot)(void *, void *);
 
 
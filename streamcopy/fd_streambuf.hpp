@@ -0,0 +1,132 @@
+#ifndef STREAMCOPY_FD_STREAMBUF_HPP
+#define STREAMCOPY_FD_STREAMBUF_HPP
+
+#include <streambuf>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace streamcopy
+{
+	// Write-only std::streambuf over a file descriptor. Small writes are
+	// collected in the put area. A write that does not fit is not copied:
+	// it goes out together with the collected bytes in one writev, so
+	// sink << source.rdbuf() hands every chunk of the source straight to
+	// the kernel.
+	class fd_streambuf : public std::streambuf
+	{
+	public:
+		explicit fd_streambuf(int descriptor, std::size_t buffer_size = 1 << 16)
+			: m_descriptor(descriptor)
+			, m_buffer(buffer_size)
+		{
+			reset_put_area();
+		}
+
+		~fd_streambuf()
+		{
+			flush_buffer();
+		}
+
+		fd_streambuf(const fd_streambuf &) = delete;
+		fd_streambuf &operator=(const fd_streambuf &) = delete;
+
+	protected:
+		int_type overflow(int_type c) override
+		{
+			if (!flush_buffer())
+			{
+				return traits_type::eof();
+			}
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
+			{
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+			}
+			return traits_type::not_eof(c);
+		}
+
+		std::streamsize xsputn(const char *data, std::streamsize size) override
+		{
+			if (size <= (epptr() - pptr()))
+			{
+				std::memcpy(pptr(), data, static_cast<std::size_t>(size));
+				pbump(static_cast<int>(size));
+				return size;
+			}
+
+			iovec vectors[2];
+			vectors[0].iov_base = pbase();
+			vectors[0].iov_len = static_cast<std::size_t>(pptr() - pbase());
+			vectors[1].iov_base = const_cast<char *>(data);
+			vectors[1].iov_len = static_cast<std::size_t>(size);
+			if (!write_all(vectors, 2))
+			{
+				return 0;
+			}
+			reset_put_area();
+			return size;
+		}
+
+		int sync() override
+		{
+			return flush_buffer() ? 0 : -1;
+		}
+
+	private:
+		int m_descriptor;
+		std::vector<char> m_buffer;
+
+		void reset_put_area()
+		{
+			setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+		}
+
+		bool flush_buffer()
+		{
+			iovec vector;
+			vector.iov_base = pbase();
+			vector.iov_len = static_cast<std::size_t>(pptr() - pbase());
+			if (!write_all(&vector, 1))
+			{
+				return false;
+			}
+			reset_put_area();
+			return true;
+		}
+
+		// writes all vectors, resuming after short writes
+		bool write_all(iovec *vectors, int count)
+		{
+			while ((count > 0) && (vectors->iov_len == 0))
+			{
+				++vectors;
+				--count;
+			}
+			while (count > 0)
+			{
+				ssize_t written = ::writev(m_descriptor, vectors, count);
+				if (written < 0)
+				{
+					return false;
+				}
+				while ((count > 0) && (static_cast<std::size_t>(written) >= vectors->iov_len))
+				{
+					written -= static_cast<ssize_t>(vectors->iov_len);
+					++vectors;
+					--count;
+				}
+				if (count > 0)
+				{
+					vectors->iov_base = static_cast<char *>(vectors->iov_base) + written;
+					vectors->iov_len -= static_cast<std::size_t>(written);
+				}
+			}
+			return true;
+		}
+	};
+}
+
+#endif
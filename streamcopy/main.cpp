@@ -1,8 +1,18 @@
 #include <iostream>
+#include <iomanip>
 #include <iterator>
 #include <sstream>
+#include <fstream>
 #include <algorithm>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 #include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 
 #ifdef _WIN32
 #	include <Windows.h>
@@ -11,6 +21,21 @@
 #	include <unistd.h>
 #endif
 
+#ifdef __linux__
+#	include <thread>
+#	include <cerrno>
+#	include <cstring>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/sendfile.h>
+#	include <sys/socket.h>
+#	include <sys/stat.h>
+#	include <netinet/in.h>
+#	include <arpa/inet.h>
+#	include "fd_streambuf.hpp"
+#	include "mmap_streambuf.hpp"
+#endif
+
 namespace
 {
 #ifdef _WIN32
@@ -73,82 +98,137 @@ namespace
 	}
 #endif
 
+	struct Options
+	{
+		std::size_t size;
+		std::size_t repetitions;
+	};
 
-	template <class Name, class Case>
-	void benchmarkCopy(const Name &name, std::istream &source, const Case &c)
+	struct Summary
 	{
-		source.clear();
-		source.seekg(0, std::ios::beg);
-		std::ostringstream sink;
-		Clock clock;
-		c(static_cast<std::ostream &>(sink));
-		const auto elapsed = clock.elapsed();
-		std::cout << name << ": " << elapsed << "\n";
+		double median;
+		double mean;
+		double deviation;
+		double minimum;
+		double maximum;
+	};
+
+	Summary summarize(std::vector<double> values)
+	{
+		Summary summary;
+		std::sort(values.begin(), values.end());
+		const auto count = static_cast<double>(values.size());
+		summary.minimum = values.front();
+		summary.maximum = values.back();
+		summary.median = (values.size() % 2)
+			? values[values.size() / 2]
+			: (values[values.size() / 2 - 1] + values[values.size() / 2]) / 2;
+		summary.mean = std::accumulate(values.begin(), values.end(), 0.0) / count;
+		double squares = 0;
+		for (const auto value : values)
+		{
+			squares += (value - summary.mean) * (value - summary.mean);
+		}
+		summary.deviation = (values.size() > 1) ? std::sqrt(squares / (count - 1)) : 0;
+		return summary;
 	}
 
-	void runBenchmarks(std::istream &source)
+	// one repetition of a case: seconds taken and I/O system calls made, negative if unknown
+	struct Sample
 	{
-		benchmarkCopy("std::istream_iterator + std::ostream_iterator",
-			source,
-			[&source](std::ostream &sink)
+		double seconds;
+		double syscalls;
+	};
+
+	void printSummary(const std::string &backend, const std::string &name, const Options &options, const std::vector<Sample> &samples)
+	{
+		const double megabytes = static_cast<double>(options.size) / (1 << 20);
+		std::vector<double> rates;
+		std::vector<double> syscalls;
+		for (const auto &sample : samples)
+		{
+			rates.push_back(megabytes / sample.seconds);
+			syscalls.push_back(sample.syscalls / megabytes);
+		}
+		const auto rate = summarize(rates);
+		const auto calls = summarize(syscalls);
+
+		std::cout << std::left << std::setw(8) << backend << std::setw(52) << name << std::right << std::fixed
+			<< std::setprecision(1)
+			<< std::setw(10) << rate.median
+			<< std::setw(10) << rate.mean
+			<< std::setw(9) << rate.deviation
+			<< std::setw(10) << rate.minimum
+			<< std::setw(10) << rate.maximum;
+		if (calls.minimum < 0)
+		{
+			std::cout << std::setw(12) << "-";
+		}
+		else
+		{
+			std::cout << std::setprecision(2) << std::setw(12) << calls.median;
+		}
+		std::cout << "\n" << std::flush;
+	}
+
+	typedef std::function<void (std::istream &, std::ostream &)> StreamCase;
+
+	std::vector<std::pair<std::string, StreamCase>> streamCases()
+	{
+		std::vector<std::pair<std::string, StreamCase>> cases;
+
+		cases.emplace_back("std::istream_iterator + std::ostream_iterator",
+			[](std::istream &source, std::ostream &sink)
 		{
 			std::copy( std::istream_iterator<char>(source>>std::noskipws), (std::istream_iterator<char>()), std::ostream_iterator<char>(sink) );
 		});
 
-		benchmarkCopy("std::istream_iterator + std::ostreambuf_iterator",
-			source,
-			[&source](std::ostream &sink)
+		cases.emplace_back("std::istream_iterator + std::ostreambuf_iterator",
+			[](std::istream &source, std::ostream &sink)
 		{
 			std::copy( std::istream_iterator<char>(source>>std::noskipws), (std::istream_iterator<char>()), std::ostreambuf_iterator<char>(sink) );
 		});
 
-		benchmarkCopy("std::istreambuf_iterator + std::ostream_iterator",
-			source,
-			[&source](std::ostream &sink)
+		cases.emplace_back("std::istreambuf_iterator + std::ostream_iterator",
+			[](std::istream &source, std::ostream &sink)
 		{
 			std::copy( std::istreambuf_iterator<char>(source>>std::noskipws), (std::istreambuf_iterator<char>()), std::ostream_iterator<char>(sink) );
 		});
 
-		benchmarkCopy("std::istreambuf_iterator + std::ostreambuf_iterator",
-			source,
-			[&source](std::ostream &sink)
+		cases.emplace_back("std::istreambuf_iterator + std::ostreambuf_iterator",
+			[](std::istream &source, std::ostream &sink)
 		{
 			std::copy( std::istreambuf_iterator<char>(source>>std::noskipws), (std::istreambuf_iterator<char>()), std::ostreambuf_iterator<char>(sink) );
 		});
 
-		benchmarkCopy("rdbuf",
-			source,
-			[&source](std::ostream &sink)
+		cases.emplace_back("rdbuf",
+			[](std::istream &source, std::ostream &sink)
 		{
 			sink << source.rdbuf();
 		});
 
+		for (const std::size_t bufferSize : {1UL, 1UL << 12, 1UL << 17})
 		{
-			const auto benchmarkCopyWithBuffer = [&](std::size_t bufferSize)
+			cases.emplace_back("read + write (" + std::to_string(static_cast<unsigned long long>(bufferSize)) + ")",
+				[bufferSize](std::istream &source, std::ostream &sink)
 			{
-				auto &source_ = source;
-				benchmarkCopy("read + write (" + std::to_string(static_cast<unsigned long long>(bufferSize)) + ")",
-					source,
-					[bufferSize, &source_](std::ostream &sink)
-				{
-					std::vector<char> buffer(bufferSize);
+				std::vector<char> buffer(bufferSize);
 
-					while (source_.read(buffer.data(), bufferSize) &&
-						(source_.gcount() > 0))
+				// the last read fails when it hits EOF early but still delivers its bytes
+				for (;;)
+				{
+					source.read(buffer.data(), bufferSize);
+					if (source.gcount() <= 0)
 					{
-						sink.write(buffer.data(), source_.gcount());
+						break;
 					}
-				});
-			};
-
-			benchmarkCopyWithBuffer(1UL);
-			benchmarkCopyWithBuffer(1UL << 12);
-			benchmarkCopyWithBuffer(1UL << 17);
+					sink.write(buffer.data(), source.gcount());
+				}
+			});
 		}
 
-		benchmarkCopy("get + put",
-			source,
-			[&source](std::ostream &sink)
+		cases.emplace_back("get + put",
+			[](std::istream &source, std::ostream &sink)
 		{
 			for (;;)
 			{
@@ -160,11 +240,603 @@ namespace
 				sink.put(c);
 			}
 		});
+
+		return cases;
+	}
+
+	std::string makeContent(std::size_t size)
+	{
+		std::string content(size, '\0');
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			content[i] = static_cast<char>((i * 131) % 251);
+		}
+		return content;
+	}
+
+	void runMemoryBenchmarks(const std::string &content, const Options &options)
+	{
+		std::istringstream source(content);
+		for (const auto &c : streamCases())
+		{
+			std::vector<Sample> samples;
+			for (std::size_t i = 0; i < options.repetitions; ++i)
+			{
+				source.clear();
+				source.seekg(0, std::ios::beg);
+				std::ostringstream sink;
+				Clock clock;
+				c.second(source, sink);
+				const Sample sample = {clock.elapsed(), -1};
+				if (sink.str() != content)
+				{
+					throw std::runtime_error(c.first + " did not copy everything");
+				}
+				samples.push_back(sample);
+			}
+			printSummary("memory", c.first, options, samples);
+		}
+	}
+
+#ifdef __linux__
+	void check(bool success, const char *what)
+	{
+		if (!success)
+		{
+			throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+		}
+	}
+
+	// read and write system calls of the calling thread so far, as counted in /proc
+	double countSyscalls()
+	{
+		std::ifstream io("/proc/thread-self/io");
+		std::string key;
+		double value;
+		double total = 0;
+		int found = 0;
+		while (io >> key >> value)
+		{
+			if ((key == "syscr:") || (key == "syscw:"))
+			{
+				total += value;
+				++found;
+			}
+		}
+		return (found == 2) ? total : -1;
+	}
+
+	// what reading /proc in countSyscalls adds by itself
+	double syscallOverhead()
+	{
+		static const double overhead = [] { const double first = countSyscalls(); return countSyscalls() - first; }();
+		return overhead;
+	}
+
+	// runs code that leaves the system calls to a library and asks the kernel how many there were
+	template <class Code>
+	double countedByKernel(const Code &code)
+	{
+		const double before = countSyscalls();
+		code();
+		const double after = countSyscalls();
+		return ((before < 0) || (after < 0)) ? -1 : (after - before - syscallOverhead());
+	}
+
+	class Descriptor
+	{
+		int _value;
+
+	public:
+		explicit Descriptor(int value = -1)
+			: _value(value)
+		{
+		}
+
+		~Descriptor()
+		{
+			reset();
+		}
+
+		Descriptor(const Descriptor &) = delete;
+		Descriptor &operator=(const Descriptor &) = delete;
+
+		int get() const
+		{
+			return _value;
+		}
+
+		void reset(int value = -1)
+		{
+			if (_value >= 0)
+			{
+				::close(_value);
+			}
+			_value = value;
+		}
+	};
+
+	// an empty file in $TMPDIR or /tmp that is removed when this goes out of scope
+	class TemporaryFile
+	{
+		std::string _path;
+
+	public:
+		explicit TemporaryFile(const char *prefix)
+		{
+			const char * const directory = std::getenv("TMPDIR");
+			const std::string pattern = std::string((directory && *directory) ? directory : "/tmp") + "/" + prefix + "-XXXXXX";
+			std::vector<char> path(pattern.begin(), pattern.end());
+			path.push_back('\0');
+			const Descriptor file(::mkstemp(path.data()));
+			check(file.get() >= 0, "mkstemp");
+			_path = path.data();
+		}
+
+		~TemporaryFile()
+		{
+			::unlink(_path.c_str());
+		}
+
+		TemporaryFile(const TemporaryFile &) = delete;
+		TemporaryFile &operator=(const TemporaryFile &) = delete;
+
+		const std::string &path() const
+		{
+			return _path;
+		}
+	};
+
+	enum class SinkKind
+	{
+		file,
+		pipe,
+		socket
+	};
+
+	// reads a descriptor to its end on a thread of its own and counts the bytes
+	class Drain
+	{
+		std::thread _thread;
+		std::size_t _received;
+
+	public:
+		// the owner closes the write side first, otherwise this waits forever
+		~Drain()
+		{
+			if (_thread.joinable())
+			{
+				_thread.join();
+			}
+		}
+
+		void start(int descriptor)
+		{
+			_received = 0;
+			_thread = std::thread([this, descriptor]
+			{
+				std::vector<char> buffer(1 << 20);
+				for (;;)
+				{
+					const auto got = ::read(descriptor, buffer.data(), buffer.size());
+					if (got <= 0)
+					{
+						break;
+					}
+					_received += static_cast<std::size_t>(got);
+				}
+			});
+		}
+
+		std::size_t join()
+		{
+			_thread.join();
+			return _received;
+		}
+	};
+
+	class Sink
+	{
+	public:
+		virtual ~Sink()
+		{
+		}
+
+		virtual SinkKind kind() const = 0;
+		virtual const char *name() const = 0;
+
+		// prepares an empty sink and returns the descriptor to write into
+		virtual int open() = 0;
+
+		// closes the write side and returns how many bytes arrived
+		virtual std::size_t finish() = 0;
+	};
+
+	class FileSink : public Sink
+	{
+		TemporaryFile _path;
+		Descriptor _file;
+
+	public:
+		FileSink()
+			: _path("streamcopy-sink")
+		{
+		}
+
+		SinkKind kind() const override
+		{
+			return SinkKind::file;
+		}
+
+		const char *name() const override
+		{
+			return "file";
+		}
+
+		int open() override
+		{
+			_file.reset(::open(_path.path().c_str(), O_WRONLY | O_TRUNC));
+			check(_file.get() >= 0, "open sink file");
+			return _file.get();
+		}
+
+		std::size_t finish() override
+		{
+			struct stat info;
+			check(::fstat(_file.get(), &info) == 0, "fstat sink file");
+			_file.reset();
+			return static_cast<std::size_t>(info.st_size);
+		}
+	};
+
+	class PipeSink : public Sink
+	{
+		Descriptor _read;
+		Descriptor _write;
+		Drain _drain;
+
+	public:
+		// lets the drain end when a copy failed before finish
+		~PipeSink()
+		{
+			_write.reset();
+		}
+
+		SinkKind kind() const override
+		{
+			return SinkKind::pipe;
+		}
+
+		const char *name() const override
+		{
+			return "pipe";
+		}
+
+		int open() override
+		{
+			int ends[2];
+			check(::pipe(ends) == 0, "pipe");
+			_read.reset(ends[0]);
+			_write.reset(ends[1]);
+			_drain.start(_read.get());
+			return _write.get();
+		}
+
+		std::size_t finish() override
+		{
+			_write.reset();
+			const auto received = _drain.join();
+			_read.reset();
+			return received;
+		}
+	};
+
+	class TcpSink : public Sink
+	{
+		Descriptor _listener;
+		Descriptor _client;
+		Descriptor _server;
+		sockaddr_in _address;
+		Drain _drain;
+
+	public:
+		TcpSink()
+			: _listener(::socket(AF_INET, SOCK_STREAM, 0))
+		{
+			check(_listener.get() >= 0, "socket");
+			std::memset(&_address, 0, sizeof(_address));
+			_address.sin_family = AF_INET;
+			_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t length = sizeof(_address);
+			check(::bind(_listener.get(), reinterpret_cast<sockaddr *>(&_address), sizeof(_address)) == 0, "bind");
+			check(::getsockname(_listener.get(), reinterpret_cast<sockaddr *>(&_address), &length) == 0, "getsockname");
+			check(::listen(_listener.get(), 1) == 0, "listen");
+		}
+
+		// lets the drain end when a copy failed before finish
+		~TcpSink()
+		{
+			_client.reset();
+		}
+
+		SinkKind kind() const override
+		{
+			return SinkKind::socket;
+		}
+
+		const char *name() const override
+		{
+			return "tcp";
+		}
+
+		int open() override
+		{
+			_client.reset(::socket(AF_INET, SOCK_STREAM, 0));
+			check(_client.get() >= 0, "socket");
+			check(::connect(_client.get(), reinterpret_cast<sockaddr *>(&_address), sizeof(_address)) == 0, "connect");
+			_server.reset(::accept(_listener.get(), nullptr, nullptr));
+			check(_server.get() >= 0, "accept");
+			_drain.start(_server.get());
+			return _client.get();
+		}
+
+		std::size_t finish() override
+		{
+			_client.reset();
+			const auto received = _drain.join();
+			_server.reset();
+			return received;
+		}
+	};
+
+	// fstat, mmap, madvise and munmap of a streamcopy::mmap_streambuf over a non-empty file
+	const double mmapStreambufCalls = 4;
+
+	// copies size bytes from the start of a regular file into the sink, returns the system calls it made
+	typedef std::function<double (int source, std::size_t size, int sink, SinkKind kind)> DescriptorCase;
+
+	struct DescriptorStrategy
+	{
+		std::string name;
+		bool fileSinkOnly;
+		DescriptorCase copy;
+	};
+
+	std::size_t writeAll(int sink, const char *data, std::size_t size)
+	{
+		std::size_t calls = 0;
+		while (size > 0)
+		{
+			const auto written = ::write(sink, data, size);
+			check(written > 0, "write");
+			data += written;
+			size -= static_cast<std::size_t>(written);
+			++calls;
+		}
+		return calls;
+	}
+
+	std::vector<DescriptorStrategy> descriptorStrategies()
+	{
+		std::vector<DescriptorStrategy> strategies;
+
+		strategies.push_back({"sendfile", false, [](int source, std::size_t size, int sink, SinkKind) -> double
+		{
+			std::size_t calls = 0;
+			off_t offset = 0;
+			while (static_cast<std::size_t>(offset) < size)
+			{
+				check(::sendfile(sink, source, &offset, size - static_cast<std::size_t>(offset)) > 0, "sendfile");
+				++calls;
+			}
+			return calls;
+		}});
+
+		// splice needs a pipe on one side, so other sinks go through an intermediate one
+		strategies.push_back({"splice", false, [](int source, std::size_t size, int sink, SinkKind kind) -> double
+		{
+			std::size_t calls = 0;
+			loff_t offset = 0;
+			if (kind == SinkKind::pipe)
+			{
+				while (static_cast<std::size_t>(offset) < size)
+				{
+					check(::splice(source, &offset, sink, nullptr, size - static_cast<std::size_t>(offset), SPLICE_F_MOVE) > 0, "splice");
+					++calls;
+				}
+				return calls;
+			}
+
+			int ends[2];
+			check(::pipe(ends) == 0, "pipe");
+			const Descriptor read(ends[0]);
+			const Descriptor write(ends[1]);
+			while (static_cast<std::size_t>(offset) < size)
+			{
+				auto moved = ::splice(source, &offset, write.get(), nullptr, size - static_cast<std::size_t>(offset), SPLICE_F_MOVE);
+				check(moved > 0, "splice");
+				++calls;
+				while (moved > 0)
+				{
+					const auto out = ::splice(read.get(), nullptr, sink, nullptr, static_cast<std::size_t>(moved), SPLICE_F_MOVE);
+					check(out > 0, "splice");
+					moved -= out;
+					++calls;
+				}
+			}
+			return calls;
+		}});
+
+		strategies.push_back({"copy_file_range", true, [](int source, std::size_t size, int sink, SinkKind) -> double
+		{
+			std::size_t calls = 0;
+			loff_t offset = 0;
+			while (static_cast<std::size_t>(offset) < size)
+			{
+				check(::copy_file_range(source, &offset, sink, nullptr, size - static_cast<std::size_t>(offset), 0) > 0, "copy_file_range");
+				++calls;
+			}
+			return calls;
+		}});
+
+		strategies.push_back({"mmap + write", false, [](int source, std::size_t size, int sink, SinkKind) -> double
+		{
+			void * const content = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, source, 0);
+			check(content != MAP_FAILED, "mmap");
+			::madvise(content, size, MADV_SEQUENTIAL);
+			const auto calls = writeAll(sink, static_cast<const char *>(content), size);
+			::munmap(content, size);
+			// mmap, madvise and munmap count too
+			return static_cast<double>(calls + 3);
+		}});
+
+		// iostream interfaces on both ends, but the bytes go from the mapping straight into writev.
+		// The kernel only counts the writes; fstat, mmap, madvise and munmap of mmap_streambuf count too.
+		strategies.push_back({"mmap_streambuf + fd_streambuf: rdbuf", false, [](int source, std::size_t, int sink, SinkKind)
+		{
+			return mmapStreambufCalls + countedByKernel([&]
+			{
+				streamcopy::mmap_streambuf input(source);
+				streamcopy::fd_streambuf output(sink);
+				std::istream sourceStream(&input);
+				std::ostream sinkStream(&output);
+				sinkStream << sourceStream.rdbuf();
+				sinkStream.flush();
+			});
+		}});
+
+		strategies.push_back({"mmap_streambuf + fd_streambuf: istreambuf_iterator", false, [](int source, std::size_t, int sink, SinkKind)
+		{
+			return mmapStreambufCalls + countedByKernel([&]
+			{
+				streamcopy::mmap_streambuf input(source);
+				streamcopy::fd_streambuf output(sink);
+				std::istream sourceStream(&input);
+				std::ostream sinkStream(&output);
+				std::copy(std::istreambuf_iterator<char>(sourceStream), std::istreambuf_iterator<char>(), std::ostreambuf_iterator<char>(sinkStream));
+				sinkStream.flush();
+			});
+		}});
+
+		return strategies;
+	}
+
+	// one repetition against a fresh sink; copy gets the sink descriptor and returns the system calls it made
+	template <class Copy>
+	Sample measure(const std::string &name, Sink &sink, const Options &options, const Copy &copy)
+	{
+		const int output = sink.open();
+		Clock clock;
+		const double syscalls = copy(output);
+		const Sample sample = {clock.elapsed(), syscalls};
+		if (sink.finish() != options.size)
+		{
+			throw std::runtime_error(name + " did not copy everything into the " + sink.name());
+		}
+		return sample;
+	}
+
+	void runDescriptorBenchmarks(const std::string &sourcePath, Sink &sink, const Options &options)
+	{
+		for (const auto &c : streamCases())
+		{
+			std::vector<Sample> samples;
+			for (std::size_t i = 0; i < options.repetitions; ++i)
+			{
+				std::ifstream source(sourcePath, std::ios::binary);
+				samples.push_back(measure(c.first, sink, options, [&](int output)
+				{
+					return countedByKernel([&]
+					{
+						streamcopy::fd_streambuf buffer(output);
+						std::ostream stream(&buffer);
+						c.second(source, stream);
+						stream.flush();
+					});
+				}));
+			}
+			printSummary(sink.name(), c.first, options, samples);
+		}
+
+		for (const auto &strategy : descriptorStrategies())
+		{
+			if (strategy.fileSinkOnly && (sink.kind() != SinkKind::file))
+			{
+				continue;
+			}
+			std::vector<Sample> samples;
+			for (std::size_t i = 0; i < options.repetitions; ++i)
+			{
+				const Descriptor source(::open(sourcePath.c_str(), O_RDONLY));
+				check(source.get() >= 0, "open source file");
+				samples.push_back(measure(strategy.name, sink, options, [&](int output)
+				{
+					return strategy.copy(source.get(), options.size, output, sink.kind());
+				}));
+			}
+			printSummary(sink.name(), strategy.name, options, samples);
+		}
+	}
+#endif
+
+	void runBenchmarks(const Options &options)
+	{
+		const auto content = makeContent(options.size);
+
+		std::cout << options.size << " bytes, " << options.repetitions << " repetitions, MB/s except for the last column\n";
+		std::cout << std::left << std::setw(8) << "sink" << std::setw(52) << "strategy" << std::right
+			<< std::setw(10) << "median"
+			<< std::setw(10) << "mean"
+			<< std::setw(9) << "stddev"
+			<< std::setw(10) << "min"
+			<< std::setw(10) << "max"
+			<< std::setw(12) << "syscalls/MB" << "\n";
+
+		runMemoryBenchmarks(content, options);
+
+#ifdef __linux__
+		// the source file stays in the page cache, so this measures the copy paths and not the disk
+		const TemporaryFile sourceFile("streamcopy-source");
+		const std::string &sourcePath = sourceFile.path();
+		{
+			std::ofstream source(sourcePath, std::ios::binary);
+			source.write(content.data(), static_cast<std::streamsize>(content.size()));
+			if (!source)
+			{
+				throw std::runtime_error("Could not write " + sourcePath);
+			}
+		}
+
+		std::vector<std::unique_ptr<Sink>> sinks;
+		sinks.emplace_back(new FileSink);
+		sinks.emplace_back(new PipeSink);
+		sinks.emplace_back(new TcpSink);
+		for (const auto &sink : sinks)
+		{
+			runDescriptorBenchmarks(sourcePath, *sink, options);
+		}
+#endif
 	}
 }
 
 int main(int argc, char* argv[])
 {
-	std::istringstream source(std::string(104857600 / 10, ' '));
-	runBenchmarks(source);
+	Options options;
+	options.size = ((argc >= 2) ? static_cast<std::size_t>(std::atol(argv[1])) : 10) * 1024 * 1024;
+	options.repetitions = (argc >= 3) ? static_cast<std::size_t>(std::atol(argv[2])) : 5;
+	if ((options.size == 0) || (options.repetitions == 0))
+	{
+		std::cerr << "Syntax: streamcopy [megabytes [repetitions]]\n";
+		return 1;
+	}
+
+	try
+	{
+		runBenchmarks(options);
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
 }
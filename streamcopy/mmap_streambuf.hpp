@@ -0,0 +1,143 @@
+#ifndef STREAMCOPY_MMAP_STREAMBUF_HPP
+#define STREAMCOPY_MMAP_STREAMBUF_HPP
+
+#include <streambuf>
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace streamcopy
+{
+	// Read-only std::streambuf over a mapped file. The whole mapping is the
+	// get area, so consumers like operator<<(std::streambuf *) or
+	// std::istreambuf_iterator read straight from the page cache and the
+	// buffer never refills.
+	class mmap_streambuf : public std::streambuf
+	{
+	public:
+		mmap_streambuf()
+			: m_begin(nullptr)
+			, m_size(0)
+			, m_is_open(false)
+		{
+		}
+
+		explicit mmap_streambuf(int descriptor)
+			: mmap_streambuf()
+		{
+			open(descriptor);
+		}
+
+		~mmap_streambuf()
+		{
+			close();
+		}
+
+		mmap_streambuf(const mmap_streambuf &) = delete;
+		mmap_streambuf &operator=(const mmap_streambuf &) = delete;
+
+		// maps the file behind the descriptor, which may be closed afterwards
+		bool open(int descriptor)
+		{
+			close();
+
+			struct stat info;
+			if (::fstat(descriptor, &info) != 0)
+			{
+				return false;
+			}
+
+			m_size = static_cast<std::size_t>(info.st_size);
+			if (m_size > 0)
+			{
+				void * const content = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+				if (content == MAP_FAILED)
+				{
+					m_size = 0;
+					return false;
+				}
+				::madvise(content, m_size, MADV_SEQUENTIAL);
+				m_begin = static_cast<char *>(content);
+			}
+			setg(m_begin, m_begin, m_begin + m_size);
+			m_is_open = true;
+			return true;
+		}
+
+		bool open(const char *path)
+		{
+			const int descriptor = ::open(path, O_RDONLY);
+			if (descriptor < 0)
+			{
+				return false;
+			}
+			const bool success = open(descriptor);
+			::close(descriptor);
+			return success;
+		}
+
+		bool is_open() const
+		{
+			return m_is_open;
+		}
+
+		void close()
+		{
+			if (m_begin)
+			{
+				::munmap(m_begin, m_size);
+			}
+			m_begin = nullptr;
+			m_size = 0;
+			m_is_open = false;
+			setg(nullptr, nullptr, nullptr);
+		}
+
+	protected:
+		std::streamsize showmanyc() override
+		{
+			return (gptr() == egptr()) ? -1 : (egptr() - gptr());
+		}
+
+		pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+		{
+			if (!(which & std::ios_base::in))
+			{
+				return pos_type(off_type(-1));
+			}
+
+			off_type base = 0;
+			if (direction == std::ios_base::cur)
+			{
+				base = gptr() - eback();
+			}
+			else if (direction == std::ios_base::end)
+			{
+				base = static_cast<off_type>(m_size);
+			}
+			return seekpos(pos_type(base + offset), which);
+		}
+
+		pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+		{
+			const off_type offset = position;
+			if (!(which & std::ios_base::in) ||
+				(offset < 0) ||
+				(offset > static_cast<off_type>(m_size)))
+			{
+				return pos_type(off_type(-1));
+			}
+			setg(m_begin, m_begin + offset, m_begin + m_size);
+			return position;
+		}
+
+	private:
+		char *m_begin;
+		std::size_t m_size;
+		bool m_is_open;
+	};
+}
+
+#endif
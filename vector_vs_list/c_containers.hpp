@@ -0,0 +1,307 @@
+#ifndef VECTOR_VS_LIST_C_CONTAINERS_HPP
+#define VECTOR_VS_LIST_C_CONTAINERS_HPP
+
+#include "c_containers_bridge.h"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <new>
+
+extern "C"
+{
+#include "allocator.h"
+#include "pool.h"
+}
+
+namespace vsl
+{
+	// The c_containers pools of one allocator and of all copies and
+	// rebinds of it, one per object size, created on first use.
+	class pool_registry
+	{
+	public:
+		pool_registry()
+		{
+		}
+
+		~pool_registry()
+		{
+			for (auto &entry : m_pools)
+			{
+				::pool_destroy(entry.second.get());
+			}
+		}
+
+		pool_registry(pool_registry const &) = delete;
+		pool_registry &operator=(pool_registry const &) = delete;
+
+		::pool *get(std::size_t object_size)
+		{
+			auto &found = m_pools[object_size];
+			if (!found)
+			{
+				std::unique_ptr< ::pool> p(new ::pool);
+				::pool_create(p.get(), object_size, 4096);
+				found = std::move(p);
+			}
+			return found.get();
+		}
+
+	private:
+		std::map<std::size_t, std::unique_ptr< ::pool>> m_pools;
+	};
+
+	// Standard allocator that takes single objects from a c_containers
+	// pool. Copies and rebinds, as std::list makes for its nodes, share a
+	// pool_registry and compare equal, so memory allocated through one can
+	// be freed through any other.
+	template <class T>
+	class pool_allocator
+	{
+	public:
+		typedef T value_type;
+
+		pool_allocator()
+			: m_pools(std::make_shared<pool_registry>())
+			, m_pool(m_pools->get(sizeof(T)))
+		{
+		}
+
+		template <class U>
+		pool_allocator(pool_allocator<U> const &other)
+			: m_pools(other.m_pools)
+			, m_pool(m_pools->get(sizeof(T)))
+		{
+		}
+
+		T *allocate(std::size_t n)
+		{
+			::allocator const a = ::pool_allocator(m_pool);
+			void * const memory = allocator_allocate(&a, n * sizeof(T));
+			if (!memory)
+			{
+				throw std::bad_alloc();
+			}
+			return static_cast<T *>(memory);
+		}
+
+		void deallocate(T *p, std::size_t n)
+		{
+			::allocator const a = ::pool_allocator(m_pool);
+			allocator_deallocate(&a, p, n * sizeof(T));
+		}
+
+		template <class U>
+		bool operator == (pool_allocator<U> const &other) const
+		{
+			return m_pools == other.m_pools;
+		}
+
+		template <class U>
+		bool operator != (pool_allocator<U> const &other) const
+		{
+			return m_pools != other.m_pools;
+		}
+
+	private:
+		template <class U>
+		friend class pool_allocator;
+
+		std::shared_ptr<pool_registry> m_pools;
+		::pool *m_pool;
+	};
+
+	// The wrappers below own one C container each and give it the member
+	// functions of the matching standard container that the harness calls.
+	// Containers without iterators offer for_each instead. T must be
+	// trivially copyable.
+
+	template <class T>
+	class c_handle
+	{
+	public:
+		c_handle(void *handle, void (*destroy)(void *))
+			: m_handle(handle)
+			, m_destroy(destroy)
+		{
+			if (!m_handle)
+			{
+				throw std::bad_alloc();
+			}
+		}
+
+		~c_handle()
+		{
+			m_destroy(m_handle);
+		}
+
+		c_handle(c_handle const &) = delete;
+		c_handle &operator=(c_handle const &) = delete;
+
+	protected:
+		void *m_handle;
+
+		static void check(int success)
+		{
+			if (!success)
+			{
+				throw std::bad_alloc();
+			}
+		}
+
+		template <class Function>
+		static void visit(void const *element, void *function)
+		{
+			(*static_cast<Function *>(function))(*static_cast<T const *>(element));
+		}
+
+	private:
+		void (*m_destroy)(void *);
+	};
+
+	template <class T>
+	class c_vector : public c_handle<T>
+	{
+	public:
+		c_vector()
+			: c_handle<T>(bridge_vector_create(sizeof(T)), bridge_vector_destroy)
+		{
+		}
+
+		void push_back(T const &value)
+		{
+			this->check(bridge_vector_push_back(this->m_handle, &value));
+		}
+
+		T *insert(T *position, T const &value)
+		{
+			std::size_t const index = static_cast<std::size_t>(position - begin());
+			this->check(bridge_vector_insert(this->m_handle, index, &value));
+			return begin() + index;
+		}
+
+		T *insert(T *position, T const *first, T const *last)
+		{
+			std::size_t const index = static_cast<std::size_t>(position - begin());
+			this->check(bridge_vector_insert_n(this->m_handle, index, first, static_cast<std::size_t>(last - first)));
+			return begin() + index;
+		}
+
+		T *erase(T *position)
+		{
+			std::size_t const index = static_cast<std::size_t>(position - begin());
+			bridge_vector_erase(this->m_handle, index);
+			return begin() + index;
+		}
+
+		T *begin() const
+		{
+			return static_cast<T *>(bridge_vector_data(this->m_handle));
+		}
+
+		T *end() const
+		{
+			return begin() + bridge_vector_size(this->m_handle);
+		}
+	};
+
+	template <class T>
+	class c_list : public c_handle<T>
+	{
+	public:
+		c_list()
+			: c_handle<T>(bridge_list_create(sizeof(T)), bridge_list_destroy)
+		{
+		}
+
+		void push_back(T const &value)
+		{
+			this->check(bridge_list_push_back(this->m_handle, &value));
+		}
+
+		template <class Function>
+		void for_each(Function &function)
+		{
+			bridge_list_visit(this->m_handle, &c_handle<T>::template visit<Function>, &function);
+		}
+	};
+
+	template <class T>
+	class c_hash_set : public c_handle<T>
+	{
+	public:
+		c_hash_set()
+			: c_handle<T>(bridge_hash_set_create(sizeof(T)), bridge_hash_set_destroy)
+		{
+		}
+
+		void insert(T const &value)
+		{
+			this->check(bridge_hash_set_insert(this->m_handle, &value));
+		}
+
+		void insert(T const *first, T const *last)
+		{
+			this->check(bridge_hash_set_insert_n(this->m_handle, first, static_cast<std::size_t>(last - first)));
+		}
+
+		void erase(T const &value)
+		{
+			bridge_hash_set_erase(this->m_handle, &value);
+		}
+
+		std::size_t count(T const &value) const
+		{
+			return bridge_hash_set_contains(this->m_handle, &value) ? 1 : 0;
+		}
+
+		template <class Function>
+		void for_each(Function &function)
+		{
+			bridge_hash_set_visit(this->m_handle, &c_handle<T>::template visit<Function>, &function);
+		}
+	};
+
+	// tree_map without values, ordered by key
+	template <class T>
+	class c_tree_set : public c_handle<T>
+	{
+	public:
+		c_tree_set()
+			: c_handle<T>(bridge_tree_set_create(sizeof(T)), bridge_tree_set_destroy)
+		{
+		}
+
+		void insert(T const &value)
+		{
+			this->check(bridge_tree_set_insert(this->m_handle, &value));
+		}
+
+		// tree_map has no batch insertion
+		void insert(T const *first, T const *last)
+		{
+			for (; first != last; ++first)
+			{
+				insert(*first);
+			}
+		}
+
+		void erase(T const &value)
+		{
+			bridge_tree_set_erase(this->m_handle, &value);
+		}
+
+		std::size_t count(T const &value) const
+		{
+			return bridge_tree_set_contains(this->m_handle, &value) ? 1 : 0;
+		}
+
+		template <class Function>
+		void for_each(Function &function)
+		{
+			bridge_tree_set_visit(this->m_handle, &c_handle<T>::template visit<Function>, &function);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "c_containers_bridge.h"
+#include "hash_functions.h"
+#include "hash_set.h"
+#include "linked_list.h"
+#include "pool.h"
+#include "tree_map.h"
+#include "vector.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef struct bridge_list
+{
+	pool pool;
+	linked_list list;
+}
+bridge_list;
+
+typedef struct bridge_hash_set
+{
+	hash_parameters parameters;
+	hash_set set;
+}
+bridge_hash_set;
+
+static int compare_keys(const void *left, const void *right, void *user_data)
+{
+	unsigned long long l, r;
+	(void)user_data;
+	memcpy(&l, left, sizeof(l));
+	memcpy(&r, right, sizeof(r));
+	return (l < r) ? -1 : (l > r);
+}
+
+
+void *bridge_vector_create(size_t element_size)
+{
+	vector * const v = malloc(sizeof(*v));
+	if (v)
+	{
+		vector_create(v, element_size);
+	}
+	return v;
+}
+
+void bridge_vector_destroy(void *v)
+{
+	vector_destroy(v);
+	free(v);
+}
+
+int bridge_vector_push_back(void *v, const void *element)
+{
+	return vector_push_back(v, element);
+}
+
+int bridge_vector_insert(void *v, size_t position, const void *element)
+{
+	return vector_insert(v, position, element);
+}
+
+int bridge_vector_insert_n(void *v, size_t position, const void *elements, size_t count)
+{
+	return vector_insert_n(v, position, elements, count);
+}
+
+void bridge_vector_erase(void *v, size_t position)
+{
+	vector_erase(v, position);
+}
+
+void *bridge_vector_data(void *v)
+{
+	return vector_data(v);
+}
+
+size_t bridge_vector_size(void *v)
+{
+	return vector_size(v);
+}
+
+void *bridge_list_create(size_t element_size)
+{
+	bridge_list * const l = malloc(sizeof(*l));
+	allocator a;
+	if (!l)
+	{
+		return 0;
+	}
+	pool_create(&l->pool, linked_list_entry_size(element_size), 4096);
+	a = pool_allocator(&l->pool);
+	linked_list_create_with_allocator(&l->list, element_size, &a);
+	return l;
+}
+
+void bridge_list_destroy(void *list)
+{
+	bridge_list * const l = list;
+	linked_list_destroy(&l->list);
+	pool_destroy(&l->pool);
+	free(l);
+}
+
+int bridge_list_push_back(void *list, const void *element)
+{
+	bridge_list * const l = list;
+	return linked_list_push_back(&l->list, element);
+}
+
+void bridge_list_visit(void *list, bridge_visitor_t visitor, void *user_data)
+{
+	bridge_list * const l = list;
+	linked_list_iterator i;
+	for (i = linked_list_first(&l->list); i; linked_list_next(&i))
+	{
+		visitor(linked_list_deref(i), user_data);
+	}
+}
+
+void *bridge_hash_set_create(size_t element_size)
+{
+	bridge_hash_set * const s = malloc(sizeof(*s));
+	if (s)
+	{
+		hash_parameters_create(&s->parameters, element_size, 0);
+		hash_set_create(&s->set, element_size, hash_function_for_size(element_size), &s->parameters);
+	}
+	return s;
+}
+
+void bridge_hash_set_destroy(void *set)
+{
+	bridge_hash_set * const s = set;
+	hash_set_destroy(&s->set);
+	free(s);
+}
+
+int bridge_hash_set_insert(void *set, const void *element)
+{
+	bridge_hash_set * const s = set;
+	return hash_set_insert(&s->set, element);
+}
+
+int bridge_hash_set_insert_n(void *set, const void *elements, size_t count)
+{
+	bridge_hash_set * const s = set;
+	return hash_set_insert_n(&s->set, elements, count);
+}
+
+void bridge_hash_set_erase(void *set, const void *element)
+{
+	bridge_hash_set * const s = set;
+	hash_set_erase(&s->set, element);
+}
+
+int bridge_hash_set_contains(void *set, const void *element)
+{
+	bridge_hash_set * const s = set;
+	return hash_set_contains(&s->set, element);
+}
+
+void bridge_hash_set_visit(void *set, bridge_visitor_t visitor, void *user_data)
+{
+	bridge_hash_set * const s = set;
+	hash_set_iterator i = hash_set_iterate(&s->set);
+	while (hash_set_iterator_next(&i))
+	{
+		visitor(hash_set_iterator_key(&i), user_data);
+	}
+}
+
+void *bridge_tree_set_create(size_t element_size)
+{
+	tree_map * const m = malloc(sizeof(*m));
+	if (m)
+	{
+		tree_map_create(m, element_size, 0, compare_keys, 0);
+	}
+	return m;
+}
+
+void bridge_tree_set_destroy(void *set)
+{
+	tree_map_destroy(set);
+	free(set);
+}
+
+int bridge_tree_set_insert(void *set, const void *element)
+{
+	return tree_map_insert(set, element, element);
+}
+
+void bridge_tree_set_erase(void *set, const void *element)
+{
+	tree_map_erase(set, element);
+}
+
+int bridge_tree_set_contains(void *set, const void *element)
+{
+	return tree_map_find(set, element) != 0;
+}
+
+void bridge_tree_set_visit(void *set, bridge_visitor_t visitor, void *user_data)
+{
+	tree_map_iterator i = tree_map_iterate(set);
+	while (tree_map_iterator_next(&i))
+	{
+		visitor(tree_map_iterator_key(&i), user_data);
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef VECTOR_VS_LIST_C_CONTAINERS_BRIDGE_H
+#define VECTOR_VS_LIST_C_CONTAINERS_BRIDGE_H
+
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The c_containers headers cannot be included from C++ (their structs
+ * have members named like their types), so the benchmark reaches them
+ * through these functions. Elements are compared and hashed by all of
+ * their bytes; tree sets order by the unsigned 64 bit number at the start
+ * of each element.
+ */
+
+typedef void (*bridge_visitor_t)(const void *element, void *user_data);
+
+void *bridge_vector_create(size_t element_size);
+void bridge_vector_destroy(void *v);
+int bridge_vector_push_back(void *v, const void *element);
+int bridge_vector_insert(void *v, size_t position, const void *element);
+int bridge_vector_insert_n(void *v, size_t position, const void *elements, size_t count);
+void bridge_vector_erase(void *v, size_t position);
+void *bridge_vector_data(void *v);
+size_t bridge_vector_size(void *v);
+
+/* linked_list whose entries come from a pool */
+void *bridge_list_create(size_t element_size);
+void bridge_list_destroy(void *list);
+int bridge_list_push_back(void *list, const void *element);
+void bridge_list_visit(void *list, bridge_visitor_t visitor, void *user_data);
+
+void *bridge_hash_set_create(size_t element_size);
+void bridge_hash_set_destroy(void *set);
+int bridge_hash_set_insert(void *set, const void *element);
+int bridge_hash_set_insert_n(void *set, const void *elements, size_t count);
+void bridge_hash_set_erase(void *set, const void *element);
+int bridge_hash_set_contains(void *set, const void *element);
+void bridge_hash_set_visit(void *set, bridge_visitor_t visitor, void *user_data);
+
+/* tree_map without values */
+void *bridge_tree_set_create(size_t element_size);
+void bridge_tree_set_destroy(void *set);
+int bridge_tree_set_insert(void *set, const void *element);
+void bridge_tree_set_erase(void *set, const void *element);
+int bridge_tree_set_contains(void *set, const void *element);
+void bridge_tree_set_visit(void *set, bridge_visitor_t visitor, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef VECTOR_VS_LIST_ELEMENT_HPP
+#define VECTOR_VS_LIST_ELEMENT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+
+namespace vsl
+{
+	// Ordered and hashed by key only. The padding makes the element Size
+	// bytes large and is always zero, so comparing the raw bytes (as the
+	// C containers do) agrees with comparing keys.
+	template <std::size_t Size>
+	struct element
+	{
+		std::uint64_t key;
+		char padding[Size - sizeof(std::uint64_t)];
+
+		element()
+			: key(0)
+		{
+			std::memset(padding, 0, sizeof(padding));
+		}
+
+		explicit element(std::uint64_t key)
+			: key(key)
+		{
+			std::memset(padding, 0, sizeof(padding));
+		}
+	};
+
+	template <>
+	struct element<sizeof(std::uint64_t)>
+	{
+		std::uint64_t key;
+
+		element()
+			: key(0)
+		{
+		}
+
+		explicit element(std::uint64_t key)
+			: key(key)
+		{
+		}
+	};
+
+	template <std::size_t Size>
+	bool operator < (element<Size> const &left, element<Size> const &right)
+	{
+		return left.key < right.key;
+	}
+
+	template <std::size_t Size>
+	bool operator == (element<Size> const &left, element<Size> const &right)
+	{
+		return left.key == right.key;
+	}
+}
+
+namespace std
+{
+	template <std::size_t Size>
+	struct hash<vsl::element<Size>>
+	{
+		std::size_t operator()(vsl::element<Size> const &e) const
+		{
+			return std::hash<std::uint64_t>()(e.key);
+		}
+	};
+}
+
+#endif
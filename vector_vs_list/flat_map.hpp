@@ -0,0 +1,41 @@
+#ifndef VECTOR_VS_LIST_FLAT_MAP_HPP
+#define VECTOR_VS_LIST_FLAT_MAP_HPP
+
+#include "flat_set.hpp"
+
+namespace vsl
+{
+	struct first_key
+	{
+		template <class Pair>
+		typename Pair::first_type const &operator()(Pair const &value) const
+		{
+			return value.first;
+		}
+	};
+
+	// Map kept as a sorted std::vector of pairs, see flat_set. Unlike
+	// std::map the keys are not const, so do not modify them through an
+	// iterator.
+	template <class Key, class Value, class Compare = std::less<Key>>
+	class flat_map : public flat_storage<std::pair<Key, Value>, Key, first_key, Compare>
+	{
+	public:
+		typedef Key key_type;
+		typedef Value mapped_type;
+
+		explicit flat_map(Compare compare = Compare())
+			: flat_storage<std::pair<Key, Value>, Key, first_key, Compare>(compare)
+		{
+		}
+
+		using flat_storage<std::pair<Key, Value>, Key, first_key, Compare>::insert;
+
+		Value &operator[](Key const &key)
+		{
+			return this->insert(std::make_pair(key, Value())).first->second;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef VECTOR_VS_LIST_FLAT_SET_HPP
+#define VECTOR_VS_LIST_FLAT_SET_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace vsl
+{
+	// std::lower_bound with the same answer, but the loop halves a fixed
+	// length and only moves the base by a conditional select, so the
+	// compiler can emit a cmov instead of an unpredictable branch.
+	template <class RandomAccessIterator, class T, class Compare>
+	RandomAccessIterator branchless_lower_bound(RandomAccessIterator first, RandomAccessIterator last, T const &value, Compare compare)
+	{
+		std::size_t length = static_cast<std::size_t>(last - first);
+		if (length == 0)
+		{
+			return first;
+		}
+		while (length > 1)
+		{
+			std::size_t const half = length / 2;
+			first = compare(first[half], value) ? (first + half) : first;
+			length -= half;
+		}
+		return compare(*first, value) ? (first + 1) : first;
+	}
+
+	// Sorted contiguous storage shared by flat_set and flat_map. KeyOf
+	// extracts the key from a stored value.
+	template <class Value, class Key, class KeyOf, class Compare>
+	class flat_storage
+	{
+	public:
+		typedef Value value_type;
+		typedef typename std::vector<Value>::iterator iterator;
+		typedef typename std::vector<Value>::const_iterator const_iterator;
+
+		explicit flat_storage(Compare compare)
+			: m_compare(compare)
+		{
+		}
+
+		std::pair<iterator, bool> insert(Value const &value)
+		{
+			auto const position = lower_bound(key_of(value));
+			if ((position != m_elements.end()) &&
+				!m_compare(key_of(value), key_of(*position)))
+			{
+				return std::make_pair(position, false);
+			}
+			return std::make_pair(m_elements.insert(position, value), true);
+		}
+
+		// Appends the batch, sorts only the new part and merges it into the
+		// rest: O(n + k log k) instead of k shifting insertions. As with
+		// std::set, a key that is already present or repeats within the
+		// batch keeps its first value.
+		template <class InputIterator>
+		void insert(InputIterator first, InputIterator last)
+		{
+			std::size_t const old_size = m_elements.size();
+			m_elements.insert(m_elements.end(), first, last);
+
+			auto const middle = m_elements.begin() + static_cast<std::ptrdiff_t>(old_size);
+			auto const less = [this](Value const &left, Value const &right)
+			{
+				return m_compare(key_of(left), key_of(right));
+			};
+			std::stable_sort(middle, m_elements.end(), less);
+			std::inplace_merge(m_elements.begin(), middle, m_elements.end(), less);
+			m_elements.erase(std::unique(m_elements.begin(), m_elements.end(), [&less](Value const &left, Value const &right)
+			{
+				return !less(left, right);
+			}), m_elements.end());
+		}
+
+		std::size_t erase(Key const &key)
+		{
+			auto const position = find(key);
+			if (position == m_elements.end())
+			{
+				return 0;
+			}
+			m_elements.erase(position);
+			return 1;
+		}
+
+		iterator find(Key const &key)
+		{
+			auto const position = lower_bound(key);
+			if ((position == m_elements.end()) ||
+				m_compare(key, key_of(*position)))
+			{
+				return m_elements.end();
+			}
+			return position;
+		}
+
+		const_iterator find(Key const &key) const
+		{
+			return const_cast<flat_storage &>(*this).find(key);
+		}
+
+		std::size_t count(Key const &key) const
+		{
+			return (find(key) != end()) ? 1 : 0;
+		}
+
+		iterator lower_bound(Key const &key)
+		{
+			return branchless_lower_bound(m_elements.begin(), m_elements.end(), key, [this](Value const &element, Key const &k)
+			{
+				return m_compare(key_of(element), k);
+			});
+		}
+
+		iterator begin()
+		{
+			return m_elements.begin();
+		}
+
+		iterator end()
+		{
+			return m_elements.end();
+		}
+
+		const_iterator begin() const
+		{
+			return m_elements.begin();
+		}
+
+		const_iterator end() const
+		{
+			return m_elements.end();
+		}
+
+		std::size_t size() const
+		{
+			return m_elements.size();
+		}
+
+		bool empty() const
+		{
+			return m_elements.empty();
+		}
+
+		void reserve(std::size_t capacity)
+		{
+			m_elements.reserve(capacity);
+		}
+
+		void clear()
+		{
+			m_elements.clear();
+		}
+
+	protected:
+		std::vector<Value> m_elements;
+		Compare m_compare;
+
+		static Key const &key_of(Value const &value)
+		{
+			return KeyOf()(value);
+		}
+	};
+
+	struct identity_key
+	{
+		template <class T>
+		T const &operator()(T const &value) const
+		{
+			return value;
+		}
+	};
+
+	// Set kept as a sorted std::vector. Lookups are binary searches over
+	// contiguous memory; single insertions and erasures shift the tail, so
+	// fill it with the batch insert where possible.
+	template <class T, class Compare = std::less<T>>
+	class flat_set : public flat_storage<T, T, identity_key, Compare>
+	{
+	public:
+		explicit flat_set(Compare compare = Compare())
+			: flat_storage<T, T, identity_key, Compare>(compare)
+		{
+		}
+
+		// elements of a set must not be modified in place
+		typename flat_set::const_iterator begin() const
+		{
+			return this->m_elements.begin();
+		}
+
+		typename flat_set::const_iterator end() const
+		{
+			return this->m_elements.end();
+		}
+	};
+}
+
+#endif
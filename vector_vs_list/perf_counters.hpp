@@ -0,0 +1,123 @@
+#ifndef VECTOR_VS_LIST_PERF_COUNTERS_HPP
+#define VECTOR_VS_LIST_PERF_COUNTERS_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#	include <linux/perf_event.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+namespace vsl
+{
+	struct counter_values
+	{
+		std::uint64_t cache_misses;
+		std::uint64_t l1d_misses;
+	};
+
+	// Hardware cache miss counters of the calling thread, user space only.
+	// Without perf_event_open, a PMU or the permission to use it (see
+	// /proc/sys/kernel/perf_event_paranoid) available() is false and the
+	// values stay zero.
+	class perf_counters
+	{
+	public:
+		perf_counters()
+			: m_cache_misses(-1)
+			, m_l1d_misses(-1)
+		{
+#ifdef __linux__
+			m_cache_misses = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+			m_l1d_misses = open_counter(PERF_TYPE_HW_CACHE,
+				PERF_COUNT_HW_CACHE_L1D |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+		}
+
+		~perf_counters()
+		{
+#ifdef __linux__
+			if (m_cache_misses >= 0)
+			{
+				::close(m_cache_misses);
+			}
+			if (m_l1d_misses >= 0)
+			{
+				::close(m_l1d_misses);
+			}
+#endif
+		}
+
+		perf_counters(perf_counters const &) = delete;
+		perf_counters &operator=(perf_counters const &) = delete;
+
+		bool available() const
+		{
+			return (m_cache_misses >= 0) && (m_l1d_misses >= 0);
+		}
+
+		void start()
+		{
+#ifdef __linux__
+			if (available())
+			{
+				::ioctl(m_cache_misses, PERF_EVENT_IOC_RESET, 0);
+				::ioctl(m_l1d_misses, PERF_EVENT_IOC_RESET, 0);
+				::ioctl(m_cache_misses, PERF_EVENT_IOC_ENABLE, 0);
+				::ioctl(m_l1d_misses, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+		}
+
+		counter_values stop()
+		{
+			counter_values values = {0, 0};
+#ifdef __linux__
+			if (available())
+			{
+				::ioctl(m_cache_misses, PERF_EVENT_IOC_DISABLE, 0);
+				::ioctl(m_l1d_misses, PERF_EVENT_IOC_DISABLE, 0);
+				values.cache_misses = read_counter(m_cache_misses);
+				values.l1d_misses = read_counter(m_l1d_misses);
+			}
+#endif
+			return values;
+		}
+
+	private:
+		int m_cache_misses;
+		int m_l1d_misses;
+
+#ifdef __linux__
+		static int open_counter(std::uint32_t type, std::uint64_t config)
+		{
+			perf_event_attr attributes;
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.type = type;
+			attributes.size = sizeof(attributes);
+			attributes.config = config;
+			attributes.disabled = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			return static_cast<int>(::syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+		}
+
+		static std::uint64_t read_counter(int descriptor)
+		{
+			std::uint64_t value = 0;
+			if (::read(descriptor, &value, sizeof(value)) != sizeof(value))
+			{
+				return 0;
+			}
+			return value;
+		}
+#endif
+	};
+}
+
+#endif
@@ -1,100 +1,707 @@
+#include "c_containers.hpp"
+#include "element.hpp"
+#include "flat_map.hpp"
+#include "flat_set.hpp"
+#include "perf_counters.hpp"
 #include <vector>
+#include <deque>
 #include <list>
-#include <cctype>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
-#include <unordered_set>
-#include <set>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <boost/iterator/transform_iterator.hpp>
 #include <boost/random.hpp>
 #include <boost/lexical_cast.hpp>
 
 namespace vsl
 {
-	typedef std::intptr_t element;
+	enum operation
+	{
+		// n insertions into an empty container: push_back or random keys
+		operation_fill = 1,
+		// m random insertions followed by m random erasures
+		operation_insert_erase = 2,
+		// m searches for random keys, about half of which are present
+		operation_lookup = 4,
+		// one pass over all n elements
+		operation_iterate = 8,
+		// sorting n random keys
+		operation_sort = 16,
+		// the n insertions of fill as one range insertion
+		operation_bulk_fill = 32
+	};
+
+	template <class Container>
+	void sort_container(Container &c)
+	{
+		std::sort(c.begin(), c.end());
+	}
+
+	template <class T, class Allocator>
+	void sort_container(std::list<T, Allocator> &c)
+	{
+		c.sort();
+	}
+
+	template <std::size_t Size>
+	element<Size> const &element_of(element<Size> const &e)
+	{
+		return e;
+	}
+
+	template <class Key, std::size_t Size>
+	element<Size> const &element_of(std::pair<Key, element<Size>> const &entry)
+	{
+		return entry.second;
+	}
+
+	template <class Container, class Function>
+	void for_each_element(Container &c, Function &&function)
+	{
+		for (auto &&e : c)
+		{
+			function(element_of(e));
+		}
+	}
+
+	template <class T, class Function>
+	void for_each_element(c_list<T> &c, Function &&function)
+	{
+		c.for_each(function);
+	}
+
+	template <class T, class Function>
+	void for_each_element(c_hash_set<T> &c, Function &&function)
+	{
+		c.for_each(function);
+	}
+
+	template <class T, class Function>
+	void for_each_element(c_tree_set<T> &c, Function &&function)
+	{
+		c.for_each(function);
+	}
+
+	// The adapters give every container the same operations. A sequence
+	// inserts and erases at positions and searches linearly, a set or map
+	// by key. Maps store the element under its key.
+
+	template <class Container>
+	struct sequence
+	{
+		static unsigned const operations = operation_fill | operation_bulk_fill | operation_insert_erase | operation_lookup | operation_iterate | operation_sort;
+
+		Container c;
+		std::size_t size;
+
+		sequence()
+			: size(0)
+		{
+		}
+
+		template <class T>
+		void add(T const &e)
+		{
+			c.push_back(e);
+			++size;
+		}
+
+		template <class T>
+		void add_batch(std::vector<T> const &batch)
+		{
+			c.insert(c.end(), batch.data(), batch.data() + batch.size());
+			size += batch.size();
+		}
+
+		template <class T>
+		void insert_random(T const &e, std::size_t random)
+		{
+			c.insert(std::next(c.begin(), static_cast<std::ptrdiff_t>(random % (size + 1))), e);
+			++size;
+		}
+
+		template <class T>
+		void erase_random(T const &, std::size_t random)
+		{
+			c.erase(std::next(c.begin(), static_cast<std::ptrdiff_t>(random % size)));
+			--size;
+		}
+
+		template <class T>
+		bool contains(T const &e)
+		{
+			return std::find(c.begin(), c.end(), e) != c.end();
+		}
+
+		void sort()
+		{
+			sort_container(c);
+		}
+	};
+
+	// c_containers' linked_list has neither positional insertion nor
+	// search, the empty functions only satisfy the harness' switch
+	template <class T>
+	struct list_sequence
+	{
+		static unsigned const operations = operation_fill | operation_iterate;
+
+		c_list<T> c;
+
+		void add(T const &e)
+		{
+			c.push_back(e);
+		}
+
+		void add_batch(std::vector<T> const &)
+		{
+		}
+
+		void insert_random(T const &, std::size_t)
+		{
+		}
+
+		void erase_random(T const &, std::size_t)
+		{
+		}
+
+		bool contains(T const &)
+		{
+			return false;
+		}
+
+		void sort()
+		{
+		}
+	};
 
 	template <class Container>
-	struct tests
+	struct set
 	{
-		static void push_back(std::size_t n)
+		static unsigned const operations = operation_fill | operation_bulk_fill | operation_insert_erase | operation_lookup | operation_iterate;
+
+		Container c;
+
+		template <class T>
+		void add(T const &e)
+		{
+			c.insert(e);
+		}
+
+		template <class T>
+		void add_batch(std::vector<T> const &batch)
+		{
+			c.insert(batch.data(), batch.data() + batch.size());
+		}
+
+		template <class T>
+		void insert_random(T const &e, std::size_t)
+		{
+			c.insert(e);
+		}
+
+		template <class T>
+		void erase_random(T const &e, std::size_t)
+		{
+			c.erase(e);
+		}
+
+		template <class T>
+		bool contains(T const &e)
+		{
+			return c.count(e) != 0;
+		}
+
+		void sort()
+		{
+		}
+	};
+
+	struct keyed
+	{
+		template <class T>
+		std::pair<std::uint64_t, T> operator()(T const &e) const
+		{
+			return std::make_pair(e.key, e);
+		}
+	};
+
+	template <class Container>
+	struct map
+	{
+		static unsigned const operations = operation_fill | operation_bulk_fill | operation_insert_erase | operation_lookup | operation_iterate;
+
+		Container c;
+
+		template <class T>
+		void add(T const &e)
+		{
+			c.insert(keyed()(e));
+		}
+
+		template <class T>
+		void add_batch(std::vector<T> const &batch)
+		{
+			c.insert(boost::make_transform_iterator(batch.begin(), keyed()), boost::make_transform_iterator(batch.end(), keyed()));
+		}
+
+		template <class T>
+		void insert_random(T const &e, std::size_t)
 		{
-			Container c;
-			for (std::size_t i = 0; i < n; ++i)
+			add(e);
+		}
+
+		template <class T>
+		void erase_random(T const &e, std::size_t)
+		{
+			c.erase(e.key);
+		}
+
+		template <class T>
+		bool contains(T const &e)
+		{
+			return c.count(e.key) != 0;
+		}
+
+		void sort()
+		{
+		}
+	};
+
+	struct options
+	{
+		std::size_t elements;
+		std::size_t operations;
+		std::size_t repetitions;
+		std::size_t warmup;
+		bool json;
+		std::string container;
+		std::string operation;
+		std::size_t element_size;
+	};
+
+	// the same random input for every container
+	struct workload
+	{
+		std::vector<std::uint64_t> keys;
+		std::vector<std::uint64_t> probes;
+		std::vector<std::size_t> positions;
+
+		explicit workload(options const &o)
+		{
+			boost::random::mt19937 prng;
+			boost::random::uniform_int_distribution<std::uint64_t> key(0, 2 * o.elements);
+			boost::random::uniform_int_distribution<std::size_t> position;
+			for (std::size_t i = 0; i < o.elements; ++i)
 			{
-				c.push_back(typename Container::value_type());
+				keys.push_back(key(prng));
 			}
-
-			typename Container::value_type sum{};
-			for (auto &&e : c)
+			for (std::size_t i = 0; i < o.operations; ++i)
 			{
-				sum += e;
+				probes.push_back(key(prng));
+				positions.push_back(position(prng));
 			}
+		}
+	};
 
-			if (sum)
+	struct summary
+	{
+		double median;
+		double minimum;
+		double mean;
+		double deviation;
+	};
+
+	summary summarize(std::vector<double> values)
+	{
+		summary s;
+		std::sort(values.begin(), values.end());
+		double const count = static_cast<double>(values.size());
+		s.minimum = values.front();
+		s.median = (values.size() % 2)
+			? values[values.size() / 2]
+			: (values[values.size() / 2 - 1] + values[values.size() / 2]) / 2;
+		s.mean = std::accumulate(values.begin(), values.end(), 0.0) / count;
+		double squares = 0;
+		for (double const value : values)
+		{
+			squares += (value - s.mean) * (value - s.mean);
+		}
+		s.deviation = (values.size() > 1) ? std::sqrt(squares / (count - 1)) : 0;
+		return s;
+	}
+
+	struct result
+	{
+		std::string container;
+		std::size_t element_size;
+		std::string operation;
+		std::size_t elements;
+		std::size_t operations;
+		summary nanoseconds;
+		bool has_counters;
+		double cache_misses;
+		double l1d_misses;
+	};
+
+	// writes one line or object per result as soon as it is known
+	class report
+	{
+	public:
+		explicit report(bool json)
+			: m_json(json)
+			, m_first(true)
+		{
+			if (m_json)
 			{
-				throw std::logic_error("Cannot happen");
+				std::cout << "[\n";
+			}
+			else
+			{
+				std::cout << "container,element_size,operation,elements,operations,"
+					"ns_per_op_median,ns_per_op_min,ns_per_op_mean,ns_per_op_stddev,"
+					"cache_misses_per_op,l1d_misses_per_op\n";
 			}
 		}
 
-		template <class Generator>
-		static void insert_into_set(std::size_t n, Generator const &generate)
+		~report()
 		{
-			Container c;
-			for (std::size_t i = 0; i < n; ++i)
+			if (m_json)
 			{
-				c.insert(generate());
+				std::cout << "\n]\n";
 			}
+		}
 
-			typename Container::value_type sum{};
-			for (auto &&e : c)
+		void add(result const &r)
+		{
+			if (m_json)
 			{
-				sum += e;
+				std::cout << (m_first ? "" : ",\n")
+					<< "  {\"container\": \"" << r.container << "\""
+					<< ", \"element_size\": " << r.element_size
+					<< ", \"operation\": \"" << r.operation << "\""
+					<< ", \"elements\": " << r.elements
+					<< ", \"operations\": " << r.operations
+					<< ", \"ns_per_op\": {\"median\": " << r.nanoseconds.median
+					<< ", \"min\": " << r.nanoseconds.minimum
+					<< ", \"mean\": " << r.nanoseconds.mean
+					<< ", \"stddev\": " << r.nanoseconds.deviation << "}";
+				if (r.has_counters)
+				{
+					std::cout << ", \"cache_misses_per_op\": " << r.cache_misses
+						<< ", \"l1d_misses_per_op\": " << r.l1d_misses;
+				}
+				else
+				{
+					std::cout << ", \"cache_misses_per_op\": null, \"l1d_misses_per_op\": null";
+				}
+				std::cout << "}";
 			}
-
-			if (sum < 0)
+			else
 			{
-				throw std::logic_error("Cannot happen");
+				std::cout << '"' << r.container << "\"," << r.element_size << ',' << r.operation << ','
+					<< r.elements << ',' << r.operations << ','
+					<< r.nanoseconds.median << ',' << r.nanoseconds.minimum << ','
+					<< r.nanoseconds.mean << ',' << r.nanoseconds.deviation << ',';
+				if (r.has_counters)
+				{
+					std::cout << r.cache_misses << ',' << r.l1d_misses;
+				}
+				else
+				{
+					std::cout << ',';
+				}
+				std::cout << '\n';
 			}
+			std::cout.flush();
+			m_first = false;
 		}
+
+	private:
+		bool m_json;
+		bool m_first;
 	};
-}
 
-int main(int argc, char **argv)
-{
-	if (argc >= 2)
+	class harness
 	{
-		std::size_t n = 100000000;
-		if (argc >= 3)
+	public:
+		harness(options const &o, workload const &w, report &r)
+			: m_options(o)
+			, m_workload(w)
+			, m_report(r)
+			, m_sink(0)
 		{
-			n = std::max<std::size_t>(1, boost::lexical_cast<std::size_t>(argv[2]));
 		}
 
-		boost::random::mt19937 prng;
-		boost::random::uniform_int_distribution<vsl::element> dist(0, std::numeric_limits<vsl::element>::max() / n);
-		auto const &&random = [&prng, dist] { return dist(prng); };
+		template <class Adapter, std::size_t Size>
+		void run(std::string const &container)
+		{
+			if (!m_options.container.empty() && (m_options.container != container))
+			{
+				return;
+			}
+			run_operation<Adapter, Size>(container, "fill", operation_fill);
+			run_operation<Adapter, Size>(container, "insert_erase", operation_insert_erase);
+			run_operation<Adapter, Size>(container, "lookup", operation_lookup);
+			run_operation<Adapter, Size>(container, "iterate", operation_iterate);
+			run_operation<Adapter, Size>(container, "sort", operation_sort);
+			run_operation<Adapter, Size>(container, "bulk_fill", operation_bulk_fill);
+		}
 
-		switch (std::toupper(argv[1][0]))
+	private:
+		options const &m_options;
+		workload const &m_workload;
+		report &m_report;
+		perf_counters m_counters;
+		std::uint64_t volatile m_sink;
+
+		template <class Adapter, std::size_t Size>
+		void fill(Adapter &a) const
 		{
-		case 'V':
-			vsl::tests<std::vector<vsl::element>>::push_back(n);
-			return 0;
+			for (auto const key : m_workload.keys)
+			{
+				a.add(element<Size>(key));
+			}
+		}
 
-		case 'L':
-			vsl::tests<std::list<vsl::element>>::push_back(n);
-			return 0;
+		// runs the timed part of one repetition and returns how many operations it did
+		template <class Adapter, std::size_t Size>
+		std::size_t execute(Adapter &a, operation op, std::vector<element<Size>> const &batch, std::uint64_t &checksum) const
+		{
+			switch (op)
+			{
+			case operation_fill:
+				fill<Adapter, Size>(a);
+				return m_workload.keys.size();
 
-		case 'U':
-			vsl::tests<std::unordered_set<vsl::element>>::insert_into_set(n, random);
-			return 0;
+			case operation_bulk_fill:
+				a.add_batch(batch);
+				return batch.size();
+
+			case operation_insert_erase:
+				for (std::size_t i = 0; i < m_workload.probes.size(); ++i)
+				{
+					a.insert_random(element<Size>(m_workload.probes[i]), m_workload.positions[i]);
+				}
+				for (std::size_t i = 0; i < m_workload.probes.size(); ++i)
+				{
+					a.erase_random(element<Size>(m_workload.probes[i]), m_workload.positions[i]);
+				}
+				return 2 * m_workload.probes.size();
+
+			case operation_lookup:
+				for (auto const probe : m_workload.probes)
+				{
+					checksum += a.contains(element<Size>(probe)) ? 1 : 0;
+				}
+				return m_workload.probes.size();
+
+			case operation_iterate:
+				for_each_element(a.c, [&checksum](element<Size> const &e)
+				{
+					checksum += e.key;
+				});
+				return m_workload.keys.size();
 
-		case 'S':
-			vsl::tests<std::set<vsl::element>>::insert_into_set(n, random);
+			case operation_sort:
+				a.sort();
+				return m_workload.keys.size();
+			}
 			return 0;
+		}
+
+		template <class Adapter, std::size_t Size>
+		void run_operation(std::string const &container, char const *name, operation op)
+		{
+			if (!(Adapter::operations & op) ||
+				(!m_options.operation.empty() && (m_options.operation != name)))
+			{
+				return;
+			}
+
+			std::vector<double> nanoseconds;
+			counter_values counted = {0, 0};
+			std::size_t operations = 0;
+			std::uint64_t checksum = 0;
+
+			// built outside of the timed part
+			std::vector<element<Size>> batch;
+			if (op == operation_bulk_fill)
+			{
+				for (auto const key : m_workload.keys)
+				{
+					batch.push_back(element<Size>(key));
+				}
+			}
+
+			for (std::size_t repetition = 0; repetition < (m_options.warmup + m_options.repetitions); ++repetition)
+			{
+				std::unique_ptr<Adapter> a(new Adapter);
+				if ((op != operation_fill) && (op != operation_bulk_fill))
+				{
+					fill<Adapter, Size>(*a);
+				}
+
+				m_counters.start();
+				auto const start = std::chrono::steady_clock::now();
+				operations = execute<Adapter, Size>(*a, op, batch, checksum);
+				auto const elapsed = std::chrono::steady_clock::now() - start;
+				counter_values const values = m_counters.stop();
+
+				if (repetition >= m_options.warmup)
+				{
+					nanoseconds.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / static_cast<double>(operations));
+					counted.cache_misses += values.cache_misses;
+					counted.l1d_misses += values.l1d_misses;
+				}
+			}
+
+			// keeps the compiler from dropping the lookups and iterations
+			m_sink = m_sink + checksum;
+
+			double const total = static_cast<double>(operations * m_options.repetitions);
+			result r;
+			r.container = container;
+			r.element_size = Size;
+			r.operation = name;
+			r.elements = m_options.elements;
+			r.operations = operations;
+			r.nanoseconds = summarize(nanoseconds);
+			r.has_counters = m_counters.available();
+			r.cache_misses = static_cast<double>(counted.cache_misses) / total;
+			r.l1d_misses = static_cast<double>(counted.l1d_misses) / total;
+			m_report.add(r);
+		}
+	};
+
+	template <std::size_t Size>
+	void run_element_size(harness &h, options const &o)
+	{
+		if (o.element_size && (o.element_size != Size))
+		{
+			return;
+		}
+
+		typedef element<Size> T;
+		h.run<sequence<std::vector<T>>, Size>("std::vector");
+		h.run<sequence<std::deque<T>>, Size>("std::deque");
+		h.run<sequence<std::list<T, pool_allocator<T>>>, Size>("std::list+pool");
+		h.run<set<std::set<T>>, Size>("std::set");
+		h.run<set<std::unordered_set<T>>, Size>("std::unordered_set");
+		h.run<set<flat_set<T>>, Size>("flat_set");
+		h.run<map<std::map<std::uint64_t, T>>, Size>("std::map");
+		h.run<map<std::unordered_map<std::uint64_t, T>>, Size>("std::unordered_map");
+		h.run<map<flat_map<std::uint64_t, T>>, Size>("flat_map");
+		h.run<sequence<c_vector<T>>, Size>("c_containers::vector");
+		h.run<list_sequence<T>, Size>("c_containers::linked_list+pool");
+		h.run<set<c_hash_set<T>>, Size>("c_containers::hash_set");
+		h.run<set<c_tree_set<T>>, Size>("c_containers::tree_map");
+	}
+
+	void print_help(std::ostream &out)
+	{
+		out << "Syntax: vector_vs_list [options]\n"
+			"  --elements N      elements per container (10000)\n"
+			"  --operations M    insertions, erasures or lookups per run (1000)\n"
+			"  --repetitions R   measured runs (5)\n"
+			"  --warmup W        runs before measuring (1)\n"
+			"  --json            JSON instead of CSV\n"
+			"  --container NAME  only this container, e.g. std::vector\n"
+			"  --operation NAME  fill, bulk_fill, insert_erase, lookup,\n"
+			"                    iterate or sort\n"
+			"  --size BYTES      only this element size: 8, 16, 32, 64, 128 or 256\n";
+	}
+}
 
-		default:
-			break;
+int main(int argc, char **argv)
+{
+	vsl::options o;
+	o.elements = 10000;
+	o.operations = 1000;
+	o.repetitions = 5;
+	o.warmup = 1;
+	o.json = false;
+	o.element_size = 0;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string const option = argv[i];
+			bool const has_value = (i + 1) < argc;
+			if (option == "--json")
+			{
+				o.json = true;
+			}
+			else if ((option == "--elements") && has_value)
+			{
+				o.elements = std::max<std::size_t>(1, boost::lexical_cast<std::size_t>(argv[++i]));
+			}
+			else if ((option == "--operations") && has_value)
+			{
+				o.operations = boost::lexical_cast<std::size_t>(argv[++i]);
+			}
+			else if ((option == "--repetitions") && has_value)
+			{
+				o.repetitions = std::max<std::size_t>(1, boost::lexical_cast<std::size_t>(argv[++i]));
+			}
+			else if ((option == "--warmup") && has_value)
+			{
+				o.warmup = boost::lexical_cast<std::size_t>(argv[++i]);
+			}
+			else if ((option == "--container") && has_value)
+			{
+				o.container = argv[++i];
+			}
+			else if ((option == "--operation") && has_value)
+			{
+				o.operation = argv[++i];
+			}
+			else if ((option == "--size") && has_value)
+			{
+				o.element_size = boost::lexical_cast<std::size_t>(argv[++i]);
+			}
+			else
+			{
+				vsl::print_help(std::cerr);
+				return 1;
+			}
 		}
 	}
+	catch (boost::bad_lexical_cast const &)
+	{
+		vsl::print_help(std::cerr);
+		return 1;
+	}
 
-	std::cerr << "Pass either 'V' or 'L' as an argument to run the test on vector or list.\n";
-	return 1;
+	vsl::workload const w(o);
+	vsl::report r(o.json);
+	vsl::harness h(o, w, r);
+	try
+	{
+		vsl::run_element_size<8>(h, o);
+		vsl::run_element_size<16>(h, o);
+		vsl::run_element_size<32>(h, o);
+		vsl::run_element_size<64>(h, o);
+		vsl::run_element_size<128>(h, o);
+		vsl::run_element_size<256>(h, o);
+	}
+	catch (std::exception const &e)
+	{
+		// the report still ends the output so that the results so far can be parsed
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
 }